@@ -6,6 +6,7 @@
 #include <iostream>
 
 using namespace datastore;
+using namespace datastore::literals;
 
 int main()
 {
@@ -32,7 +33,7 @@ int main()
     vault vault1;
     vault1.root()->load_subnode_tree(vol1.root());
     vault1.root()->open_subnode("vol1")->load_subnode_tree(vol1_copy.root()->open_subnode("8"));
-    vault1.root()->open_subnode("vol1.8.4")->set_value("kk", "vv");
+    vault1.root()->open_subnode("vol1.8.4"_path)->set_value("kk", "vv");
     vault1.root()->open_subnode("vol1.8")->delete_subview_tree("4");
 
     std::cout << "vault1: " << *vault1.root() << std::endl;
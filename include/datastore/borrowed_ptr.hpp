@@ -0,0 +1,56 @@
+#pragma once
+
+#include <utility>
+
+#include "datastore/detail/epoch.hpp"
+
+namespace datastore
+{
+// Non-owning reference to a node or a node view
+// The object stays alive for the lifetime of the reference even if it gets deleted concurrently,
+// but unlike std::shared_ptr obtaining the reference doesn't modify a shared reference counter.
+// The reference must not be passed to other threads or outlive the object it was borrowed from.
+// Deleted objects are not released while any reference is held, so references should be short-lived.
+template <typename T>
+class borrowed_ptr
+{
+    friend class node;
+    friend class node_view;
+    friend class vault;
+    friend class volume;
+
+  public:
+    borrowed_ptr() = default;
+
+    T* get() const noexcept
+    {
+        return ptr_;
+    }
+
+    T* operator->() const noexcept
+    {
+        return ptr_;
+    }
+
+    T& operator*() const noexcept
+    {
+        return *ptr_;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return ptr_ != nullptr;
+    }
+
+  private:
+    borrowed_ptr(detail::epoch_guard guard, T* ptr)
+        : guard_(std::move(guard)),
+          ptr_(ptr)
+    {
+    }
+
+    // Empty references don't pin the epoch
+    detail::epoch_guard guard_ = detail::epoch_guard::unpinned();
+    T* ptr_ = nullptr;
+};
+} // namespace datastore
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace datastore::detail
+{
+// Epoch based memory reclamation
+// Readers pin the current epoch for the duration of a scope and can access shared objects without owning them.
+// Writers retire objects they have unlinked instead of releasing them,
+// retired objects are released once no reader pinned before the object was unlinked is left.
+class epoch_domain
+{
+  public:
+    // Number of objects a thread retires before it tries to release them
+    static constexpr size_t reclaim_threshold = 64;
+
+    static epoch_domain& instance()
+    {
+        static epoch_domain domain;
+        return domain;
+    }
+
+    epoch_domain(const epoch_domain& other) = delete;
+    epoch_domain& operator=(const epoch_domain& rhs) = delete;
+
+    ~epoch_domain()
+    {
+        record* r = records_.load();
+        while (r)
+            delete std::exchange(r, r->next);
+    }
+
+    void enter()
+    {
+        thread_handle& handle = this_thread_handle();
+        if (handle.nesting++ > 0)
+            return;
+
+        handle.owned_record(*this).epoch.store(global_epoch_.load());
+    }
+
+    // Takes no locks, retired objects are released by the threads retiring them
+    void leave()
+    {
+        thread_handle& handle = this_thread_handle();
+        if (--handle.nesting > 0)
+            return;
+
+        handle.owned->epoch.store(quiescent, std::memory_order_release);
+
+        if (handle.synchronize_on_leave)
+        {
+            handle.synchronize_on_leave = false;
+            synchronize();
+        }
+    }
+
+    // Checks whether the calling thread is in a pinned scope
+    [[nodiscard]] bool pinned() const
+    {
+        return this_thread_handle().nesting > 0;
+    }
+
+    // Releases the object once it's not reachable by pinned readers
+    // The object must be already unlinked from any shared structure
+    // Objects are kept by the retiring thread and released in batches, so a retire costs O(1) amortized.
+    void retire(std::shared_ptr<const void> object)
+    {
+        record& r = this_thread_handle().owned_record(*this);
+
+        std::vector<std::shared_ptr<const void>> reclaimed;
+        {
+            std::scoped_lock lock(r.retired_mutex);
+            r.retired.emplace_back(global_epoch_.fetch_add(1), std::move(object));
+            if (r.retired.size() < r.next_reclaim)
+                return;
+
+            collect(r, min_pinned_epoch(), reclaimed);
+
+            // Objects still pinned by readers are not scanned again until the list doubles
+            r.next_reclaim = std::max(reclaim_threshold, 2 * r.retired.size());
+        }
+    }
+
+    // Waits for all readers pinned at the moment of the call to leave and releases everything retired before it
+    // Must not be called from a pinned scope, see synchronize_on_leave()
+    void synchronize()
+    {
+        const uint64_t epoch = global_epoch_.fetch_add(1);
+        while (min_pinned_epoch() <= epoch)
+            std::this_thread::yield();
+
+        // Objects are released outside of the locks since it may cause more objects to be retired
+        std::vector<std::shared_ptr<const void>> reclaimed;
+        const uint64_t min_epoch = min_pinned_epoch();
+        for (record* r = records_.load(); r; r = r->next)
+        {
+            std::scoped_lock lock(r->retired_mutex);
+            collect(*r, min_epoch, reclaimed);
+        }
+    }
+
+    // Synchronizes once the calling thread leaves its pinned scope, or right away if it's not pinned
+    void synchronize_on_leave()
+    {
+        thread_handle& handle = this_thread_handle();
+        if (handle.nesting > 0)
+            handle.synchronize_on_leave = true;
+        else
+            synchronize();
+    }
+
+  private:
+    static constexpr uint64_t quiescent = 0;
+
+    // Pinned epoch and retired objects of a thread, records are never freed and get reused after the thread exits
+    struct alignas(64) record
+    {
+        std::atomic<uint64_t> epoch = quiescent;
+        std::atomic_bool in_use = true;
+        record* next = nullptr;
+
+        std::mutex retired_mutex;
+        std::vector<std::pair<uint64_t, std::shared_ptr<const void>>> retired;
+        size_t next_reclaim = reclaim_threshold;
+    };
+
+    struct thread_handle
+    {
+        record* owned = nullptr;
+        size_t nesting = 0;
+        bool synchronize_on_leave = false;
+
+        record& owned_record(epoch_domain& domain)
+        {
+            if (!owned)
+                owned = domain.acquire_record();
+            return *owned;
+        }
+
+        ~thread_handle()
+        {
+            if (!owned)
+                return;
+
+            // Whatever is still pinned by other readers waits for the next thread taking over the record
+            std::vector<std::shared_ptr<const void>> reclaimed;
+            {
+                std::scoped_lock lock(owned->retired_mutex);
+                collect(*owned, instance().min_pinned_epoch(), reclaimed);
+            }
+            reclaimed.clear();
+
+            owned->in_use.store(false, std::memory_order_release);
+        }
+    };
+
+    epoch_domain() = default;
+
+    static thread_handle& this_thread_handle()
+    {
+        static thread_local thread_handle handle;
+        return handle;
+    }
+
+    // Reuses a record of an exited thread, a new one is registered if all of them are in use
+    record* acquire_record()
+    {
+        for (record* r = records_.load(); r; r = r->next)
+        {
+            bool expected = false;
+            if (!r->in_use.load(std::memory_order_relaxed) &&
+                r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                return r;
+        }
+
+        record* r = new record();
+        r->next = records_.load();
+        while (!records_.compare_exchange_weak(r->next, r))
+        {
+        }
+        return r;
+    }
+
+    uint64_t min_pinned_epoch() const
+    {
+        uint64_t min_epoch = std::numeric_limits<uint64_t>::max();
+        for (const record* r = records_.load(); r; r = r->next)
+        {
+            const uint64_t epoch = r->epoch.load();
+            if (epoch != quiescent && epoch < min_epoch)
+                min_epoch = epoch;
+        }
+        return min_epoch;
+    }
+
+    // Moves the objects retired before the given epoch out of the record, its mutex must be held
+    static void collect(record& r, uint64_t min_epoch, std::vector<std::shared_ptr<const void>>& reclaimed)
+    {
+        auto it = std::partition(r.retired.begin(), r.retired.end(), [&](const auto& retired) {
+            return retired.first >= min_epoch;
+        });
+        for (auto reclaimed_it = it; reclaimed_it != r.retired.end(); ++reclaimed_it)
+            reclaimed.push_back(std::move(reclaimed_it->second));
+        r.retired.erase(it, r.retired.end());
+    }
+
+    // Records are only ever prepended, so readers of the list need no lock
+    std::atomic<record*> records_ = nullptr;
+    std::atomic<uint64_t> global_epoch_ = quiescent + 1;
+};
+
+// Pins the current epoch for the lifetime of the object
+class epoch_guard
+{
+  public:
+    epoch_guard()
+    {
+        epoch_domain::instance().enter();
+    }
+
+    // Guard which pins nothing, held by empty references so they don't keep the epoch from advancing
+    static epoch_guard unpinned()
+    {
+        return epoch_guard(unpinned_tag{});
+    }
+
+    epoch_guard(const epoch_guard& other)
+        : active_(other.active_)
+    {
+        if (active_)
+            epoch_domain::instance().enter();
+    }
+
+    epoch_guard(epoch_guard&& other) noexcept
+        : active_(std::exchange(other.active_, false))
+    {
+    }
+
+    epoch_guard& operator=(epoch_guard other) noexcept
+    {
+        std::swap(active_, other.active_);
+        return *this;
+    }
+
+    ~epoch_guard()
+    {
+        if (active_)
+            epoch_domain::instance().leave();
+    }
+
+  private:
+    struct unpinned_tag
+    {
+    };
+
+    explicit epoch_guard(unpinned_tag)
+        : active_(false)
+    {
+    }
+
+    bool active_ = true;
+};
+} // namespace datastore::detail
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+
+namespace datastore::detail
+{
+// SharedMutex which doesn't own a lock but uses one of the locks shared by all pooled_mutex objects
+// The lock is chosen by the address of the object, so the object itself takes a single byte
+// Different objects may end up using the same lock, so an owner of a pooled_mutex
+// must not try to take another pooled_mutex, otherwise it might deadlock on its own lock.
+template <typename Mutex = std::shared_mutex, size_t PoolSize = 1024>
+class pooled_mutex
+{
+  public:
+    pooled_mutex() = default;
+
+    pooled_mutex(const pooled_mutex& other) = delete;
+    pooled_mutex& operator=(const pooled_mutex& rhs) = delete;
+
+    void lock()
+    {
+        underlying().lock();
+    }
+
+    bool try_lock()
+    {
+        return underlying().try_lock();
+    }
+
+    void unlock()
+    {
+        underlying().unlock();
+    }
+
+    void lock_shared()
+    {
+        underlying().lock_shared();
+    }
+
+    bool try_lock_shared()
+    {
+        return underlying().try_lock_shared();
+    }
+
+    void unlock_shared()
+    {
+        underlying().unlock_shared();
+    }
+
+    // Lock of the pool used by the object
+    [[nodiscard]] Mutex& underlying() const noexcept
+    {
+        const auto bits = reinterpret_cast<uintptr_t>(this);
+        return pool_[static_cast<size_t>((bits * 0x9e3779b97f4a7c15ull) >> 32) % PoolSize];
+    }
+
+  private:
+    static inline std::array<Mutex, PoolSize> pool_;
+};
+
+// Identifies the lock actually taken when the mutex is locked
+// Objects which need to lock several mutexes at once use it to take every lock only once
+template <typename Mutex>
+const void* lock_identity(const Mutex& mutex) noexcept
+{
+    return &mutex;
+}
+
+template <typename Mutex, size_t PoolSize>
+const void* lock_identity(const pooled_mutex<Mutex, PoolSize>& mutex) noexcept
+{
+    return &mutex.underlying();
+}
+} // namespace datastore::detail
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace datastore::detail
+{
+// Minimal collision-free mapping of a fixed set of keys to their indexes, built with the hash and displace method
+// Keys are first split into small buckets, then every bucket gets a displacement which moves all of its keys
+// into free slots. A lookup takes a single hash of the key and two array reads, the caller compares the key
+// with the one at the returned index, since any key not in the set is mapped to some index as well.
+class perfect_hash
+{
+  public:
+    static constexpr uint32_t npos = std::numeric_limits<uint32_t>::max();
+
+    // Builds the mapping for num_keys keys, key_hash(index, seed) has to hash the key with the given index
+    // Seeds are changed until the hashes of the keys differ enough for every bucket to be placed
+    template <typename KeyHash>
+    void build(size_t num_keys, KeyHash key_hash)
+    {
+        displacements_.clear();
+        slots_.clear();
+        if (num_keys == 0)
+            return;
+
+        const size_t num_buckets = num_keys / keys_per_bucket + 1;
+        const size_t num_slots = num_keys + num_keys / 4 + 1;
+
+        std::vector<uint64_t> hashes(num_keys);
+        std::vector<std::vector<uint32_t>> buckets(num_buckets);
+        std::vector<uint32_t> bucket_order(num_buckets);
+        std::vector<uint32_t> bucket_slots;
+
+        for (seed_ = 0;; ++seed_)
+        {
+            for (auto& bucket : buckets)
+                bucket.clear();
+            for (uint32_t i = 0; i < num_keys; ++i)
+            {
+                hashes[i] = key_hash(i, seed_);
+                buckets[hashes[i] % num_buckets].push_back(i);
+            }
+
+            // Large buckets are the hardest to place, so they go first while most slots are free
+            for (uint32_t b = 0; b < num_buckets; ++b)
+                bucket_order[b] = b;
+            std::sort(bucket_order.begin(), bucket_order.end(), [&](uint32_t lhs, uint32_t rhs) {
+                return buckets[lhs].size() > buckets[rhs].size();
+            });
+
+            displacements_.assign(num_buckets, 0);
+            slots_.assign(num_slots, npos);
+
+            bool placed = true;
+            for (const uint32_t b : bucket_order)
+            {
+                if (buckets[b].empty())
+                    break;
+
+                placed = place(buckets[b], hashes, displacements_[b], bucket_slots);
+                if (!placed)
+                    break;
+            }
+
+            if (placed)
+                return;
+        }
+    }
+
+    // Seed the keys have to be hashed with for find()
+    [[nodiscard]] uint64_t seed() const noexcept
+    {
+        return seed_;
+    }
+
+    // Returns the index of the only key which can match the hash, npos if there is none
+    [[nodiscard]] uint32_t find(uint64_t hash) const noexcept
+    {
+        if (slots_.empty())
+            return npos;
+
+        const uint32_t displacement = displacements_[hash % displacements_.size()];
+        return slots_[slot(hash, displacement, slots_.size())];
+    }
+
+  private:
+    static constexpr size_t keys_per_bucket = 4;
+
+    // Number of displacements tried for a bucket before the keys are hashed with another seed
+    static constexpr uint32_t max_displacement = 1u << 16;
+
+    static size_t slot(uint64_t hash, uint32_t displacement, size_t num_slots) noexcept
+    {
+        // splitmix64 finalizer, so every displacement scatters the keys of a bucket independently
+        uint64_t x = hash ^ (displacement * 0x9e3779b97f4a7c15ull);
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return static_cast<size_t>((x ^ (x >> 31)) % num_slots);
+    }
+
+    bool place(const std::vector<uint32_t>& bucket, const std::vector<uint64_t>& hashes, uint32_t& displacement,
+               std::vector<uint32_t>& bucket_slots)
+    {
+        for (displacement = 0; displacement < max_displacement; ++displacement)
+        {
+            bucket_slots.clear();
+            for (const uint32_t key : bucket)
+            {
+                const size_t s = slot(hashes[key], displacement, slots_.size());
+                if (slots_[s] != npos || std::find(bucket_slots.begin(), bucket_slots.end(), s) != bucket_slots.end())
+                    break;
+                bucket_slots.push_back(static_cast<uint32_t>(s));
+            }
+
+            if (bucket_slots.size() == bucket.size())
+            {
+                for (size_t i = 0; i < bucket.size(); ++i)
+                    slots_[bucket_slots[i]] = bucket[i];
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    uint64_t seed_ = 0;
+    std::vector<uint32_t> displacements_;
+    std::vector<uint32_t> slots_;
+};
+} // namespace datastore::detail
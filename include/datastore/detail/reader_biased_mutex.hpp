@@ -0,0 +1,214 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <thread>
+
+namespace datastore::detail
+{
+// Objects written by different threads are aligned to the cache line size to avoid false sharing
+constexpr size_t cache_line_size = 64;
+
+// Reader-writer lock biased towards readers
+// Implementation is based on "BRAVO - Biased Locking for Reader-Writer Locks" by D. Dice and A. Kogan
+// While the lock is biased, readers announce themselves in a table shared by all locks
+// instead of updating the reader count of the lock, so readers running on different CPUs
+// don't bounce the cache line of the lock between each other.
+// Writers revoke the bias and wait for the announced readers to leave, which makes writes slower.
+// The bias is not restored for a while after a revocation, so locks that are written often
+// behave like the underlying std::shared_mutex.
+class alignas(cache_line_size) reader_biased_mutex
+{
+  public:
+    reader_biased_mutex() = default;
+
+    reader_biased_mutex(const reader_biased_mutex& other) = delete;
+    reader_biased_mutex& operator=(const reader_biased_mutex& rhs) = delete;
+
+    void lock()
+    {
+        mutex_.lock();
+        revoke_bias();
+    }
+
+    bool try_lock()
+    {
+        if (!mutex_.try_lock())
+            return false;
+
+        if (!try_revoke_bias())
+        {
+            mutex_.unlock();
+            return false;
+        }
+        return true;
+    }
+
+    void unlock()
+    {
+        mutex_.unlock();
+    }
+
+    void lock_shared()
+    {
+        if (try_lock_biased())
+            return;
+
+        mutex_.lock_shared();
+        restore_bias();
+    }
+
+    bool try_lock_shared()
+    {
+        if (try_lock_biased())
+            return true;
+
+        if (!mutex_.try_lock_shared())
+            return false;
+
+        restore_bias();
+        return true;
+    }
+
+    void unlock_shared()
+    {
+        if (!unlock_biased())
+            mutex_.unlock_shared();
+    }
+
+  private:
+    static constexpr size_t num_reader_slots = 4096;
+
+    // Writes are at least this many times longer than the last revocation before the bias is restored
+    static constexpr int64_t inhibit_multiplier = 9;
+
+    // Maximum number of locks a thread can hold through the reader table at the same time
+    // A thread holding more locks takes the rest of them through the underlying mutex
+    static constexpr size_t max_biased_locks_per_thread = 16;
+
+    struct held_lock
+    {
+        const reader_biased_mutex* lock;
+        std::atomic<const reader_biased_mutex*>* slot;
+    };
+
+    struct thread_state
+    {
+        std::array<held_lock, max_biased_locks_per_thread> held;
+        size_t num_held = 0;
+    };
+
+    bool try_lock_biased()
+    {
+        if (!biased_.load(std::memory_order_acquire))
+            return false;
+
+        thread_state& state = local_thread_state();
+        if (state.num_held == state.held.size())
+            return false;
+
+        std::atomic<const reader_biased_mutex*>& slot = reader_slots_[slot_index(state)];
+        const reader_biased_mutex* expected = nullptr;
+        if (!slot.compare_exchange_strong(expected, this))
+            return false;
+
+        // A writer might have revoked the bias before seeing the slot, in which case it doesn't wait for this reader
+        if (!biased_.load())
+        {
+            slot.store(nullptr);
+            return false;
+        }
+
+        state.held[state.num_held++] = {this, &slot};
+        return true;
+    }
+
+    bool unlock_biased()
+    {
+        thread_state& state = local_thread_state();
+        for (size_t i = state.num_held; i-- > 0;)
+        {
+            if (state.held[i].lock != this)
+                continue;
+
+            state.held[i].slot->store(nullptr);
+            state.held[i] = state.held[--state.num_held];
+            return true;
+        }
+        return false;
+    }
+
+    // Called holding the underlying mutex exclusively
+    void revoke_bias()
+    {
+        if (!biased_.load(std::memory_order_relaxed))
+            return;
+
+        biased_.store(false);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (const std::atomic<const reader_biased_mutex*>& slot : reader_slots_)
+        {
+            while (slot.load() == this)
+                std::this_thread::yield();
+        }
+        const auto now = std::chrono::steady_clock::now();
+
+        inhibit_until_ = now + (now - start) * inhibit_multiplier;
+    }
+
+    // Same as revoke_bias but keeps the bias instead of waiting if there are readers
+    bool try_revoke_bias()
+    {
+        if (!biased_.load(std::memory_order_relaxed))
+            return true;
+
+        biased_.store(false);
+
+        for (const std::atomic<const reader_biased_mutex*>& slot : reader_slots_)
+        {
+            if (slot.load() == this)
+            {
+                biased_.store(true);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Called holding the underlying mutex shared, so writers can't change the bias meanwhile
+    void restore_bias()
+    {
+        if (biased_.load(std::memory_order_relaxed))
+            return;
+
+        if (std::chrono::steady_clock::now() >= inhibit_until_)
+            biased_.store(true);
+    }
+
+    static thread_state& local_thread_state()
+    {
+        static thread_local thread_state state;
+        return state;
+    }
+
+    size_t slot_index(const thread_state& state) const
+    {
+        // Slot depends on both the lock and the thread, so readers of the same lock use different slots
+        const auto lock_bits = reinterpret_cast<uintptr_t>(this);
+        const auto thread_bits = reinterpret_cast<uintptr_t>(&state);
+        const uint64_t mixed = (lock_bits ^ (thread_bits * 0x9e3779b97f4a7c15ull)) * 0xff51afd7ed558ccdull;
+        return static_cast<size_t>(mixed >> 32) % num_reader_slots;
+    }
+
+    std::shared_mutex mutex_;
+    std::atomic_bool biased_ = true;
+    std::chrono::steady_clock::time_point inhibit_until_;
+
+    static inline std::array<std::atomic<const reader_biased_mutex*>, num_reader_slots> reader_slots_{};
+};
+} // namespace datastore::detail
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "datastore/detail/epoch.hpp"
+#include "datastore/detail/version_clock.hpp"
+
+namespace datastore::detail
+{
+// Background thread tearing down detached subtrees
+// Tasks are run one by one in the order they were deferred, so a subtree detached later is torn down later
+class reclaimer
+{
+  public:
+    static reclaimer& instance()
+    {
+        static reclaimer r;
+        return r;
+    }
+
+    reclaimer(const reclaimer& other) = delete;
+    reclaimer& operator=(const reclaimer& rhs) = delete;
+
+    ~reclaimer()
+    {
+        // Tasks deferred before the exit are still run
+        {
+            std::scoped_lock lock(mutex_);
+            done_ = true;
+        }
+        wake_.notify_all();
+
+        thread_.join();
+    }
+
+    void defer(std::function<void()> task)
+    {
+        {
+            std::scoped_lock lock(mutex_);
+            tasks_.push_back(std::move(task));
+        }
+        wake_.notify_all();
+    }
+
+    // Blocks until all tasks deferred so far have been run
+    // Returns right away when called by a task, the worker can't wait for itself
+    void wait_idle()
+    {
+        if (std::this_thread::get_id() == thread_.get_id())
+            return;
+
+        std::unique_lock lock(mutex_);
+        idle_.wait(lock, [&]() {
+            return tasks_.empty() && !busy_;
+        });
+    }
+
+  private:
+    reclaimer()
+    {
+        // Tasks retire objects and write nodes, so the singletons they use must outlive the reclaimer
+        epoch_domain::instance();
+        version_clock::instance();
+
+        thread_ = std::thread(&reclaimer::worker_thread, this);
+    }
+
+    void worker_thread()
+    {
+        std::unique_lock lock(mutex_);
+        while (true)
+        {
+            wake_.wait(lock, [&]() {
+                return done_ || !tasks_.empty();
+            });
+            if (tasks_.empty())
+                return;
+
+            std::function<void()> task = std::move(tasks_.front());
+            tasks_.pop_front();
+            busy_ = true;
+
+            lock.unlock();
+            task();
+            // Objects captured by the task are released on this thread too
+            task = nullptr;
+            lock.lock();
+
+            busy_ = false;
+            if (tasks_.empty())
+                idle_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::deque<std::function<void()>> tasks_;
+    bool busy_ = false;
+    bool done_ = false;
+    std::thread thread_;
+};
+} // namespace datastore::detail
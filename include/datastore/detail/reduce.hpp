@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace datastore::detail
+{
+// Reduction kernels over contiguous buffers
+// Several independent accumulators break the dependency chain between iterations,
+// so the compiler can keep them in vector registers and the CPU can run the operations in parallel.
+constexpr size_t reduce_num_lanes = 8;
+
+template <typename T>
+T reduce_sum(const T* data, size_t size)
+{
+    T lanes[reduce_num_lanes] = {};
+
+    size_t i = 0;
+    for (; i + reduce_num_lanes <= size; i += reduce_num_lanes)
+    {
+        for (size_t lane = 0; lane < reduce_num_lanes; ++lane)
+            lanes[lane] += data[i + lane];
+    }
+    for (; i < size; ++i)
+        lanes[0] += data[i];
+
+    // Pairwise combination keeps the rounding error of floating point sums low
+    for (size_t width = reduce_num_lanes / 2; width > 0; width /= 2)
+    {
+        for (size_t lane = 0; lane < width; ++lane)
+            lanes[lane] += lanes[lane + width];
+    }
+    return lanes[0];
+}
+
+template <typename T, typename Select>
+T reduce_select(const T* data, size_t size, Select select)
+{
+    // Callers guarantee that the buffer is not empty
+    T lanes[reduce_num_lanes];
+    std::fill(std::begin(lanes), std::end(lanes), data[0]);
+
+    size_t i = 0;
+    for (; i + reduce_num_lanes <= size; i += reduce_num_lanes)
+    {
+        for (size_t lane = 0; lane < reduce_num_lanes; ++lane)
+            lanes[lane] = select(lanes[lane], data[i + lane]);
+    }
+    for (; i < size; ++i)
+        lanes[0] = select(lanes[0], data[i]);
+
+    for (size_t lane = 1; lane < reduce_num_lanes; ++lane)
+        lanes[0] = select(lanes[0], lanes[lane]);
+    return lanes[0];
+}
+
+template <typename T>
+T reduce_min(const T* data, size_t size)
+{
+    return reduce_select(data, size, [](T lhs, T rhs) {
+        return rhs < lhs ? rhs : lhs;
+    });
+}
+
+template <typename T>
+T reduce_max(const T* data, size_t size)
+{
+    return reduce_select(data, size, [](T lhs, T rhs) {
+        return lhs < rhs ? rhs : lhs;
+    });
+}
+} // namespace datastore::detail
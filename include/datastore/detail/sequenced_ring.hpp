@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "datastore/detail/lock_pool.hpp"
+
+namespace datastore::detail
+{
+// Ring keeping the latest records appended by any number of writers
+// Every record gets the next sequence number, readers copy the records out starting from any sequence number
+// and learn that the records they haven't read yet have been overwritten instead of reading them out of order.
+// The ring is not lock-free: every slot has a mutex from the lock pool, which appending and reading a record take,
+// so records holding strings are copied safely. Appending doesn't allocate and only the writers and readers
+// of the same slot wait for each other, the order of the appends is up to the callers, see volume_context.
+template <typename T>
+class sequenced_ring
+{
+  public:
+    enum class read_status : uint8_t
+    {
+        // All records published so far have been read or the maximum number of records has been reached
+        done,
+
+        // Some of the requested records have been overwritten already
+        overflow
+    };
+
+    sequenced_ring() = default;
+
+    sequenced_ring(const sequenced_ring& other) = delete;
+    sequenced_ring& operator=(const sequenced_ring& rhs) = delete;
+
+    ~sequenced_ring()
+    {
+        delete buffer_.load();
+    }
+
+    // Allocates the slots, the capacity is rounded up to the next power of two
+    // Fails if the ring has been enabled already
+    bool enable(size_t capacity)
+    {
+        if (capacity == 0 || enabled())
+            return false;
+
+        size_t rounded_capacity = 1;
+        while (rounded_capacity < capacity)
+            rounded_capacity <<= 1;
+
+        auto* b = new buffer(rounded_capacity);
+        buffer* expected = nullptr;
+        if (!buffer_.compare_exchange_strong(expected, b))
+        {
+            delete b;
+            return false;
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] bool enabled() const noexcept
+    {
+        return buffer_.load() != nullptr;
+    }
+
+    // Sequence number the next appended record will get
+    [[nodiscard]] uint64_t end() const noexcept
+    {
+        return next_.load();
+    }
+
+    // Appends the record to an enabled ring and returns its sequence number
+    uint64_t append(T value)
+    {
+        buffer* b = buffer_.load();
+        const uint64_t sequence = next_.fetch_add(1);
+
+        slot& s = b->slots[sequence & b->mask];
+        std::scoped_lock lock(s.mutex);
+
+        // A writer which got a later sequence number has lapped this one, the record is overwritten already
+        if (s.stamp > sequence + 1)
+            return sequence;
+
+        s.value = std::move(value);
+        s.stamp = sequence + 1;
+
+        return sequence;
+    }
+
+    // Copies at most max_count records starting from the given position and advances the position past them
+    // Reading stops at a record which has been assigned a sequence number but not published yet.
+    // The function is called with the slot of the record locked, so it must not append to the ring.
+    template <typename Function>
+    read_status read(uint64_t& position, size_t max_count, Function f) const
+    {
+        const buffer* b = buffer_.load();
+        if (!b)
+            return read_status::done;
+
+        const uint64_t end = next_.load();
+        if (end > b->mask + 1 && position < end - (b->mask + 1))
+            return read_status::overflow;
+
+        for (size_t count = 0; count < max_count && position < end; ++count)
+        {
+            slot& s = b->slots[position & b->mask];
+            std::scoped_lock lock(s.mutex);
+            if (s.stamp <= position)
+                break;
+            if (s.stamp > position + 1)
+                return read_status::overflow;
+
+            f(position, std::as_const(s.value));
+            ++position;
+        }
+
+        return read_status::done;
+    }
+
+  private:
+    struct slot
+    {
+        pooled_mutex<std::mutex> mutex;
+
+        // Sequence number of the record plus one, zero while the slot has never been written
+        uint64_t stamp = 0;
+        T value;
+    };
+
+    struct buffer
+    {
+        explicit buffer(size_t capacity)
+            : mask(capacity - 1),
+              slots(new slot[capacity]())
+        {
+        }
+
+        size_t mask;
+        std::unique_ptr<slot[]> slots;
+    };
+
+    std::atomic<buffer*> buffer_ = nullptr;
+    std::atomic<uint64_t> next_ = 0;
+};
+} // namespace datastore::detail
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace datastore::detail
+{
+// Elements of a striped_hashmap sorted by name, e.g. the subnodes of a node
+// The sorted copy is reused until keys of the map change, so repeated ordered scans don't sort the elements again.
+// Scans iterate over an immutable copy, so no locks are held while the callbacks are called
+// and concurrent insertions into the map are never blocked by them.
+template <typename Value>
+class sorted_index
+{
+  public:
+    explicit sorted_index(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource_(resource)
+    {
+    }
+
+    sorted_index(const sorted_index& other) = delete;
+
+    sorted_index(sorted_index&& other) noexcept
+        : resource_(other.resource_),
+          entries_(std::move(other.entries_)),
+          generation_(other.generation_)
+    {
+    }
+
+    sorted_index& operator=(const sorted_index& rhs) = delete;
+
+    sorted_index& operator=(sorted_index&& rhs) noexcept
+    {
+        resource_ = rhs.resource_;
+        entries_ = std::move(rhs.entries_);
+        generation_ = rhs.generation_;
+
+        return *this;
+    }
+
+    // Calls the function for the elements in the name order starting with the given name
+    // The name itself is skipped if the start is exclusive, the iteration stops once the function returns false
+    template <typename Map, typename Function>
+    void for_each_from(const Map& map, std::string_view name, bool inclusive, Function f) const
+    {
+        const std::shared_ptr<const entries> sorted = sorted_entries(map);
+
+        auto it = inclusive ? std::lower_bound(sorted->begin(), sorted->end(), name, name_less())
+                            : std::upper_bound(sorted->begin(), sorted->end(), name, name_less());
+        for (; it != sorted->end(); ++it)
+        {
+            if (!f(*it))
+                break;
+        }
+    }
+
+    // Drops the sorted copy, so it doesn't keep the removed elements alive
+    void reset()
+    {
+        std::scoped_lock lock(mutex_);
+        entries_.reset();
+    }
+
+  private:
+    using entries = std::pmr::vector<Value>;
+
+    struct name_less
+    {
+        bool operator()(const Value& lhs, std::string_view rhs) const
+        {
+            return lhs->name() < rhs;
+        }
+
+        bool operator()(std::string_view lhs, const Value& rhs) const
+        {
+            return lhs < rhs->name();
+        }
+
+        bool operator()(const Value& lhs, const Value& rhs) const
+        {
+            return lhs->name() < rhs->name();
+        }
+    };
+
+    template <typename Map>
+    std::shared_ptr<const entries> sorted_entries(const Map& map) const
+    {
+        const uint64_t generation = map.generation();
+        {
+            std::scoped_lock lock(mutex_);
+            if (entries_ && generation_ == generation)
+                return entries_;
+        }
+
+        // Sorting happens outside of the lock, concurrent scans might sort the same elements at worst
+        // The vector gets the memory resource from the allocator through uses-allocator construction
+        std::shared_ptr<entries> sorted =
+            std::allocate_shared<entries>(std::pmr::polymorphic_allocator<entries>(resource_));
+        sorted->reserve(map.size());
+        map.for_each([&](const Value& value) {
+            sorted->push_back(value);
+        });
+        std::sort(sorted->begin(), sorted->end(), name_less());
+
+        // Keys that changed while sorting make the copy outdated, it's not kept then
+        // Checked under the lock, so a copy made before a removal can't be kept after reset()
+        std::scoped_lock lock(mutex_);
+        if (map.generation() == generation)
+        {
+            entries_ = sorted;
+            generation_ = generation;
+        }
+
+        return sorted;
+    }
+
+    std::pmr::memory_resource* resource_;
+    mutable std::mutex mutex_;
+    mutable std::shared_ptr<const entries> entries_;
+    mutable uint64_t generation_ = 0;
+};
+} // namespace datastore::detail
@@ -2,6 +2,7 @@
 
 #include <atomic>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
 
 namespace datastore::detail
@@ -11,15 +12,33 @@ namespace datastore::detail
 template <typename T, typename Compare = std::less<T>>
 class sorted_list
 {
+    struct node;
+
+    // Returns list nodes to the memory resource they were allocated from
+    struct node_deleter
+    {
+        std::pmr::memory_resource* resource;
+
+        void operator()(node* n) const
+        {
+            std::pmr::polymorphic_allocator<node> alloc(resource);
+            n->~node();
+            alloc.deallocate(n, 1);
+        }
+    };
+
+    using node_ptr = std::unique_ptr<node, node_deleter>;
+
     struct node
     {
-        node()
-            : next()
+        explicit node(std::pmr::memory_resource* resource)
+            : next(nullptr, node_deleter{resource})
         {
         }
 
-        node(T const& value)
-            : data(std::make_shared<T>(value))
+        node(T const& value, std::pmr::memory_resource* resource)
+            : data(std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(resource), value)),
+              next(nullptr, node_deleter{resource})
         {
         }
 
@@ -31,19 +50,25 @@ class sorted_list
 
         std::mutex m;
         std::shared_ptr<T> data;
-        std::unique_ptr<node> next;
+        node_ptr next;
     };
 
   public:
-    sorted_list(const Compare& comp = Compare())
-        : comp_(comp)
+    // List nodes and elements are allocated from the given memory resource
+    // The memory resource must outlive the list
+    explicit sorted_list(const Compare& comp = Compare(),
+                         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource_(resource),
+          head_(make_node()),
+          comp_(comp)
     {
     }
 
     sorted_list(sorted_list const& other) = delete;
 
     sorted_list(sorted_list&& other) noexcept
-        : head_(std::move(other.head_)),
+        : resource_(other.resource_),
+          head_(std::move(other.head_)),
           comp_(std::move(other.comp_)),
           num_elements_(other.num_elements_.load())
     {
@@ -53,6 +78,7 @@ class sorted_list
 
     sorted_list& operator=(sorted_list&& other) noexcept
     {
+        resource_ = other.resource_;
         head_ = std::move(other.head_);
         comp_ = std::move(other.comp_);
         num_elements_ = other.num_elements_.load();
@@ -62,7 +88,7 @@ class sorted_list
 
     void push(T const& value)
     {
-        std::unique_ptr<node> new_node(new node(value));
+        node_ptr new_node = make_node(value);
 
         node* current = head_.get();
         std::unique_lock<std::mutex> lk(head_->m);
@@ -84,6 +110,35 @@ class sorted_list
         ++num_elements_;
     }
 
+    // Inserts the value unless an equivalent one is already in the list
+    bool push_unique(T const& value)
+    {
+        node* current = head_.get();
+        std::unique_lock<std::mutex> lk(head_->m);
+        while (node* const next = current->next.get())
+        {
+            std::unique_lock<std::mutex> next_lk(next->m);
+            if (comp_(value, *next->data))
+            {
+                break;
+            }
+            if (!comp_(*next->data, value))
+            {
+                return false;
+            }
+            lk.unlock();
+            current = next;
+            lk = std::move(next_lk);
+        }
+
+        node_ptr new_node = make_node(value);
+        new_node->next = std::move(current->next);
+        current->next = std::move(new_node);
+
+        ++num_elements_;
+        return true;
+    }
+
     std::shared_ptr<T> front()
     {
         node* current = head_.get();
@@ -146,7 +201,7 @@ class sorted_list
             std::unique_lock<std::mutex> next_lk(next->m);
             if (p(*next->data))
             {
-                std::unique_ptr<node> old_next = std::move(current->next);
+                node_ptr old_next = std::move(current->next);
                 current->next = std::move(next->next);
                 next_lk.unlock();
                 --num_elements_;
@@ -161,7 +216,17 @@ class sorted_list
     }
 
   private:
-    std::unique_ptr<node> head_ = std::make_unique<node>();
+    template <typename... Args>
+    node_ptr make_node(Args&&... args)
+    {
+        std::pmr::polymorphic_allocator<node> alloc(resource_);
+        node* n = alloc.allocate(1);
+        new (n) node(std::forward<Args>(args)..., resource_);
+        return node_ptr(n, node_deleter{resource_});
+    }
+
+    std::pmr::memory_resource* resource_;
+    node_ptr head_;
     Compare comp_;
     std::atomic_size_t num_elements_ = 0;
 };
@@ -1,20 +1,39 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
 #include <functional>
-#include <optional>
 #include <list>
 #include <memory>
+#include <memory_resource>
 #include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <utility>
 #include <vector>
 
+#include "datastore/detail/lock_pool.hpp"
+
 namespace datastore::detail
 {
+// Called by write operations of striped_hashmap under the bucket lock before a value is written
+// Receives the key, the value about to be overwritten or erased, nullptr for an insertion,
+// and the value being written, nullptr for an erasure
+struct ignore_write
+{
+    template <typename Key, typename Value>
+    void operator()(const Key&, const Value*, const Value*) const
+    {
+    }
+};
+
 // Implementation is based on the fine-grained locking lookup table implementation
 // from Chapter 6 of "C++ Concurrency in Action" by A. Williams
-template <typename Key, typename Value>
+// Mutex protects a bucket, it can be any type meeting the SharedMutex requirements, e.g. reader_biased_mutex
+// Buckets are allocated on the first insertion, so an empty map doesn't allocate any memory.
+// With pooled_mutex buckets don't own their locks, but a bucket lock must not be held while taking another one.
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename Mutex = std::shared_mutex>
 class striped_hashmap
 {
   private:
@@ -24,19 +43,26 @@ class striped_hashmap
         friend class striped_hashmap;
 
         using bucket_value = std::pair<Key, Value>;
-        using bucket_data = std::list<bucket_value>;
+        using bucket_data = std::pmr::list<bucket_value>;
+
+        explicit bucket_type(std::pmr::memory_resource* resource)
+            : data(resource)
+        {
+        }
 
         bucket_data data;
-        mutable std::shared_mutex mutex;
+        mutable Mutex mutex;
 
-        auto find_entry_for(Key const& key)
+        template <typename K>
+        auto find_entry_for(K const& key)
         {
             return std::find_if(data.begin(), data.end(), [&](bucket_value const& item) {
                 return item.first == key;
             });
         }
 
-        auto find_entry_for(Key const& key) const
+        template <typename K>
+        auto find_entry_for(K const& key) const
         {
             return std::find_if(data.begin(), data.end(), [&](bucket_value const& item) {
                 return item.first == key;
@@ -44,19 +70,32 @@ class striped_hashmap
         }
 
       public:
-        std::optional<Value> value_for(Key const& key) const
+        template <typename K, typename Function>
+        bool visit(K const& key, Function& f) const
+        {
+            std::shared_lock lock(mutex);
+            auto found_entry = find_entry_for(key);
+            if (found_entry == data.end())
+                return false;
+
+            f(found_entry->second);
+            return true;
+        }
+
+        template <typename K>
+        std::optional<Value> value_for(K const& key) const
         {
             std::shared_lock lock(mutex);
             auto found_entry = find_entry_for(key);
             return (found_entry == data.end()) ? std::nullopt : std::make_optional<Value>(found_entry->second);
         }
 
-        template <typename K, typename V>
-        std::pair<Value, bool> find_or_insert_with_limit(K&& key, V&& value, std::atomic_size_t& cur_size,
-                                                         size_t max_size)
+        template <typename K, typename Factory>
+        std::pair<Value, bool> find_or_emplace_with_limit(K&& key, Factory& make_value, std::atomic_size_t& cur_size,
+                                                          size_t max_size, std::atomic<uint64_t>& generation)
         {
             std::unique_lock lock(mutex);
-            auto found_entry = find_entry_for(std::forward<K>(key));
+            auto found_entry = find_entry_for(key);
             if (found_entry == data.end())
             {
                 // Try to atomically check if the current size is less than the limit and increment it if it is
@@ -65,18 +104,24 @@ class striped_hashmap
                     !cur_size.compare_exchange_weak(expected, expected + 1, std::memory_order_relaxed))
                     return std::make_pair<Value, bool>(Value(), false);
 
-                data.push_back(bucket_value(std::forward<K>(key), std::forward<V>(value)));
+                // Elements are constructed using the bucket memory resource
+                const bucket_value& entry = data.emplace_back(std::forward<K>(key), make_value());
+                ++generation;
+                return std::pair<Value, bool>(entry.second, true);
             }
 
-            auto entry = find_entry_for(std::forward<K>(key));
-            return std::pair<Value, bool>(entry->second, true);
+            return std::pair<Value, bool>(found_entry->second, true);
         }
 
-        template <typename K, typename V>
-        bool assign_or_insert_with_limit(K&& key, V&& value, std::atomic_size_t& cur_size, size_t max_size)
+        template <typename K, typename V, typename Predicate, typename OnWrite>
+        bool assign_or_insert_with_limit(K&& key, V&& value, std::atomic_size_t& cur_size, size_t max_size,
+                                         std::atomic<uint64_t>& generation, Predicate& accept, OnWrite& on_write)
         {
             std::unique_lock lock(mutex);
-            auto found_entry = find_entry_for(std::forward<K>(key));
+            if (!accept())
+                return false;
+
+            auto found_entry = find_entry_for(key);
             if (found_entry == data.end())
             {
                 // Try to atomically check if the current size is less than the limit and increment it if it is
@@ -85,21 +130,53 @@ class striped_hashmap
                     !cur_size.compare_exchange_weak(expected, expected + 1, std::memory_order_relaxed))
                     return false;
 
-                data.push_back(bucket_value(std::forward<K>(key), std::forward<V>(value)));
+                on_write(key, static_cast<const Value*>(nullptr), &static_cast<const Value&>(value));
+                data.emplace_back(std::forward<K>(key), std::forward<V>(value));
+                ++generation;
             }
             else
             {
+                on_write(found_entry->first, &found_entry->second, &static_cast<const Value&>(value));
                 found_entry->second = std::forward<V>(value);
             }
             return true;
         }
 
-        size_t remove_mapping(Key const& key)
+        template <typename K>
+        std::optional<Value> extract_mapping(K const& key)
+        {
+            std::unique_lock lock(mutex);
+            auto found_entry = find_entry_for(key);
+            if (found_entry == data.end())
+                return std::nullopt;
+
+            std::optional<Value> value = std::move(found_entry->second);
+            data.erase(found_entry);
+            return value;
+        }
+
+        template <typename K, typename OnWrite>
+        size_t remove_mapping(K const& key, OnWrite& on_write)
         {
             std::unique_lock lock(mutex);
             auto found_entry = find_entry_for(key);
             if (found_entry != data.end())
             {
+                on_write(found_entry->first, &found_entry->second, static_cast<const Value*>(nullptr));
+                data.erase(found_entry);
+                return 1;
+            }
+            return 0;
+        }
+
+        template <typename K, typename Predicate, typename OnWrite>
+        size_t remove_mapping_if(K const& key, Predicate& p, OnWrite& on_write)
+        {
+            std::unique_lock lock(mutex);
+            auto found_entry = find_entry_for(key);
+            if (found_entry != data.end() && p(found_entry->second))
+            {
+                on_write(found_entry->first, &found_entry->second, static_cast<const Value*>(nullptr));
                 data.erase(found_entry);
                 return 1;
             }
@@ -111,20 +188,23 @@ class striped_hashmap
     using key_type = Key;
     using mapped_type = Value;
 
-    striped_hashmap(unsigned num_buckets = 13)
-        : buckets_(num_buckets)
+    // Buckets and elements are allocated from the given memory resource
+    // The memory resource must outlive the map
+    explicit striped_hashmap(unsigned num_buckets = 13,
+                             std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : resource_(resource),
+          num_buckets_(num_buckets)
     {
-        for (unsigned i = 0; i < num_buckets; ++i)
-        {
-            buckets_[i].reset(new bucket_type);
-        }
     }
 
     striped_hashmap(striped_hashmap const& other) = delete;
 
     striped_hashmap(striped_hashmap&& other) noexcept
-        : buckets_(std::move(other.buckets_)),
-          num_elements_(other.num_elements_.load())
+        : resource_(other.resource_),
+          buckets_(other.buckets_.exchange(nullptr)),
+          num_buckets_(std::exchange(other.num_buckets_, 0)),
+          num_elements_(other.num_elements_.load()),
+          generation_(other.generation_.load())
     {
     }
 
@@ -132,53 +212,276 @@ class striped_hashmap
 
     striped_hashmap& operator=(striped_hashmap&& other) noexcept
     {
-        buckets_ = std::move(other.buckets_);
+        destroy_buckets();
+
+        resource_ = other.resource_;
+        buckets_ = other.buckets_.exchange(nullptr);
+        num_buckets_ = std::exchange(other.num_buckets_, 0);
         num_elements_ = other.num_elements_.load();
+        generation_ = other.generation_.load();
 
         return *this;
     }
 
-    [[nodiscard]] std::optional<Value> find(Key const& key) const
+    ~striped_hashmap()
     {
-        return bucket(key).value_for(key);
+        destroy_buckets();
     }
 
-    template <typename K, typename V>
-    bool assign_or_insert_with_limit(K&& key, V&& value, size_t max_num_elements)
+    template <typename K>
+    [[nodiscard]] std::optional<Value> find(K const& key) const
+    {
+        return find(key, Hash{}(key));
+    }
+
+    // Looks up a key using a hash computed in advance, the hash must match the one produced by Hash
+    // Key can be of any type comparable with the Key, e.g. std::string_view for std::string
+    template <typename K>
+    [[nodiscard]] std::optional<Value> find(K const& key, size_t hash) const
+    {
+        const bucket_type* b = find_bucket(hash);
+        return b ? b->value_for(key) : std::nullopt;
+    }
+
+    // Calls the function with the value associated with the key without copying the value
+    // The function is called under the bucket lock, so it must not access the map
+    template <typename K, typename Function>
+    bool visit(K const& key, size_t hash, Function f) const
+    {
+        const bucket_type* b = find_bucket(hash);
+        return b && b->visit(key, f);
+    }
+
+    // Write operations accept a function which is called under the bucket lock before a value is written,
+    // see ignore_write
+    template <typename K, typename V, typename OnWrite = ignore_write>
+    bool assign_or_insert_with_limit(K&& key, V&& value, size_t max_num_elements,
+                                     OnWrite on_write = OnWrite())
+    {
+        const auto accept = []() {
+            return true;
+        };
+        bucket_type& b = insertion_bucket(Hash{}(key));
+        return b.assign_or_insert_with_limit(std::forward<K>(key), std::forward<V>(value), num_elements_,
+                                             max_num_elements, generation_, accept, on_write);
+    }
+
+    // Same as assign_or_insert_with_limit(), but writes nothing unless the predicate called under the bucket lock
+    // agrees, e.g. a cache doesn't take an entry for an object invalidated by a writer erasing it under the same lock
+    template <typename K, typename V, typename Predicate>
+    bool assign_or_insert_if(K&& key, V&& value, size_t max_num_elements, Predicate accept)
+    {
+        ignore_write on_write;
+        bucket_type& b = insertion_bucket(Hash{}(key));
+        return b.assign_or_insert_with_limit(std::forward<K>(key), std::forward<V>(value), num_elements_,
+                                             max_num_elements, generation_, accept, on_write);
+    }
+
+    // Erases the oldest mapping of the next non-empty bucket, buckets take turns so every mapping gets evicted in time
+    // Holds a single bucket lock at a time, returns false if there was nothing to erase
+    bool evict_one()
     {
-        return bucket(key).assign_or_insert_with_limit(std::forward<K>(key), std::forward<V>(value), num_elements_,
-                                                       max_num_elements);
+        bucket_type* buckets = buckets_.load();
+        if (!buckets)
+            return false;
+
+        for (unsigned i = 0; i < num_buckets_; ++i)
+        {
+            bucket_type& b = buckets[next_eviction_.fetch_add(1, std::memory_order_relaxed) % num_buckets_];
+            std::unique_lock lock(b.mutex);
+            if (b.data.empty())
+                continue;
+
+            b.data.pop_front();
+            --num_elements_;
+            ++generation_;
+            return true;
+        }
+
+        return false;
     }
 
     template <typename K, typename V>
     std::pair<Value, bool> find_or_insert_with_limit(K&& key, V&& value, size_t max_num_elements)
     {
-        return bucket(key).find_or_insert_with_limit(std::forward<K>(key), std::forward<V>(value), num_elements_,
-                                                     max_num_elements);
+        return find_or_emplace_with_limit(
+            std::forward<K>(key),
+            [&]() -> V&& {
+                return std::forward<V>(value);
+            },
+            max_num_elements);
+    }
+
+    // Same as find_or_insert_with_limit(), but the value is made by the factory only if the key is not found,
+    // so finding an existing mapping doesn't construct anything. The factory is called with the bucket lock held.
+    template <typename K, typename Factory>
+    std::pair<Value, bool> find_or_emplace_with_limit(K&& key, Factory make_value, size_t max_num_elements)
+    {
+        bucket_type& b = insertion_bucket(Hash{}(key));
+        return b.find_or_emplace_with_limit(std::forward<K>(key), make_value, num_elements_, max_num_elements,
+                                            generation_);
+    }
+
+    template <typename K, typename OnWrite = ignore_write>
+    size_t erase(K const& key, OnWrite on_write = OnWrite())
+    {
+        bucket_type* b = find_bucket(Hash{}(key));
+        const size_t num_deleted = b ? b->remove_mapping(key, on_write) : 0;
+        if (num_deleted > 0)
+        {
+            --num_elements_;
+            ++generation_;
+        }
+
+        return num_deleted;
     }
 
-    size_t erase(Key const& key)
+    // Removes the mapping only if the predicate accepts its value, e.g. if the key hasn't been reused since
+    template <typename K, typename Predicate, typename OnWrite = ignore_write>
+    size_t erase_if(K const& key, Predicate p, OnWrite on_write = OnWrite())
     {
-        const size_t num_deleted = bucket(key).remove_mapping(key);
+        bucket_type* b = find_bucket(Hash{}(key));
+        const size_t num_deleted = b ? b->remove_mapping_if(key, p, on_write) : 0;
         if (num_deleted > 0)
+        {
             --num_elements_;
+            ++generation_;
+        }
 
         return num_deleted;
     }
 
-    void clear()
+    // Assigns, inserts or erases several mappings taking every affected bucket lock only once
+    // A mapping is erased if its update has no value, updates of the same key are applied in order
+    // Returns the number of insertions rejected because of the limit
+    template <typename K, typename V, typename OnWrite = ignore_write>
+    size_t apply_batch(std::vector<std::pair<K, std::optional<V>>> updates, size_t max_num_elements,
+                       OnWrite on_write = OnWrite())
+    {
+        const bool inserts = std::any_of(updates.begin(), updates.end(), [](const auto& update) {
+            return update.second.has_value();
+        });
+        bucket_type* buckets = inserts ? allocate_buckets() : buckets_.load();
+        if (!buckets)
+            return 0;
+
+        // Group the updates by bucket preserving their relative order
+        std::vector<std::pair<size_t, size_t>> order;
+        order.reserve(updates.size());
+        for (size_t i = 0; i < updates.size(); ++i)
+        {
+            order.emplace_back(Hash{}(updates[i].first) % num_buckets_, i);
+        }
+        std::stable_sort(order.begin(), order.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first < rhs.first;
+        });
+
+        size_t num_rejected = 0;
+        for (auto group_it = order.begin(); group_it != order.end();)
+        {
+            const size_t bucket_index = group_it->first;
+            bucket_type& b = buckets[bucket_index];
+            std::unique_lock lock(b.mutex);
+
+            for (; group_it != order.end() && group_it->first == bucket_index; ++group_it)
+            {
+                auto& [key, value] = updates[group_it->second];
+                auto found_entry = b.find_entry_for(key);
+
+                if (!value)
+                {
+                    if (found_entry != b.data.end())
+                    {
+                        on_write(found_entry->first, &found_entry->second, static_cast<const Value*>(nullptr));
+                        b.data.erase(found_entry);
+                        --num_elements_;
+                        ++generation_;
+                    }
+                }
+                else if (found_entry != b.data.end())
+                {
+                    on_write(found_entry->first, &found_entry->second, &*value);
+                    found_entry->second = std::move(*value);
+                }
+                else
+                {
+                    // Atomically increment the current size unless the limit is reached
+                    size_t expected = num_elements_.load(std::memory_order_relaxed);
+                    while (expected < max_num_elements &&
+                           !num_elements_.compare_exchange_weak(expected, expected + 1, std::memory_order_relaxed))
+                    {
+                    }
+                    if (expected >= max_num_elements)
+                    {
+                        ++num_rejected;
+                        continue;
+                    }
+
+                    on_write(key, static_cast<const Value*>(nullptr), &*value);
+                    b.data.emplace_back(std::move(key), std::move(*value));
+                    ++generation_;
+                }
+            }
+        }
+
+        return num_rejected;
+    }
+
+    // Removes the mapping and hands the value over to the caller
+    template <typename K>
+    std::optional<Value> extract(K const& key)
+    {
+        bucket_type* b = find_bucket(Hash{}(key));
+        std::optional<Value> value = b ? b->extract_mapping(key) : std::nullopt;
+        if (value)
+        {
+            --num_elements_;
+            ++generation_;
+        }
+
+        return value;
+    }
+
+    // Removes all mappings and hands the values over to the caller
+    std::vector<Value> extract_all()
     {
-        std::vector<std::unique_lock<std::shared_mutex>> locks;
-        for (unsigned i = 0; i < buckets_.size(); ++i)
+        bucket_type* buckets = buckets_.load();
+        if (!buckets)
+            return {};
+
+        const auto locks = lock_all<std::unique_lock<Mutex>>(buckets);
+
+        std::vector<Value> values;
+        values.reserve(num_elements_);
+        for (unsigned i = 0; i < num_buckets_; ++i)
         {
-            locks.push_back(std::unique_lock<std::shared_mutex>(buckets_[i]->mutex));
+            for (auto& [key, value] : buckets[i].data)
+                values.push_back(std::move(value));
+            buckets[i].data.clear();
         }
+        num_elements_ = 0;
+        ++generation_;
 
-        for (unsigned i = 0; i < buckets_.size(); ++i)
+        return values;
+    }
+
+    template <typename OnWrite = ignore_write>
+    void clear(OnWrite on_write = OnWrite())
+    {
+        bucket_type* buckets = buckets_.load();
+        if (!buckets)
+            return;
+
+        const auto locks = lock_all<std::unique_lock<Mutex>>(buckets);
+
+        for (unsigned i = 0; i < num_buckets_; ++i)
         {
-            buckets_[i]->data.clear();
+            for (const auto& [key, value] : buckets[i].data)
+                on_write(key, &value, static_cast<const Value*>(nullptr));
+            buckets[i].data.clear();
         }
         num_elements_ = 0;
+        ++generation_;
     }
 
     size_t size() const
@@ -186,18 +489,53 @@ class striped_hashmap
         return num_elements_;
     }
 
-    template <typename Function>
-    void for_each(Function f) const
+    // Changes every time a key is inserted or removed, allows caching derived data until the keys change
+    uint64_t generation() const
+    {
+        return generation_;
+    }
+
+    // Copies the values holding only one bucket lock at a time
+    // Writers of the other buckets are not blocked, but values of different buckets are copied at different moments.
+    std::vector<Value> values() const
     {
-        std::vector<std::shared_lock<std::shared_mutex>> locks;
-        for (unsigned i = 0; i < buckets_.size(); ++i)
+        const bucket_type* buckets = buckets_.load();
+        if (!buckets)
+            return {};
+
+        std::vector<Value> result;
+        result.reserve(num_elements_);
+        for (unsigned i = 0; i < num_buckets_; ++i)
         {
-            locks.push_back(std::shared_lock<std::shared_mutex>(buckets_[i]->mutex));
+            std::shared_lock lock(buckets[i].mutex);
+            for (const auto& [key, value] : buckets[i].data)
+                result.push_back(value);
         }
+        return result;
+    }
+
+    // Calls the function for copies of the values without holding any locks,
+    // so unlike for_each() the function is free to access the map or take any other locks
+    template <typename Function>
+    void for_each_snapshot(Function f) const
+    {
+        for (const Value& value : values())
+            f(value);
+    }
+
+    // Calls the function holding the locks of all buckets, so the values can't change during the iteration
+    template <typename Function>
+    void for_each(Function f) const
+    {
+        const bucket_type* buckets = buckets_.load();
+        if (!buckets)
+            return;
 
-        for (unsigned i = 0; i < buckets_.size(); ++i)
+        const auto locks = lock_all<std::shared_lock<Mutex>>(buckets);
+
+        for (unsigned i = 0; i < num_buckets_; ++i)
         {
-            for (auto it = buckets_[i]->data.cbegin(); it != buckets_[i]->data.cend(); ++it)
+            for (auto it = buckets[i].data.cbegin(); it != buckets[i].data.cend(); ++it)
             {
                 f(it->second);
             }
@@ -205,13 +543,82 @@ class striped_hashmap
     }
 
   private:
-    bucket_type& bucket(Key const& key) const
+    // Returns nullptr if nothing has been inserted into the map yet
+    bucket_type* find_bucket(size_t hash) const
+    {
+        bucket_type* buckets = buckets_.load();
+        return buckets ? &buckets[hash % num_buckets_] : nullptr;
+    }
+
+    bucket_type& insertion_bucket(size_t hash)
+    {
+        return allocate_buckets()[hash % num_buckets_];
+    }
+
+    bucket_type* allocate_buckets()
+    {
+        bucket_type* buckets = buckets_.load();
+        if (buckets)
+            return buckets;
+
+        std::pmr::polymorphic_allocator<bucket_type> alloc(resource_);
+        bucket_type* allocated = alloc.allocate(num_buckets_);
+        for (unsigned i = 0; i < num_buckets_; ++i)
+        {
+            new (allocated + i) bucket_type(resource_);
+        }
+
+        // Another writer might have allocated the buckets meanwhile, in which case its buckets are used
+        if (buckets_.compare_exchange_strong(buckets, allocated))
+            return allocated;
+
+        destroy_buckets(allocated);
+        return buckets;
+    }
+
+    // Takes the locks of all buckets, every lock is taken once even if it's shared by several buckets
+    // Locks are taken in the order of their addresses, so concurrent callers can't deadlock
+    template <typename Lock>
+    std::vector<Lock> lock_all(const bucket_type* buckets) const
+    {
+        std::vector<std::pair<const void*, unsigned>> order;
+        order.reserve(num_buckets_);
+        for (unsigned i = 0; i < num_buckets_; ++i)
+        {
+            order.emplace_back(lock_identity(buckets[i].mutex), i);
+        }
+        std::sort(order.begin(), order.end());
+
+        std::vector<Lock> locks;
+        locks.reserve(num_buckets_);
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            if (i == 0 || order[i].first != order[i - 1].first)
+                locks.emplace_back(buckets[order[i].second].mutex);
+        }
+        return locks;
+    }
+
+    void destroy_buckets(bucket_type* buckets)
+    {
+        for (unsigned i = 0; i < num_buckets_; ++i)
+        {
+            buckets[i].~bucket_type();
+        }
+        std::pmr::polymorphic_allocator<bucket_type>(resource_).deallocate(buckets, num_buckets_);
+    }
+
+    void destroy_buckets()
     {
-        std::size_t const bucket_index = std::hash<Key>{}(key) % buckets_.size();
-        return *buckets_[bucket_index];
+        if (bucket_type* buckets = buckets_.exchange(nullptr))
+            destroy_buckets(buckets);
     }
 
-    std::vector<std::unique_ptr<bucket_type>> buckets_;
+    std::pmr::memory_resource* resource_;
+    std::atomic<bucket_type*> buckets_ = nullptr;
+    unsigned num_buckets_;
     std::atomic_size_t num_elements_ = 0;
+    std::atomic<uint64_t> generation_ = 0;
+    std::atomic<unsigned> next_eviction_ = 0;
 };
 } // namespace datastore::detail
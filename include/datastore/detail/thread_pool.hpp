@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace datastore::detail
+{
+// Implementation is based on the work stealing thread pool
+// from Chapter 9 of "C++ Concurrency in Action" by A. Williams
+// Tasks submitted by a worker go to its own queue and idle workers steal tasks from the queues of others,
+// so recursive algorithms keep the work they fork on the same thread unless other threads run out of work.
+class thread_pool
+{
+  public:
+    using task_type = std::packaged_task<void()>;
+
+    // Pool shared by all parallel algorithms of the library
+    static thread_pool& instance()
+    {
+        static thread_pool pool;
+        return pool;
+    }
+
+    explicit thread_pool(unsigned num_threads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (unsigned i = 0; i < num_threads; ++i)
+            queues_.push_back(std::make_unique<work_stealing_queue>());
+
+        for (unsigned i = 0; i < num_threads; ++i)
+            threads_.emplace_back(&thread_pool::worker_thread, this, i);
+    }
+
+    thread_pool(const thread_pool& other) = delete;
+    thread_pool& operator=(const thread_pool& rhs) = delete;
+
+    ~thread_pool()
+    {
+        {
+            std::scoped_lock lock(mutex_);
+            done_ = true;
+        }
+        wake_.notify_all();
+
+        for (std::thread& t : threads_)
+            t.join();
+    }
+
+    template <typename Function>
+    std::future<void> submit(Function f)
+    {
+        task_type task(std::move(f));
+        std::future<void> result = task.get_future();
+
+        if (local_pool_ == this)
+        {
+            queues_[local_index_]->push(std::move(task));
+        }
+        else
+        {
+            std::scoped_lock lock(queue_mutex_);
+            queue_.push_back(std::move(task));
+        }
+
+        // Counted under the lock, so an idle worker can't miss the notification
+        {
+            std::scoped_lock lock(mutex_);
+            ++num_pending_;
+        }
+        wake_.notify_one();
+
+        return result;
+    }
+
+    // Runs one of the queued tasks on the calling thread, fails if there are none
+    // Threads waiting for the results of their tasks should call it instead of blocking
+    bool run_pending_task()
+    {
+        task_type task;
+        if (!pop_local_task(task) && !pop_queued_task(task) && !steal_task(task))
+            return false;
+
+        --num_pending_;
+        task();
+        return true;
+    }
+
+    [[nodiscard]] size_t num_threads() const noexcept
+    {
+        return threads_.size();
+    }
+
+  private:
+    // Owner takes the most recently pushed tasks, thieves take the oldest ones,
+    // which are usually the biggest parts of a recursively divided work
+    class work_stealing_queue
+    {
+      public:
+        void push(task_type task)
+        {
+            std::scoped_lock lock(mutex_);
+            queue_.push_front(std::move(task));
+        }
+
+        bool try_pop(task_type& task)
+        {
+            std::scoped_lock lock(mutex_);
+            if (queue_.empty())
+                return false;
+
+            task = std::move(queue_.front());
+            queue_.pop_front();
+            return true;
+        }
+
+        bool try_steal(task_type& task)
+        {
+            std::scoped_lock lock(mutex_);
+            if (queue_.empty())
+                return false;
+
+            task = std::move(queue_.back());
+            queue_.pop_back();
+            return true;
+        }
+
+      private:
+        std::deque<task_type> queue_;
+        mutable std::mutex mutex_;
+    };
+
+    void worker_thread(unsigned index)
+    {
+        local_pool_ = this;
+        local_index_ = index;
+
+        while (true)
+        {
+            if (run_pending_task())
+                continue;
+
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [&]() {
+                return done_ || num_pending_ > 0;
+            });
+            if (done_)
+                return;
+        }
+    }
+
+    bool pop_local_task(task_type& task)
+    {
+        return local_pool_ == this && queues_[local_index_]->try_pop(task);
+    }
+
+    bool pop_queued_task(task_type& task)
+    {
+        std::scoped_lock lock(queue_mutex_);
+        if (queue_.empty())
+            return false;
+
+        task = std::move(queue_.front());
+        queue_.pop_front();
+        return true;
+    }
+
+    bool steal_task(task_type& task)
+    {
+        // Start with the queue next to the own one, so thieves don't all go for the same queue
+        const size_t start = local_pool_ == this ? local_index_ + 1 : 0;
+        for (size_t i = 0; i < queues_.size(); ++i)
+        {
+            if (queues_[(start + i) % queues_.size()]->try_steal(task))
+                return true;
+        }
+        return false;
+    }
+
+    std::vector<std::unique_ptr<work_stealing_queue>> queues_;
+    std::vector<std::thread> threads_;
+
+    std::mutex queue_mutex_;
+    std::deque<task_type> queue_;
+
+    // Number of tasks waiting in the queues, briefly negative if a task is taken before it's counted
+    std::atomic<int64_t> num_pending_ = 0;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool done_ = false;
+
+    static inline thread_local thread_pool* local_pool_ = nullptr;
+    static inline thread_local size_t local_index_ = 0;
+};
+
+// Tasks forked by a single parallel algorithm
+// Work is forked only while fewer than max_parallelism tasks are running including the calling thread,
+// otherwise it's run right away by the thread which tried to fork it.
+class task_group
+{
+  public:
+    task_group(thread_pool& pool, size_t max_parallelism)
+        : pool_(pool),
+          max_forked_(max_parallelism > 0 ? max_parallelism - 1 : 0)
+    {
+    }
+
+    task_group(const task_group& other) = delete;
+    task_group& operator=(const task_group& rhs) = delete;
+
+    ~task_group()
+    {
+        wait();
+    }
+
+    template <typename Function>
+    void run(Function f)
+    {
+        if (num_forked_.fetch_add(1) >= max_forked_)
+        {
+            num_forked_.fetch_sub(1);
+            f();
+            return;
+        }
+
+        std::future<void> result = pool_.submit([this, f = std::move(f)]() mutable {
+            f();
+            num_forked_.fetch_sub(1);
+        });
+
+        std::scoped_lock lock(mutex_);
+        results_.push_back(std::move(result));
+    }
+
+    // Waits for all forked tasks including the ones forked by other tasks of the group
+    // Pending tasks of the pool are run meanwhile, so waiting on a worker thread doesn't block the pool
+    void wait()
+    {
+        while (true)
+        {
+            std::vector<std::future<void>> results;
+            {
+                std::scoped_lock lock(mutex_);
+                results.swap(results_);
+            }
+            if (results.empty())
+                return;
+
+            for (std::future<void>& result : results)
+            {
+                while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                {
+                    if (!pool_.run_pending_task())
+                        std::this_thread::yield();
+                }
+            }
+        }
+    }
+
+  private:
+    thread_pool& pool_;
+    const size_t max_forked_;
+    std::atomic_size_t num_forked_ = 0;
+
+    std::mutex mutex_;
+    std::vector<std::future<void>> results_;
+};
+} // namespace datastore::detail
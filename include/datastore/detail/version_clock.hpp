@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+
+namespace datastore::detail
+{
+// Logical clock ordering value writes against snapshots
+// Every write is stamped with the current time, a snapshot taken at time S sees all writes stamped with S or earlier.
+// Taking a snapshot advances the clock and waits for the writes which are still being applied with earlier stamps,
+// so later writes are always stamped with a time after the snapshot.
+class version_clock
+{
+  public:
+    static version_clock& instance()
+    {
+        static version_clock clock;
+        return clock;
+    }
+
+    version_clock(const version_clock& other) = delete;
+    version_clock& operator=(const version_clock& rhs) = delete;
+
+    ~version_clock()
+    {
+        slot* s = slots_.load();
+        while (s)
+            delete std::exchange(s, s->next);
+    }
+
+    // Returns the stamp for the writes of the current thread until end_write() is called
+    // Nested writes share the stamp of the outermost one
+    uint64_t begin_write()
+    {
+        thread_record& record = this_thread_record();
+        if (record.nesting++ > 0)
+            return record.stamp;
+
+        if (!record.owned_slot)
+            record.owned_slot = acquire_slot();
+
+        // Publish the stamp before making sure the clock hasn't advanced past it,
+        // so a snapshot either waits for this write or the write gets a later stamp
+        uint64_t stamp = now_.load();
+        while (true)
+        {
+            record.owned_slot->stamp.store(stamp);
+            const uint64_t current = now_.load();
+            if (current == stamp)
+                break;
+            stamp = current;
+        }
+
+        record.stamp = stamp;
+        return stamp;
+    }
+
+    void end_write()
+    {
+        thread_record& record = this_thread_record();
+        if (--record.nesting > 0)
+            return;
+
+        record.owned_slot->stamp.store(idle, std::memory_order_release);
+    }
+
+    // Registers a snapshot and returns its time
+    uint64_t acquire_snapshot()
+    {
+        uint64_t time = idle;
+        {
+            std::scoped_lock lock(snapshots_mutex_);
+
+            // Writers that see no snapshots don't keep overwritten values,
+            // so a snapshot is counted before its time is taken
+            num_snapshots_.fetch_add(1);
+
+            // Writers stamped after the snapshot time must see it as the oldest one,
+            // so a lower bound of the time is published first
+            oldest_snapshot_.store(std::min(oldest_snapshot_.load(), now_.load()));
+            time = now_.fetch_add(1);
+            snapshots_.insert(time);
+            oldest_snapshot_.store(*snapshots_.begin());
+        }
+
+        // Wait for writes stamped with the snapshot time or earlier to be applied
+        wait_for_writes(time);
+
+        return time;
+    }
+
+    // Waits for the writes which have started before the call to be applied
+    // Writes started after the call are stamped with a later time and see everything published before the call
+    void wait_for_writes()
+    {
+        wait_for_writes(now_.fetch_add(1));
+    }
+
+    void release_snapshot(uint64_t time)
+    {
+        std::scoped_lock lock(snapshots_mutex_);
+        snapshots_.erase(snapshots_.find(time));
+        oldest_snapshot_.store(snapshots_.empty() ? std::numeric_limits<uint64_t>::max() : *snapshots_.begin());
+        num_snapshots_.fetch_sub(1);
+    }
+
+    // Checks whether overwritten values have to be kept for snapshots
+    [[nodiscard]] bool snapshots_active() const
+    {
+        return num_snapshots_.load() > 0;
+    }
+
+    // Values overwritten at this time or earlier are not visible to any snapshot
+    // Takes no lock, so writers can call it while holding their own locks
+    [[nodiscard]] uint64_t oldest_snapshot() const
+    {
+        return oldest_snapshot_.load();
+    }
+
+  private:
+    static constexpr uint64_t idle = 0;
+
+    // Stamp of the write a thread is applying, slots are never freed and get reused after the thread exits
+    struct alignas(64) slot
+    {
+        std::atomic<uint64_t> stamp = idle;
+        std::atomic_bool in_use = true;
+        slot* next = nullptr;
+    };
+
+    struct thread_record
+    {
+        slot* owned_slot = nullptr;
+        size_t nesting = 0;
+        uint64_t stamp = idle;
+
+        ~thread_record()
+        {
+            if (owned_slot)
+                owned_slot->in_use.store(false, std::memory_order_release);
+        }
+    };
+
+    version_clock() = default;
+
+    static thread_record& this_thread_record()
+    {
+        static thread_local thread_record record;
+        return record;
+    }
+
+    void wait_for_writes(uint64_t time) const
+    {
+        for (const slot* s = slots_.load(); s; s = s->next)
+        {
+            uint64_t stamp = s->stamp.load();
+            while (stamp != idle && stamp <= time)
+            {
+                std::this_thread::yield();
+                stamp = s->stamp.load();
+            }
+        }
+    }
+
+    // Reuses a slot of an exited thread, a new one is registered if all of them are in use
+    slot* acquire_slot()
+    {
+        for (slot* s = slots_.load(); s; s = s->next)
+        {
+            bool expected = false;
+            if (!s->in_use.load(std::memory_order_relaxed) &&
+                s->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                return s;
+        }
+
+        slot* s = new slot();
+        s->next = slots_.load();
+        while (!slots_.compare_exchange_weak(s->next, s))
+        {
+        }
+        return s;
+    }
+
+    // Slots are only ever prepended, so readers of the list need no lock
+    std::atomic<slot*> slots_ = nullptr;
+    std::atomic<uint64_t> now_ = idle + 1;
+
+    mutable std::mutex snapshots_mutex_;
+    std::multiset<uint64_t> snapshots_;
+    std::atomic<uint64_t> oldest_snapshot_ = std::numeric_limits<uint64_t>::max();
+    std::atomic_size_t num_snapshots_ = 0;
+};
+
+// Stamps all writes made by the current thread for the lifetime of the object
+class write_scope
+{
+  public:
+    write_scope()
+        : stamp_(version_clock::instance().begin_write())
+    {
+    }
+
+    write_scope(const write_scope& other) = delete;
+    write_scope& operator=(const write_scope& rhs) = delete;
+
+    ~write_scope()
+    {
+        version_clock::instance().end_write();
+    }
+
+    [[nodiscard]] uint64_t stamp() const
+    {
+        return stamp_;
+    }
+
+  private:
+    uint64_t stamp_;
+};
+} // namespace datastore::detail
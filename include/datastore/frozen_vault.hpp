@@ -0,0 +1,116 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "datastore/detail/perfect_hash.hpp"
+#include "datastore/node_view.hpp"
+
+namespace datastore
+{
+// Immutable image of the values visible through the node views of a vault, see vault::freeze()
+// Values are resolved based on volume priorities when the image is built and stored contiguously,
+// node views and values are found through perfect hash tables, so reads take no locks and touch no atomics.
+// Every node view is captured at its own moment, use a snapshot when values of several node views must be consistent.
+class frozen_vault final
+{
+    friend class vault;
+
+  public:
+    frozen_vault(const frozen_vault& other) = delete;
+    frozen_vault& operator=(const frozen_vault& rhs) = delete;
+
+    // Retrieves the value of the node view with the given path relative to the vault root
+    // Only the value of the node with the highest priority is kept, so a value of another type hides it.
+    template <typename T, typename = std::enable_if_t<detail::allowed<T>::value>>
+    [[nodiscard]] std::optional<T> get_value(std::string_view view_path, std::string_view value_name) const;
+
+    // Retrieves the data type of the value associated with the specified name
+    [[nodiscard]] std::optional<value_kind> get_value_kind(std::string_view view_path,
+                                                           std::string_view value_name) const;
+
+    // Checks whether the node view with the given path existed, an empty path is the vault root
+    [[nodiscard]] bool contains(std::string_view view_path) const;
+
+    // Iterates over the values of the node view with the given path
+    // Function must have a following signature: void func(const datastore::attr&);
+    template <typename Function>
+    void for_each_value(std::string_view view_path, Function f) const;
+
+    // Total number of values in the image
+    [[nodiscard]] size_t size() const;
+
+    // Checks that none of the node views and nodes the image was built from has changed since
+    // Takes no locks, but visits every node view and node, so it costs about as much as a pass over the vault
+    [[nodiscard]] bool current() const;
+
+  private:
+    struct frozen_view
+    {
+        std::string path;
+
+        // Range of values_ holding the values of the node view
+        uint32_t first_value;
+        uint32_t last_value;
+    };
+
+    // Node view the image was built from along with what its part of the image depends on
+    struct observed_view
+    {
+        std::shared_ptr<node_view> view;
+        uint64_t subviews_generation;
+        std::shared_ptr<const node_view::merged_values> merged;
+    };
+
+    frozen_vault() = default;
+
+    // Compiles the values of the node view and all of its subviews
+    // Version of the vault must be loaded before the build, so a write racing with it makes the image stale.
+    static std::shared_ptr<const frozen_vault> build(const std::shared_ptr<node_view>& root, uint64_t vault_version);
+
+    void add_view(const std::shared_ptr<node_view>& view, std::string path);
+
+    const frozen_view* find_view(std::string_view view_path) const;
+    const attr* find_value(std::string_view view_path, std::string_view value_name) const;
+
+    static uint64_t hash_view(std::string_view view_path, uint64_t seed);
+    static uint64_t hash_value(std::string_view view_path, std::string_view value_name, uint64_t seed);
+
+    std::vector<frozen_view> views_;
+    std::vector<attr> values_;
+
+    // Index of the node view in views_ for every value
+    std::vector<uint32_t> value_views_;
+
+    detail::perfect_hash view_index_;
+    detail::perfect_hash value_index_;
+    std::vector<observed_view> observed_;
+
+    // Version of the vault the image was built at, see detail::view_index::version
+    uint64_t vault_version_ = 0;
+};
+
+template <typename T, typename>
+[[nodiscard]] std::optional<T> frozen_vault::get_value(std::string_view view_path, std::string_view value_name) const
+{
+    const attr* a = find_value(view_path, value_name);
+    if (!a)
+        return std::nullopt;
+
+    return a->get_value<T>();
+}
+
+template <typename Function>
+void frozen_vault::for_each_value(std::string_view view_path, Function f) const
+{
+    const frozen_view* view = find_view(view_path);
+    if (!view)
+        return;
+
+    for (uint32_t i = view->first_value; i < view->last_value; ++i)
+        f(values_[i]);
+}
+} // namespace datastore
@@ -1,12 +1,34 @@
 #pragma once
 
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <initializer_list>
+#include <map>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
 #include <ostream>
+#include <shared_mutex>
 #include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 
+#include "datastore/borrowed_ptr.hpp"
+#include "datastore/detail/lock_pool.hpp"
+#include "datastore/detail/reader_biased_mutex.hpp"
+#include "datastore/detail/reclaimer.hpp"
+#include "datastore/detail/reduce.hpp"
+#include "datastore/detail/sequenced_ring.hpp"
+#include "datastore/detail/sorted_index.hpp"
 #include "datastore/detail/sorted_list.hpp"
 #include "datastore/detail/striped_hashmap.hpp"
+#include "datastore/detail/thread_pool.hpp"
+#include "datastore/detail/version_clock.hpp"
+#include "datastore/path_pattern.hpp"
 #include "datastore/path_view.hpp"
 
 #if defined(DATASTORE_DEBUG) && !defined(NDEBUG)
@@ -21,6 +43,9 @@
 namespace datastore
 {
 class node;
+class snapshot;
+class transaction;
+class value_watch;
 class volume;
 
 enum class value_kind : uint8_t
@@ -58,9 +83,112 @@ static_assert(std::variant_size_v<value_type> == to_underlying(value_kind::_coun
 
 std::ostream& operator<<(std::ostream& lhs, const value_type& rhs);
 
+// Operations which can be used to aggregate values across a tree
+enum class aggregate_op : uint8_t
+{
+    sum,
+    min,
+    max,
+    count
+};
+
+// Controls how parallel traversals divide a tree between threads
+struct traversal_options
+{
+    // Maximum number of subtrees visited at the same time including the one visited by the calling thread
+    size_t max_parallelism = std::max(1u, std::thread::hardware_concurrency());
+
+    // Subtrees rooted deeper than this below the starting node are visited by the thread which reached them
+    // Lower values cut the overhead of forking small subtrees, higher ones balance uneven trees better.
+    size_t max_fork_depth = 2;
+};
+
+// Controls when deleted or unloaded subtrees are torn down
+enum class teardown : uint8_t
+{
+    // Whole subtree is torn down before the call returns
+    immediate,
+
+    // Subtree is detached and marked as deleted right away, observers are notified
+    // and memory is released later by a background thread, see detail::reclaimer
+    deferred
+};
+
+// Controls how observers, e.g. node views of vaults, learn about created and deleted subnodes
+enum class dispatch : uint8_t
+{
+    // Observers are notified by the writer before the write returns
+    synchronous,
+
+    // Writer queues a single event no matter how many observers there are,
+    // observers are notified later by a background thread, see detail::event_dispatcher
+    asynchronous
+};
+
+// Selects the nodes whose values a watch receives the changes of, see node::watch_values()
+enum class watch_scope : uint8_t
+{
+    // Only the watched node
+    node,
+
+    // Watched node and all of its subnodes, including the ones created later
+    subtree
+};
+
+// Change of a single value delivered to a watch
+// Old kind is empty for a value which didn't exist before, new kind is empty for a deleted value.
+struct value_change
+{
+    // Path of the changed node relative to the watched node, empty for the watched node itself
+    std::string path;
+    std::string value_name;
+    std::optional<value_kind> old_kind;
+    std::optional<value_kind> new_kind;
+};
+
+// Receives the changes delivered to a watch at once
+using value_watcher = std::function<void(const std::vector<value_change>& changes)>;
+
+enum class change_kind : uint8_t
+{
+    create_subnode,
+    delete_subnode,
+    set_value,
+    delete_value
+};
+
+// Change recorded by the change feed of a volume, see volume::enable_change_feed()
+struct change_record
+{
+    // Position of the change in the feed, every change gets a greater number than the changes made before it
+    uint64_t sequence;
+    change_kind kind;
+
+    // Full path of the created or deleted subnode or of the node whose value has changed
+    std::string path;
+
+    // Name and the new value of a changed value, the value is empty for a deleted one
+    std::string value_name;
+    std::optional<value_type> value;
+};
+
 namespace detail
 {
 
+// Lock protecting the buckets of subnodes and values
+#if defined(DATASTORE_READER_BIASED_LOCKS)
+using bucket_lock = reader_biased_mutex;
+#else
+using bucket_lock = std::shared_mutex;
+#endif
+
+// Pooled locks save the memory of the locks of sparsely populated nodes, but unrelated buckets may contend
+#if defined(DATASTORE_POOLED_LOCKS)
+using bucket_mutex = pooled_mutex<bucket_lock>;
+#else
+using bucket_mutex = bucket_lock;
+#endif
+
 template <class T, class U>
 struct is_one_of;
 
@@ -72,6 +200,75 @@ struct is_one_of<T, std::variant<Ts...>> : std::bool_constant<(std::is_same_v<T,
 template <class T>
 using allowed = is_one_of<T, value_type>;
 
+template <class T>
+using aggregatable = std::bool_constant<allowed<T>::value && std::is_arithmetic_v<T>>;
+
+// Result of aggregating a part of the tree which can be combined with the results of other parts
+template <typename T>
+struct partial_aggregate
+{
+    T value = T();
+    size_t count = 0;
+
+    static partial_aggregate reduce(const std::vector<T>& values, aggregate_op op)
+    {
+        partial_aggregate result;
+        result.count = values.size();
+        if (values.empty())
+            return result;
+
+        if (op == aggregate_op::sum)
+            result.value = reduce_sum(values.data(), values.size());
+        if (op == aggregate_op::min)
+            result.value = reduce_min(values.data(), values.size());
+        if (op == aggregate_op::max)
+            result.value = reduce_max(values.data(), values.size());
+
+        return result;
+    }
+
+    void combine(const partial_aggregate& other, aggregate_op op)
+    {
+        if (other.count == 0)
+            return;
+
+        if (count == 0)
+            value = other.value;
+        else if (op == aggregate_op::sum)
+            value += other.value;
+        else if (op == aggregate_op::min)
+            value = other.value < value ? other.value : value;
+        else if (op == aggregate_op::max)
+            value = value < other.value ? other.value : value;
+
+        count += other.count;
+    }
+
+    [[nodiscard]] std::optional<T> result(aggregate_op op) const
+    {
+        if (op == aggregate_op::count)
+            return static_cast<T>(count);
+
+        return count > 0 ? std::make_optional(value) : std::nullopt;
+    }
+};
+
+// Partial aggregate of a subtree along with the ones of its subtrees forked to other threads
+// Forked parts are filled in by their own tasks and combined in the subnode order once all of them are done.
+template <typename T>
+struct subtree_aggregate
+{
+    partial_aggregate<T> own;
+    std::vector<subtree_aggregate> forked;
+
+    void combine_into(partial_aggregate<T>& result, aggregate_op op) const
+    {
+        result.combine(own, op);
+        for (const subtree_aggregate& subtree : forked)
+            subtree.combine_into(result, op);
+    }
+};
+
 class serializer;
 
 class node_observer
@@ -82,6 +279,326 @@ class node_observer
     virtual void on_create_subnode(const std::shared_ptr<node>& subnode) = 0;
     virtual void on_delete_subnode(const std::shared_ptr<node>& subnode) = 0;
 };
+
+enum class event_kind : uint8_t
+{
+    create_subnode,
+    delete_subnode
+};
+
+// Background thread notifying observers about subnodes created or deleted by the writers
+// Events are dispatched in batches in the order they were posted.
+// An event repeated within a batch is dispatched once and a creation is dropped if the same subnode
+// is deleted later in the batch, observers end up in the same state either way.
+class event_dispatcher
+{
+  public:
+    static event_dispatcher& instance();
+
+    event_dispatcher(const event_dispatcher& other) = delete;
+    event_dispatcher& operator=(const event_dispatcher& rhs) = delete;
+
+    ~event_dispatcher();
+
+    // Queues an event for the observers of the source node
+    void post(event_kind kind, std::shared_ptr<node> source, std::shared_ptr<node> subnode);
+
+    // Blocks until all events posted so far have been dispatched, returns right away when called by an observer
+    void flush();
+
+  private:
+    struct event
+    {
+        event_kind kind;
+        std::shared_ptr<node> source;
+        std::shared_ptr<node> subnode;
+    };
+
+    event_dispatcher();
+
+    void dispatcher_thread();
+
+    // Drops the events which don't change the state of the observers
+    static std::vector<event> coalesce(std::vector<event> batch);
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::vector<event> events_;
+    bool busy_ = false;
+    bool done_ = false;
+    std::thread thread_;
+};
+
+// Background thread delivering value changes to the watches
+// Changes are taken from the queue in batches and every watch receives its changes of a batch in a single call.
+// Repeated changes of a value within a batch are merged into one and a value which was created and deleted
+// within a batch isn't reported at all, so rapid updates cost the watchers a single call.
+class watch_dispatcher
+{
+  public:
+    struct watched_change
+    {
+        std::weak_ptr<value_watch> watch;
+        value_change change;
+    };
+
+    static watch_dispatcher& instance();
+
+    watch_dispatcher(const watch_dispatcher& other) = delete;
+    watch_dispatcher& operator=(const watch_dispatcher& rhs) = delete;
+
+    ~watch_dispatcher();
+
+    // Queues the changes made by a single write
+    void post(std::vector<watched_change> changes);
+
+    // Blocks until all changes posted so far have been delivered, returns right away when called by a watcher
+    void flush();
+
+  private:
+    watch_dispatcher();
+
+    void dispatcher_thread();
+
+    // Merges the changes of every watch and calls the watchers which are still alive
+    static void deliver(std::vector<watched_change> batch);
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::vector<watched_change> changes_;
+    bool busy_ = false;
+    bool done_ = false;
+    std::thread thread_;
+};
+
+// Value watches registered on the nodes of a volume
+// Writes look for the watches only while some exist, so volumes without watches don't pay for them.
+class value_watches
+{
+  public:
+    explicit value_watches(std::pmr::memory_resource* resource);
+
+    [[nodiscard]] bool active() const noexcept
+    {
+        return num_watches_.load() > 0;
+    }
+
+    void add(const node* n, std::weak_ptr<node> ref, const std::shared_ptr<value_watch>& watch);
+    void remove(const node* n, const value_watch* watch);
+
+    // Retrieves the live watches registered on the node
+    [[nodiscard]] std::vector<std::shared_ptr<value_watch>> find(const node* n) const;
+
+  private:
+    struct registration
+    {
+        std::weak_ptr<node> ref;
+        const value_watch* id;
+        std::weak_ptr<value_watch> watch;
+    };
+
+    mutable std::shared_mutex mutex_;
+    std::pmr::unordered_multimap<const node*, registration> watches_;
+    std::atomic_size_t num_watches_ = 0;
+};
+
+// Indexes of the nodes of a volume by the values with specific names
+// Every index has its own lock, so only writes of values with the same indexed name wait for each other.
+class value_indexes
+{
+    using entry_key = std::pair<value_type, const node*>;
+
+    // Nodes with equal values are ordered by address, so an entry can be found without scanning all of them
+    struct entry_less
+    {
+        bool operator()(const entry_key& lhs, const entry_key& rhs) const
+        {
+            if (lhs.first < rhs.first)
+                return true;
+            if (rhs.first < lhs.first)
+                return false;
+            return std::less<const node*>()(lhs.second, rhs.second);
+        }
+    };
+
+  public:
+    // Nodes by the values with a single name
+    struct index
+    {
+        using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+        explicit index(const allocator_type& alloc)
+            : entries(alloc)
+        {
+        }
+
+        // Held exclusively while the indexed values are written, so the index always changes along with the values,
+        // and shared while the index is searched
+        mutable std::shared_mutex mutex;
+        std::string_view value_name;
+        std::pmr::map<entry_key, std::weak_ptr<node>, entry_less> entries;
+
+        void insert(const value_type& value, const node* n, std::weak_ptr<node> ref)
+        {
+            entries.try_emplace({value, n}, std::move(ref));
+        }
+
+        void erase(const value_type& value, const node* n)
+        {
+            entries.erase({value, n});
+        }
+
+        // Calls the function for every node whose value is within the inclusive range
+        // Values are ordered by kind first, so values of other kinds are never in the range
+        template <typename Function>
+        void for_each_between(const value_type& min, const value_type& max, Function f) const
+        {
+            for (auto it = entries.lower_bound({min, nullptr}); it != entries.end(); ++it)
+            {
+                if (max < it->first.first)
+                    break;
+                f(it->second);
+            }
+        }
+    };
+
+    explicit value_indexes(std::pmr::memory_resource* resource);
+
+    // Checks whether any values are indexed, writes don't touch the indexes otherwise
+    [[nodiscard]] bool active() const noexcept
+    {
+        return num_indexes_.load() > 0;
+    }
+
+    bool create(std::string_view value_name);
+    bool drop(std::string_view value_name);
+
+    // Held shared while the indexes are written or searched and exclusively while an index is created or dropped
+    [[nodiscard]] reader_biased_mutex& mutex() const noexcept
+    {
+        return mutex_;
+    }
+
+    // Following functions must be called with the mutex held
+
+    // Retrieves the index of the values with the name, nullptr if they aren't indexed
+    [[nodiscard]] index* find(std::string_view value_name);
+
+    template <typename Function>
+    void for_each_index(Function f)
+    {
+        for (auto& [value_name, i] : indexes_)
+            f(i);
+    }
+
+    // Locks the indexes exclusively in the order of their addresses, so writers of several indexes never deadlock
+    static void lock(std::vector<index*>& locked);
+    static void unlock(const std::vector<index*>& locked);
+
+  private:
+    mutable reader_biased_mutex mutex_;
+    std::pmr::map<std::pmr::string, index, std::less<>> indexes_;
+    std::atomic_size_t num_indexes_ = 0;
+};
+
+// State shared by all nodes of a volume
+struct volume_context
+{
+    explicit volume_context(std::pmr::memory_resource* resource)
+        : resource(resource),
+          path_cache(13, resource),
+          indexes(resource),
+          watches(resource)
+    {
+    }
+
+    // Nodes and their containers are allocated from this memory resource
+    std::pmr::memory_resource* resource;
+
+    // Nodes found by previous lookups of composite paths, keyed by the full node path
+    // Entries are dropped when the node gets deleted
+    striped_hashmap<std::pmr::string, std::weak_ptr<node>, path_element_hash> path_cache;
+
+    // Opt-in indexes of the nodes by their values, see volume::create_index()
+    value_indexes indexes;
+
+    // Number of detached subtrees not torn down yet, their nodes have to check whether an ancestor is deleted
+    std::atomic_size_t num_detached_subtrees = 0;
+
+    // Incremented after every detached subtree is marked, a node found alive stays alive until it changes
+    std::atomic<uint64_t> detach_generation = 0;
+
+    // How the observers of the nodes are notified, see volume::set_observer_dispatch()
+    std::atomic<dispatch> observer_dispatch = dispatch::synchronous;
+
+    // Watches of the values of the nodes, see node::watch_values()
+    value_watches watches;
+
+    // Latest changes of the volume, see volume::enable_change_feed()
+    sequenced_ring<change_record> changes;
+
+    // Held while a change is made and recorded, so the feed follows the order of the changes
+    // Taken by every write of the volume while the feed is enabled, so writes of different nodes are serialized.
+    std::mutex changes_mutex;
+};
+
+// Overwritten values of a node kept for the snapshots which can still see them
+class value_history
+{
+  public:
+    explicit value_history(std::pmr::memory_resource* resource);
+
+    value_history(value_history&& other) noexcept;
+    value_history& operator=(value_history&& rhs) noexcept;
+
+    // Remembers a value which was written at one time and overwritten or deleted at another
+    void record(std::string_view value_name, const value_type& value, uint64_t written, uint64_t overwritten);
+
+    // Retrieves the value which was current at the given time, if it has been overwritten since then
+    std::optional<value_type> find(std::string_view value_name, uint64_t time) const;
+
+  private:
+    struct entry
+    {
+        std::pmr::string name;
+        value_type value;
+        uint64_t written;
+        uint64_t overwritten;
+    };
+
+    mutable std::mutex mutex_;
+    std::pmr::vector<entry> entries_;
+};
+
+// Parts of a node which most nodes never use, allocated on first use, see node::extras()
+// Leaves of a large tree are mostly never scanned in order, observed or snapshotted, so they don't pay for it.
+struct node_extras
+{
+    // Expired observers are pruned by a registration only once their list has doubled since the last pruning
+    static constexpr size_t min_observers_to_prune = 8;
+
+    explicit node_extras(std::pmr::memory_resource* resource)
+        : sorted_subnodes(resource),
+          observers(std::owner_less<>(), resource),
+          view_versions(resource),
+          history(resource)
+    {
+    }
+
+    sorted_index<std::shared_ptr<node>> sorted_subnodes;
+
+    sorted_list<std::weak_ptr<node_observer>, std::owner_less<>> observers;
+    std::atomic_size_t next_observer_prune = min_observers_to_prune;
+
+    // Versions of the node views observing the node, the views share them with all the nodes they observe
+    mutable bucket_mutex view_versions_mutex;
+    std::pmr::vector<std::shared_ptr<std::atomic<uint64_t>>> view_versions;
+    std::atomic_size_t num_view_versions = 0;
+
+    value_history history;
+};
 } // namespace detail
 
 namespace literals
@@ -99,9 +616,13 @@ constexpr uint64_t operator""_u64(unsigned long long value)
 
 class attr final
 {
+    friend class node;
+
   public:
-    attr(std::string name, value_type value)
-        : name_(std::move(name)),
+    // Name is allocated from the given memory resource
+    attr(std::string_view name, value_type value,
+         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : name_(name, resource),
           value_(std::move(value))
     {
     }
@@ -129,16 +650,95 @@ class attr final
     }
 
   private:
-    std::string name_;
+    std::pmr::string name_;
     value_type value_;
+
+    // Time of the write which has set the value, see detail::version_clock
+    uint64_t stamp_ = 0;
+};
+
+// List of value updates applied to a node at once
+class value_batch final
+{
+    friend class node;
+    friend class node_view;
+    friend class transaction;
+
+  public:
+    // Sets the value of a name/value pair
+    template <typename T, typename = std::enable_if_t<std::is_constructible_v<value_type, T>>>
+    value_batch& set_value(std::string_view value_name, T&& new_value)
+    {
+        updates_.emplace_back(std::string(value_name), value_type(std::forward<T>(new_value)));
+        return *this;
+    }
+
+    // Deletes the value with the given name
+    value_batch& delete_value(std::string_view value_name)
+    {
+        updates_.emplace_back(std::string(value_name), std::nullopt);
+        return *this;
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return updates_.size();
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return updates_.empty();
+    }
+
+  private:
+    // Updates without a value are deletions
+    std::vector<std::pair<std::string, std::optional<value_type>>> updates_;
+};
+
+// Subscription to the changes of values, see node::watch_values()
+// Changes stop being delivered once the last reference to the watch is released.
+class value_watch final
+{
+    friend class node;
+    friend class node_view;
+    friend class detail::watch_dispatcher;
+
+  public:
+    value_watch(const value_watch& other) = delete;
+    value_watch& operator=(const value_watch& rhs) = delete;
+
+    ~value_watch();
+
+    [[nodiscard]] watch_scope scope() const
+    {
+        return scope_;
+    }
+
+  private:
+    value_watch(value_watcher watcher, watch_scope scope);
+
+    struct registration
+    {
+        std::weak_ptr<detail::volume_context> context;
+        const node* n;
+    };
+
+    value_watcher watcher_;
+    watch_scope scope_;
+
+    // Nodes the watch is registered on, written only before the watch is handed out
+    std::vector<registration> registrations_;
 };
 
-class node final
+class node final : public std::enable_shared_from_this<node>
 {
     friend class detail::serializer;
     friend class volume;
+    friend class detail::event_dispatcher;
     friend class detail::node_observer;
     friend class node_view;
+    friend class snapshot;
+    friend class transaction;
 
     friend std::ostream& operator<<(std::ostream& lhs, const node& rhs);
 
@@ -152,6 +752,8 @@ class node final
     node& operator=(const node& rhs) = delete;
     node& operator=(node&& rhs) noexcept;
 
+    ~node();
+
     // Creates a new subnode or opens an existing subnode
     // The subnode can be several levels deep in the volume tree
     std::shared_ptr<node> create_subnode(path_view subnode_path);
@@ -160,16 +762,44 @@ class node final
     // The subnode can be several levels deep in the volume tree
     std::shared_ptr<node> open_subnode(path_view subnode_path) const;
 
+    // Retrieves the specified subnode without taking a shared ownership of it
+    // Cheaper than open_subnode() when the subnode is accessed from many threads at once
+    borrowed_ptr<node> borrow_subnode(path_view subnode_path) const;
+
     // Deletes a subnode and any child subnodes recursively
-    bool delete_subnode_tree(path_view subnode_name);
-    bool delete_subnode_tree();
+    // With a deferred teardown the subtree can't be reached or modified once the call returns,
+    // but observers learn about the deletion only after the background thread reaches the subtree.
+    bool delete_subnode_tree(path_view subnode_name, teardown mode = teardown::immediate);
+    bool delete_subnode_tree(teardown mode = teardown::immediate);
 
-    // Leave it up to the user to ensure that they don't cause deadlock
-    // by acquiring locks in the user-supplied operations
-    // and don't cause data races by storing the references for access outside the locks.
+    // Iterates over a snapshot of the subnodes, no locks are held while the function is called
+    // so it can safely access this node and any other nodes, e.g. read values or delete subnodes.
+    // Subnodes created or deleted during the iteration might be missed or still visited.
     template <typename Function>
     void for_each_subnode(Function f) const;
 
+    // Calls the function for every subnode of this node and all of their subnodes recursively
+    // Subtrees are visited concurrently by the threads of a work stealing pool, so the function must be thread-safe.
+    // A subnode is always visited before its subnodes, no locks are held while the function is called.
+    // Function must have a following signature: void func(const std::shared_ptr<datastore::node>&);
+    template <typename Function>
+    void parallel_for_each_subnode(Function f, const traversal_options& options = {}) const;
+
+    // Calls the function for the subnodes with names in the range [first, last) in the name order
+    // An empty last name means that the range is not bounded from above.
+    // Sorted order is kept until subnodes are added or removed, so repeated scans don't sort the subnodes again.
+    // Function must have a following signature: void func(const std::shared_ptr<datastore::node>&);
+    template <typename Function>
+    void for_each_subnode_in_range(std::string_view first, std::string_view last, Function f) const;
+
+    // Calls the function for the subnodes with names starting with the prefix in the name order
+    template <typename Function>
+    void for_each_subnode_with_prefix(std::string_view prefix, Function f) const;
+
+    // Retrieves at most max_count subnodes with names following the given one in the name order
+    // Name of the last subnode of a page is the cursor for the next page, an empty name starts from the beginning.
+    [[nodiscard]] std::vector<std::shared_ptr<node>> list_subnodes(std::string_view after, size_t max_count) const;
+
     // Deletes the specified value from this node
     size_t delete_value(const std::string& value_name);
     void delete_values();
@@ -185,12 +815,42 @@ class node final
     template <typename T, typename = std::enable_if_t<std::is_constructible_v<value_type, T>>>
     bool set_value(const std::string& value_name, T&& new_value);
 
-    // Leave it up to the user to ensure that they don't cause deadlock
-    // by acquiring locks in the user-supplied operations
-    // and don't cause data races by storing the references for access outside the locks.
+    // Calls the function for every subnode whose path relative to this node matches the pattern
+    // Function must have a following signature: void func(const std::shared_ptr<datastore::node>&);
+    // Subnodes are collected before the function is called, so no locks are held during the calls.
+    // Parallel queries match the subtrees of the subnodes concurrently, so the function must be thread-safe.
+    template <typename Function>
+    void query(const path_pattern& pattern, Function f, bool parallel = false) const;
+
+    // Retrieves all subnodes whose paths relative to this node match the pattern
+    [[nodiscard]] std::vector<std::shared_ptr<node>> query(const path_pattern& pattern) const;
+
+    // Aggregates values with the given name and type stored in this node and all of its subnodes
+    // Subtrees are forked to other threads down to the fork depth, values of other types are ignored.
+    // Counting returns zero and other operations return nothing if none of the nodes has the value.
+    template <typename T, typename = std::enable_if_t<detail::aggregatable<T>::value>>
+    [[nodiscard]] std::optional<T> aggregate(const std::string& value_name, aggregate_op op,
+                                             const traversal_options& options = {}) const;
+
+    // Sets several values at once, see apply_batch()
+    bool set_values(std::initializer_list<std::pair<std::string_view, value_type>> values);
+
+    // Applies all updates of the batch in order taking every affected lock only once
+    // Fails without applying anything if any of the updates is invalid,
+    // fails after applying the rest of the updates if the limit of values is reached
+    bool apply_batch(const value_batch& batch);
+
+    // Iterates over a snapshot of the values, no locks are held while the function is called
+    // Function must have a following signature: void func(const datastore::attr&);
     template <typename Function>
     void for_each_value(Function f) const;
 
+    // Delivers the changes of the values of this node or of its whole subtree to the watcher
+    // Changes are delivered in batches by a background thread, see detail::watch_dispatcher,
+    // so the watcher shouldn't block for long. Watching stops once the returned watch is released.
+    [[nodiscard]] std::shared_ptr<value_watch> watch_values(value_watcher watcher,
+                                                            watch_scope scope = watch_scope::node);
+
     std::string_view name() const;
 
     [[nodiscard]] path_view path() const;
@@ -200,46 +860,524 @@ class node final
     [[nodiscard]] bool deleted() const;
 
   private:
-    node(path_view full_path, uint8_t volume_priority);
+    node(path_view full_path, uint8_t volume_priority, std::shared_ptr<detail::volume_context> context);
+
+    // Allocates a node along with its control block from the given memory resource
+    template <typename... Args>
+    static std::shared_ptr<node> make(std::pmr::memory_resource* resource, Args&&... args);
+
+    std::shared_ptr<node> open_subnode_uncached(path_view subnode_path) const;
+
+    // Checks whether the node belongs to a detached subtree which hasn't been torn down yet
+    // The ancestors are walked once per detached subtree, until then the node is known to be alive.
+    bool ancestor_deleted() const;
+
+    // Marks the subnode as deleted and hands the rest of its teardown over to the reclaimer
+    // The subnode must be already unlinked from this node
+    void defer_teardown(std::shared_ptr<node> subnode);
+
+    // Points the subnodes of a deserialized tree at their parents
+    void link_subnodes();
+
+    // Walks the path down to the parent of its last element without touching reference counters
+    // The epoch must stay pinned while the result is in use
+    const node* find_parent_pinned(path_view& subnode_path) const;
+
+    // Checks that the value fits the name and size limits
+    static bool valid_value(std::string_view value_name, const value_type& value);
+
+    // Applies already validated updates, returns the number of values rejected because of the limit
+    size_t write_batch(const value_batch& batch);
+
+    // Passed instead of the written names by writes which might change any value
+    struct any_value_name
+    {
+    };
+
+    // Performs the write keeping the value indexes of the volume up to date
+    // Names call the given function with the name of every value the write might change, only their indexes are locked.
+    // The write receives the write hook which has to be passed to values_
+    template <typename Names, typename Write>
+    auto write_indexed(uint64_t stamp, const Names& written_names, Write write);
+
+    // Adds the values of this node and its subnodes to the index
+    void index_subtree(std::string_view value_name);
+
+    // Removes the values of a deleted node from the indexes
+    void unindex_values();
+
+    // Performs the write through write_indexed() and reports the changed values to the watches and the change feed
+    template <typename Names, typename Write>
+    auto write_watched(uint64_t stamp, const Names& written_names, Write write);
+
+    // Watch receiving the changes of the values of this node along with the path of the node relative to its target
+    struct watch_target
+    {
+        std::weak_ptr<value_watch> watch;
+        std::string path;
+    };
+
+    // Collects the watches of this node and the ancestors watching their whole subtree
+    std::vector<watch_target> find_watch_targets() const;
+
+    // Reports a single write of a value, called by the write hook under the bucket lock
+    void report_value_change(const std::vector<watch_target>& targets, std::string_view value_name,
+                             const attr* old_value, const attr* new_value) const;
+
+    // Serializes the changes of the volume while its change feed is enabled, doesn't lock anything otherwise
+    [[nodiscard]] std::unique_lock<std::mutex> lock_changes() const;
+
+    // Appends the change to the change feed of the volume if it's enabled
+    void record_change(change_kind kind, path_view path, std::string_view value_name = {},
+                       std::optional<value_type> value = std::nullopt) const;
+
+    void add_watch(const std::shared_ptr<value_watch>& watch);
+
+    // Lets transactions and the observing node views know that the values of the node have changed
+    void bump_version();
+
+    // Bumps the versions of the node views observing the node, see node_view::resolve_value()
+    void bump_view_versions();
+
+    void add_view_version(std::shared_ptr<std::atomic<uint64_t>> version);
+    void remove_view_version(const std::atomic<uint64_t>* version);
+
+    // Waits while a committing transaction holds the node and returns the version it has left behind
+    // Plain reads wait as well, so a read started after a commit has taken the node sees all of its writes.
+    uint64_t wait_unlocked() const;
+
+    // Allocates the rarely used parts of the node unless another thread has done it already
+    detail::node_extras& extras() const;
+
+    // Rarely used parts of the node, null if nothing has needed them yet
+    detail::node_extras* find_extras() const
+    {
+        return extras_.load(std::memory_order_acquire);
+    }
+
+    // Releases the rarely used parts, the memory resource of the volume must still be alive
+    void release_extras();
+
+    // Drops the sorted copy of the subnodes after they have changed
+    void reset_sorted_subnodes()
+    {
+        if (detail::node_extras* e = find_extras())
+            e->sorted_subnodes.reset();
+    }
+
+    // Keeps committing transactions off the node while a plain write is applied
+    // Waits for a transaction holding the node to finish first, plain writes don't exclude each other.
+    class plain_write_guard
+    {
+      public:
+        explicit plain_write_guard(node& n);
+        ~plain_write_guard();
+
+        plain_write_guard(const plain_write_guard& other) = delete;
+        plain_write_guard& operator=(const plain_write_guard& rhs) = delete;
+
+      private:
+        node& n_;
+    };
+
+    // Keeps values overwritten at the given time for snapshots
+    auto record_overwrite(uint64_t stamp)
+    {
+        return [this, stamp](std::string_view value_name, const attr* old_value, const attr*) {
+            if (old_value && detail::version_clock::instance().snapshots_active())
+                extras().history.record(value_name, old_value->value_, old_value->stamp_, stamp);
+        };
+    }
+
+    // Retrieves the value which was current at the given time
+    std::optional<value_type> value_at(std::string_view value_name, uint64_t time) const;
+
+    // Appends the value of the node to the buffer if it has the requested type
+    // Read under the bucket lock, so values of other types and the names aren't copied
+    template <typename T>
+    void gather_value(std::string_view value_name, size_t value_hash, std::vector<T>& buffer) const;
+
+    // Appends the values of the subtree to the buffer
+    template <typename T>
+    void gather_values(std::string_view value_name, size_t value_hash, std::vector<T>& buffer) const;
+
+    // Aggregates the values of the subtree, subnodes without subnodes of their own aren't worth a task
+    template <typename T>
+    void aggregate_subtree(std::string_view value_name, size_t value_hash, aggregate_op op,
+                           const traversal_options& options, size_t depth, detail::task_group& group,
+                           detail::subtree_aggregate<T>& result) const;
+
+    // Collects the subnodes, so no locks are held while they are processed
+    std::vector<std::shared_ptr<node>> subnodes() const;
+
+    template <typename Function>
+    void visit_subtree_parallel(Function& f, const traversal_options& options, size_t depth,
+                                detail::task_group& group) const;
+
+    // Subnodes which can match the next element of the pattern
+    std::vector<std::shared_ptr<node>> query_candidates(const path_pattern& pattern,
+                                                        path_pattern::state_set states) const;
+
+    template <typename Function>
+    static void query_subtree(const std::shared_ptr<node>& subnode, const path_pattern& pattern,
+                              path_pattern::state_set parent_states, Function& f);
 
     void register_observer(const std::shared_ptr<detail::node_observer>& observer);
     void notify_on_delete_subnode_observers(const std::shared_ptr<node>& subnode);
 
+    // Notifies the observers right away or queues the event for the dispatcher depending on the volume settings
+    void publish_event(detail::event_kind kind, const std::shared_ptr<node>& subnode);
+
+    // Calls the observers on the calling thread
+    void notify_observers(detail::event_kind kind, const std::shared_ptr<node>& subnode);
+
   private:
-    std::string full_path_str_;
+    std::pmr::string full_path_str_;
     path_view full_path_view_;
+    uint64_t full_path_hash_;
     uint8_t volume_priority;
-    detail::striped_hashmap<std::string, std::shared_ptr<node>> subnodes_;
-    detail::striped_hashmap<std::string, attr> values_;
-    detail::sorted_list<std::weak_ptr<detail::node_observer>, std::owner_less<>> observers_;
+    std::shared_ptr<detail::volume_context> context_;
+    detail::striped_hashmap<std::pmr::string, std::shared_ptr<node>, detail::path_element_hash, detail::bucket_mutex>
+        subnodes_;
+    detail::striped_hashmap<std::pmr::string, attr, detail::path_element_hash, detail::bucket_mutex> values_;
+
+    // Set once and released with the node, readers which find it unset treat its parts as empty
+    mutable std::atomic<detail::node_extras*> extras_ = nullptr;
+
     std::atomic_bool deleted_ = false;
+
+    // Detach generation of the volume at which none of the ancestors was deleted, see ancestor_deleted()
+    mutable std::atomic<uint64_t> alive_generation_ = 0;
+
+    // Subnodes don't own their parent, so a tree can be released from its root
+    std::weak_ptr<node> parent_;
+
+    // Incremented by two on every change of values, odd while a transaction commit holds the node
+    std::atomic<uint64_t> version_ = 0;
+
+    // Number of plain writes being applied, a committing transaction waits for them once it holds the node
+    std::atomic<uint32_t> num_plain_writes_ = 0;
 };
 
+inline bool node::deleted() const
+{
+    if (deleted_)
+        return true;
+
+    // Subnodes of a detached subtree are marked as deleted only once the reclaimer reaches them
+    return context_ && context_->num_detached_subtrees > 0 && ancestor_deleted();
+}
+
+template <typename... Args>
+std::shared_ptr<node> node::make(std::pmr::memory_resource* resource, Args&&... args)
+{
+    std::pmr::polymorphic_allocator<node> alloc(resource);
+    node* n = alloc.allocate(1);
+    new (n) node(std::forward<Args>(args)...);
+
+    return std::shared_ptr<node>(
+        n,
+        [alloc](node* p) mutable {
+            p->~node();
+            alloc.deallocate(p, 1);
+        },
+        alloc);
+}
+
 template <typename Function>
 void node::for_each_subnode(Function f) const
 {
-    if (deleted_)
+    if (deleted())
         return;
 
-    subnodes_.for_each(f);
+    subnodes_.for_each_snapshot(f);
+}
+
+template <typename Function>
+void node::parallel_for_each_subnode(Function f, const traversal_options& options) const
+{
+    if (deleted())
+        return;
+
+    detail::task_group group(detail::thread_pool::instance(), options.max_parallelism);
+    visit_subtree_parallel(f, options, 0, group);
+    group.wait();
+}
+
+template <typename Function>
+void node::visit_subtree_parallel(Function& f, const traversal_options& options, size_t depth,
+                                  detail::task_group& group) const
+{
+    for (const std::shared_ptr<node>& subnode : subnodes())
+    {
+        f(subnode);
+
+        if (depth < options.max_fork_depth)
+        {
+            group.run([&f, &options, &group, subnode, depth]() {
+                subnode->visit_subtree_parallel(f, options, depth + 1, group);
+            });
+        }
+        else
+        {
+            subnode->visit_subtree_parallel(f, options, depth + 1, group);
+        }
+    }
+}
+
+template <typename Function>
+void node::for_each_subnode_in_range(std::string_view first, std::string_view last, Function f) const
+{
+    if (deleted())
+        return;
+
+    extras().sorted_subnodes.for_each_from(subnodes_, first, true, [&](const std::shared_ptr<node>& subnode) {
+        if (!last.empty() && subnode->name() >= last)
+            return false;
+
+        if (!subnode->deleted())
+            f(subnode);
+        return true;
+    });
+}
+
+template <typename Function>
+void node::for_each_subnode_with_prefix(std::string_view prefix, Function f) const
+{
+    if (deleted())
+        return;
+
+    extras().sorted_subnodes.for_each_from(subnodes_, prefix, true, [&](const std::shared_ptr<node>& subnode) {
+        if (subnode->name().substr(0, prefix.size()) != prefix)
+            return false;
+
+        if (!subnode->deleted())
+            f(subnode);
+        return true;
+    });
 }
 
 template <typename Function>
 void node::for_each_value(Function f) const
 {
-    if (deleted_)
+    if (deleted())
+        return;
+
+    wait_unlocked();
+    values_.for_each_snapshot(f);
+}
+
+template <typename Function>
+void node::query(const path_pattern& pattern, Function f, bool parallel) const
+{
+    if (!pattern.valid() || deleted())
+        return;
+
+    const path_pattern::state_set states = pattern.initial();
+    const std::vector<std::shared_ptr<node>> candidates = query_candidates(pattern, states);
+
+    if (!parallel)
+    {
+        for (const std::shared_ptr<node>& subnode : candidates)
+            query_subtree(subnode, pattern, states, f);
+        return;
+    }
+
+    detail::task_group group(detail::thread_pool::instance(), traversal_options().max_parallelism);
+    for (const std::shared_ptr<node>& subnode : candidates)
+    {
+        group.run([&, subnode]() {
+            query_subtree(subnode, pattern, states, f);
+        });
+    }
+    group.wait();
+}
+
+template <typename Function>
+void node::query_subtree(const std::shared_ptr<node>& subnode, const path_pattern& pattern,
+                         path_pattern::state_set parent_states, Function& f)
+{
+    const path_pattern::state_set states = pattern.advance(parent_states, subnode->name());
+    if (pattern.accepts(states))
+        f(subnode);
+
+    // Subtrees which can't match the rest of the pattern are skipped
+    if (!pattern.expects_more(states))
+        return;
+
+    for (const std::shared_ptr<node>& child : subnode->query_candidates(pattern, states))
+        query_subtree(child, pattern, states, f);
+}
+
+template <typename T, typename>
+[[nodiscard]] std::optional<T> node::aggregate(const std::string& value_name, aggregate_op op,
+                                               const traversal_options& options) const
+{
+    detail::partial_aggregate<T> result;
+    if (deleted())
+        return result.result(op);
+
+    detail::subtree_aggregate<T> subtree;
+    {
+        detail::task_group group(detail::thread_pool::instance(), options.max_parallelism);
+        aggregate_subtree(value_name, detail::path_element_hash{}(value_name), op, options, 0, group, subtree);
+        group.wait();
+    }
+    subtree.combine_into(result, op);
+
+    return result.result(op);
+}
+
+template <typename T>
+void node::aggregate_subtree(std::string_view value_name, size_t value_hash, aggregate_op op,
+                             const traversal_options& options, size_t depth, detail::task_group& group,
+                             detail::subtree_aggregate<T>& result) const
+{
+    std::vector<T> buffer;
+    if (depth >= options.max_fork_depth)
+    {
+        gather_values(value_name, value_hash, buffer);
+        result.own = detail::partial_aggregate<T>::reduce(buffer, op);
+        return;
+    }
+
+    if (deleted())
+        return;
+
+    std::vector<std::shared_ptr<node>> forked;
+    std::vector<std::shared_ptr<node>> leaves;
+    for (const std::shared_ptr<node>& subnode : subnodes())
+        (subnode->subnodes_.size() > 0 ? forked : leaves).push_back(subnode);
+
+    // Sized before any task starts, so the tasks can fill in their parts without a lock
+    result.forked.resize(forked.size());
+    for (size_t i = 0; i < forked.size(); ++i)
+    {
+        group.run([&options, &group, value_name, value_hash, op, depth, subnode = forked[i],
+                   part = &result.forked[i]]() {
+            subnode->aggregate_subtree(value_name, value_hash, op, options, depth + 1, group, *part);
+        });
+    }
+
+    gather_value(value_name, value_hash, buffer);
+
+    for (const std::shared_ptr<node>& leaf : leaves)
+        leaf->gather_values(value_name, value_hash, buffer);
+
+    result.own = detail::partial_aggregate<T>::reduce(buffer, op);
+}
+
+template <typename T>
+void node::gather_value(std::string_view value_name, size_t value_hash, std::vector<T>& buffer) const
+{
+    wait_unlocked();
+    values_.visit(value_name, value_hash, [&](const attr& a) {
+        if (const T* value = std::get_if<T>(&a.value_))
+            buffer.push_back(*value);
+    });
+}
+
+template <typename T>
+void node::gather_values(std::string_view value_name, size_t value_hash, std::vector<T>& buffer) const
+{
+    if (deleted())
         return;
 
-    values_.for_each(f);
+    gather_value(value_name, value_hash, buffer);
+
+    // Bucket locks are not held while gathering the values of the subnodes
+    subnodes_.for_each_snapshot([&](const std::shared_ptr<node>& subnode) {
+        subnode->gather_values(value_name, value_hash, buffer);
+    });
+}
+
+template <typename Names, typename Write>
+auto node::write_indexed(uint64_t stamp, const Names& written_names, Write write)
+{
+    if (!context_ || !context_->indexes.active())
+        return write(record_overwrite(stamp));
+
+    detail::value_indexes& indexes = context_->indexes;
+    std::shared_lock lock(indexes.mutex());
+
+    std::vector<detail::value_indexes::index*> locked;
+    if constexpr (std::is_same_v<Names, any_value_name>)
+    {
+        indexes.for_each_index([&](detail::value_indexes::index& i) {
+            locked.push_back(&i);
+        });
+    }
+    else
+    {
+        written_names([&](std::string_view value_name) {
+            if (detail::value_indexes::index* i = indexes.find(value_name))
+                locked.push_back(i);
+        });
+    }
+
+    // Writes of values which aren't indexed don't wait for anything
+    if (locked.empty())
+    {
+        lock.unlock();
+        return write(record_overwrite(stamp));
+    }
+
+    detail::value_indexes::lock(locked);
+
+    std::vector<std::pair<detail::value_indexes::index*, value_type>> overwritten;
+    auto result = write([&, record = record_overwrite(stamp)](std::string_view value_name, const attr* old_value,
+                                                               const attr* new_value) {
+        record(value_name, old_value, new_value);
+        if (!old_value)
+            return;
+        if (detail::value_indexes::index* i = indexes.find(value_name))
+            overwritten.emplace_back(i, old_value->value_);
+    });
+
+    for (const auto& [i, value] : overwritten)
+        i->erase(value, this);
+
+    // Deletion of the node removes its values from the indexes while holding the locks too
+    if (!deleted())
+    {
+        for (detail::value_indexes::index* i : locked)
+        {
+            if (const std::optional<attr> a = values_.find(i->value_name))
+                i->insert(a->value_, this, weak_from_this());
+        }
+    }
+
+    detail::value_indexes::unlock(locked);
+
+    return result;
+}
+
+template <typename Names, typename Write>
+auto node::write_watched(uint64_t stamp, const Names& written_names, Write write)
+{
+    if (!context_ || (!context_->watches.active() && !context_->changes.enabled()))
+        return write_indexed(stamp, written_names, std::move(write));
+
+    // Changes are reported by the write hook under the bucket lock, so the changes of every value are reported
+    // in the order they are made and concurrent writes of other values aren't mistaken for this one
+    const std::unique_lock lock = lock_changes();
+    const std::vector<watch_target> targets = find_watch_targets();
+    return write_indexed(stamp, written_names, [&](auto on_write) {
+        return write([&](std::string_view value_name, const attr* old_value, const attr* new_value) {
+            on_write(value_name, old_value, new_value);
+            report_value_change(targets, value_name, old_value, new_value);
+        });
+    });
 }
 
 template <typename T, typename>
 [[nodiscard]] std::optional<T> node::get_value(const std::string& value_name) const
 {
-    if (deleted_)
+    if (deleted())
         return std::nullopt;
 
-    const auto opt = values_.find(value_name);
+    wait_unlocked();
+    const auto opt = values_.find(std::string_view(value_name));
     if (!opt)
         return std::nullopt;
 
@@ -249,26 +1387,28 @@ template <typename T, typename>
 template <typename T, typename>
 bool node::set_value(const std::string& value_name, T&& new_value)
 {
-    if (deleted_)
-        return false;
-
-    if (value_name.size() > max_value_name_size_bytes)
-    {
+    if (deleted())
         return false;
-    }
 
     value_type value = std::forward<T>(new_value);
-    const value_kind kind = static_cast<value_kind>(value.index());
-    if (kind == value_kind::str && std::get<std::string>(value).size() > max_str_value_size_bytes)
-    {
+    if (!valid_value(value_name, value))
         return false;
-    }
-    if (kind == value_kind::bin && std::get<binary_blob_t>(value).size() > max_bin_value_size_bytes)
-    {
+
+    const plain_write_guard guard(*this);
+    const detail::write_scope scope;
+    attr a(value_name, std::move(value), context_->resource);
+    a.stamp_ = scope.stamp();
+    const auto written_names = [&](auto f) {
+        f(std::string_view(value_name));
+    };
+    const bool success = write_watched(scope.stamp(), written_names, [&](auto on_write) {
+        return values_.assign_or_insert_with_limit(std::string_view(value_name), std::move(a), max_num_values,
+                                                   on_write);
+    });
+    if (!success)
         return false;
-    }
 
-    attr a(value_name, std::move(value));
-    return values_.assign_or_insert_with_limit(value_name, std::move(a), max_num_values);
+    bump_version();
+    return true;
 }
 } // namespace datastore
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "datastore/detail/sorted_index.hpp"
 #include "datastore/detail/sorted_list.hpp"
 #include "datastore/detail/striped_hashmap.hpp"
 #include "datastore/node.hpp"
@@ -8,14 +9,66 @@ namespace datastore
 {
 class vault;
 
+class node_view;
+
 namespace detail
 {
 // Compares nodes based on volume priority
 bool compare_nodes(const std::shared_ptr<node>& n1, const std::shared_ptr<node>& n2);
+
+// Full path of a node view given by the full path of another node view and a path relative to it
+// Compared with the full paths stored in a view_index without concatenating the parts
+struct joined_path
+{
+    std::string_view prefix;
+    std::string_view suffix;
+
+    // Same as path_element_hash of the concatenated path
+    [[nodiscard]] size_t hash() const noexcept
+    {
+        const uint64_t prefix_hash = hash_path_element(prefix);
+        const uint64_t separator_hash =
+            hash_path_element(std::string_view(&path_view::path_separator, 1), prefix_hash);
+        return static_cast<size_t>(hash_path_element(suffix, separator_hash));
+    }
+};
+
+inline bool operator==(const std::string& full_path, const joined_path& path)
+{
+    const std::string_view full_path_view = full_path;
+    return full_path_view.size() == path.prefix.size() + 1 + path.suffix.size() &&
+           full_path_view.substr(0, path.prefix.size()) == path.prefix &&
+           full_path_view[path.prefix.size()] == path_view::path_separator &&
+           full_path_view.substr(path.prefix.size() + 1) == path.suffix;
 }
 
+// Node views of a vault by their full paths, shared by all node views of the vault
+// Lets a node view open a subview several levels deep with a single lookup instead of walking through the levels.
+// Removed node views are retired, so a node view found in the index stays valid while the epoch is pinned.
+struct view_index
+{
+    static constexpr unsigned num_buckets = 1031;
+
+    striped_hashmap<std::string, std::shared_ptr<node_view>, path_element_hash, bucket_mutex> views{num_buckets};
+
+    // Number of subtrees being mounted or unloaded with a deferred teardown, their node views are partly indexed
+    // Lookups check the ancestors of a found node view while it's non-zero.
+    std::atomic_size_t num_partial_subtrees = 0;
+
+    // Set once the vault is destroyed, node views which outlive it walk the paths instead
+    std::atomic_bool closed = false;
+
+    // Bumped by the observed nodes on every write and by the node views whenever their subviews change
+    // Registered on the nodes like the versions of the node views, so vault::freeze() checks it with a single load.
+    std::shared_ptr<std::atomic<uint64_t>> version = std::make_shared<std::atomic<uint64_t>>(0);
+};
+} // namespace detail
+
 class node_view final : public detail::node_observer
 {
+    friend class frozen_vault;
+    friend class snapshot;
+    friend class transaction;
     friend class vault;
 
     friend std::ostream& operator<<(std::ostream& lhs, const node_view& rhs);
@@ -27,6 +80,9 @@ class node_view final : public detail::node_observer
     // Maximum number of values a node_view can observe
     static constexpr size_t max_num_values = 10;
 
+    // Maximum number of value names a node_view remembers the resolution of
+    static constexpr size_t max_num_resolutions = 64;
+
     node_view(const node_view& other) = delete;
 
     node_view(node_view&& other) noexcept;
@@ -45,24 +101,61 @@ class node_view final : public detail::node_observer
     // The subnode can be several levels deep in the volume tree
     std::shared_ptr<node_view> open_subnode(path_view subview_path) const;
 
+    // Retrieves the specified subnode without taking a shared ownership of it
+    // Cheaper than open_subnode() when the subnode is accessed from many threads at once
+    borrowed_ptr<node_view> borrow_subnode(path_view subview_path) const;
+
     // Creates a subnode and loads the data from the specified node into that subnode
     std::shared_ptr<node_view> load_subnode_tree(const std::shared_ptr<node>& subnode);
 
+    // Same as load_subnode_tree(), but meant for large trees
+    // Subviews are built by the threads of a work stealing pool before any of them is visible, the whole subtree
+    // appears at once. Subnodes merged into an already loaded subview are loaded by load_subnode_tree().
+    std::shared_ptr<node_view> mount_subnode_tree(const std::shared_ptr<node>& subnode,
+                                                  const traversal_options& options = {});
+
     // Unloads the specified subnode and its subnodes from the vault
     // This function removes a subnode from the vault but does not modify the volume containing the information.
-    bool unload_subnode_tree(path_view subview_name);
-    void unload_subnode_tree();
+    // With a deferred teardown the unloaded subnodes are detached and expired right away,
+    // their subnodes expire once the background thread reaches them.
+    bool unload_subnode_tree(path_view subview_name, teardown mode = teardown::immediate);
+    void unload_subnode_tree(teardown mode = teardown::immediate);
 
     // Deletes a subnode and any child subnodes recursively
-    bool delete_subview_tree(path_view subview_name);
+    // With a deferred teardown the subnode disappears from the vault once the background thread reaches it
+    bool delete_subview_tree(path_view subview_name, teardown mode = teardown::immediate);
 
     // Deletes all subnodes and any child subnodes recursively
-    bool delete_subview_tree();
+    bool delete_subview_tree(teardown mode = teardown::immediate);
 
-    // Iterates over subnodes that exist in the nodes being observed
+    // Iterates over a snapshot of the subviews, no locks are held while the function is called
+    // so it can safely access this node view and any other node views, e.g. read their values.
     template <typename Function>
     void for_each_subnode(Function f) const;
 
+    // Calls the function for every subview of this node view and all of their subviews recursively
+    // Subtrees are visited concurrently by the threads of a work stealing pool, so the function must be thread-safe.
+    // A subview is always visited before its subviews, no locks are held while the function is called.
+    // Function must have a following signature: void func(const std::shared_ptr<datastore::node_view>&);
+    template <typename Function>
+    void parallel_for_each_subnode(Function f, const traversal_options& options = {}) const;
+
+    // Calls the function for the subviews with names in the range [first, last) in the name order
+    // An empty last name means that the range is not bounded from above.
+    // Sorted order is kept until subviews are added or removed, so repeated scans don't sort the subviews again.
+    // Function must have a following signature: void func(const std::shared_ptr<datastore::node_view>&);
+    template <typename Function>
+    void for_each_subnode_in_range(std::string_view first, std::string_view last, Function f) const;
+
+    // Calls the function for the subviews with names starting with the prefix in the name order
+    template <typename Function>
+    void for_each_subnode_with_prefix(std::string_view prefix, Function f) const;
+
+    // Retrieves at most max_count subviews with names following the given one in the name order
+    // Name of the last subview of a page is the cursor for the next page, an empty name starts from the beginning.
+    [[nodiscard]] std::vector<std::shared_ptr<node_view>> list_subnodes(std::string_view after,
+                                                                        size_t max_count) const;
+
     // Deletes the specified value from this node
     size_t delete_value(const std::string& value_name);
 
@@ -80,11 +173,48 @@ class node_view final : public detail::node_observer
     template <typename T, typename = std::enable_if_t<std::is_constructible_v<value_type, T>>>
     bool set_value(const std::string& value_name, T&& new_value);
 
+    // Calls the function for every subview whose path relative to this node view matches the pattern
+    // Function must have a following signature: void func(const std::shared_ptr<datastore::node_view>&);
+    // Subviews are collected before the function is called, so no locks are held during the calls.
+    // Parallel queries match the subtrees of the subviews concurrently, so the function must be thread-safe.
+    template <typename Function>
+    void query(const path_pattern& pattern, Function f, bool parallel = false) const;
+
+    // Retrieves all subviews whose paths relative to this node view match the pattern
+    [[nodiscard]] std::vector<std::shared_ptr<node_view>> query(const path_pattern& pattern) const;
+
+    // Aggregates values with the given name and type seen by this node view and all of its subviews
+    // Value of each node view is resolved based on the priority of the observed nodes.
+    // Subtrees are forked to other threads down to the fork depth, values of other types are ignored.
+    template <typename T, typename = std::enable_if_t<detail::aggregatable<T>::value>>
+    [[nodiscard]] std::optional<T> aggregate(const std::string& value_name, aggregate_op op,
+                                             const traversal_options& options = {}) const;
+
+    // Sets several values at once, see apply_batch()
+    bool set_values(std::initializer_list<std::pair<std::string_view, value_type>> values);
+
+    // Applies all updates of the batch to the observed node with the highest priority which accepts them
+    // Deletions only affect that node, values with the same names in other nodes become visible
+    bool apply_batch(const value_batch& batch);
+
     // Iterates over values stored in the nodes observed by this node view
+    // A value is skipped if a node with a higher priority has a value with the same name.
+    // Merged values are kept until the observed nodes change, no locks are held while the function is called.
     // Function must have a following signature: void func(const datastore::attr&);
     template <typename Function>
     void for_each_value(Function f) const;
 
+    // Same as for_each_value(), but also passes the priority of the volume the value comes from
+    // Function must have a following signature: void func(const datastore::attr&, uint8_t);
+    template <typename Function>
+    void for_each_value_with_priority(Function f) const;
+
+    // Delivers the changes of the values of the observed nodes to the watcher, see node::watch_values()
+    // Changes of every observed node are reported separately, even if a node with a higher priority hides them.
+    // Nodes loaded into the node view after the call are not watched.
+    [[nodiscard]] std::shared_ptr<value_watch> watch_values(value_watcher watcher,
+                                                            watch_scope scope = watch_scope::node);
+
     // Gets the name of the node_view
     [[nodiscard]] std::string_view name() const;
 
@@ -96,25 +226,266 @@ class node_view final : public detail::node_observer
     [[nodiscard]] bool expired() const;
 
   private:
-    node_view(path_view full_path);
+    node_view(path_view full_path, std::shared_ptr<detail::view_index> index = nullptr);
 
     void on_create_subnode(const std::shared_ptr<node>& subnode) override;
     void on_delete_subnode(const std::shared_ptr<node>& subnode) override;
 
+    // Makes a subview with the given name when called, so looking up an existing subview doesn't allocate
+    auto subview_factory(std::string_view subview_name) const
+    {
+        return [this, subview_name]() {
+            return std::shared_ptr<node_view>(new node_view(full_path_view_ + std::string(subview_name), index_));
+        };
+    }
+
+    // Observed nodes and their versions taken before the nodes were read
+    using node_versions = std::vector<std::pair<std::shared_ptr<node>, uint64_t>>;
+
+    // Value resolved for a name along with what it depends on
+    struct resolution
+    {
+        // Version of the node view the value was resolved at
+        uint64_t version = 0;
+
+        // First node in the priority order which has the value
+        std::shared_ptr<node> holder;
+
+        // Always holds the value, names which none of the nodes has are not cached
+        std::optional<value_type> value;
+    };
+
+    // Values of the observed nodes merged by name along with what they depend on
+    struct merged_values
+    {
+        // Generation of the observed nodes the values were merged from
+        uint64_t nodes_generation = 0;
+
+        // Nodes which were not deleted at the time
+        node_versions read_nodes;
+
+        // Value of the first node which has it and the priority of that node
+        std::vector<std::pair<attr, uint8_t>> values;
+    };
+
+    // Starts observing the node, the cached values become stale
+    // Returns false if the node is already observed
+    bool add_node(const std::shared_ptr<node>& n);
+
+    // Stops observing the nodes matching the predicate, the cached values become stale
+    template <typename Predicate>
+    void remove_nodes(Predicate p);
+
+    // Drops the cached values after the set of the observed nodes has changed
+    void drop_cached_values();
+
+    // Makes the frozen image of the vault stale, called after the subviews have changed
+    void bump_vault_version() const;
+
+    // Checks that the set of the observed nodes and the read nodes haven't changed since the given generation
+    bool unchanged(uint64_t nodes_generation, const node_versions& nodes) const;
+
+    // Calls the function with the value of the observed node with the highest priority which has it
+    // The resolution is cached until the version of the node view changes, so a repeated read checks a single
+    // version instead of probing every node stacked above the one holding the value.
+    // The function may be called under a bucket lock of the cache, so it must not access this node view.
+    template <typename Function>
+    void resolve_value(const std::string& value_name, Function f) const;
+
+    // Probes the observed nodes and caches the resolution, a node held by a committing transaction is waited for
+    std::optional<value_type> resolve_uncached(const std::string& value_name) const;
+
+    // Checks that nothing the resolution depends on has changed
+    bool fresh(const resolution& r) const;
+
+    // Checks that nothing the merged values depend on has changed
+    bool fresh(const merged_values& merged) const;
+
+    // Returns the merged values of the observed nodes, merging them again only if the nodes have changed
+    // Merging is done without an allocation per call once the nodes settle, callers share the result.
+    std::shared_ptr<const merged_values> merge_values() const;
+
+    // Makes the subview reachable through the index of the vault
+    void index_subview(const std::shared_ptr<node_view>& subview) const;
+
+    // Removes the subview from the index of the vault, the subview is retired rather than released
+    void unindex_subview(const node_view& subview) const;
+
+    // Checks whether the index of the vault can be used for lookups
+    [[nodiscard]] bool indexed() const;
+
+    // Finds the subview through the index of the vault, the epoch must stay pinned while the result is in use
+    // The owning pointer is also copied if requested, so the subview can be handed out
+    node_view* find_indexed_pinned(path_view subview_path, std::shared_ptr<node_view>* owner = nullptr) const;
+
+    // Observed nodes paired with the node views which observe them
+    using node_observations = std::vector<std::pair<std::shared_ptr<node>, std::shared_ptr<node_view>>>;
+
+    // Builds the subviews of a node view which is not reachable yet, subtrees are built by the tasks of the group
+    // Every task registers the observers of the subviews it has built together once it's done.
+    static void build_subtree(const std::shared_ptr<node_view>& view, const std::shared_ptr<node>& n,
+                              const traversal_options& options, size_t depth, detail::task_group& group,
+                              std::atomic_bool& failed);
+    static void build_subviews(const std::shared_ptr<node_view>& view, const std::shared_ptr<node>& n,
+                               const traversal_options& options, size_t depth, detail::task_group& group,
+                               std::atomic_bool& failed, node_observations& observations);
+
+    // Unloads the subviews even if this node view has already expired
+    void unload_subviews();
+
+    // Hands the unloading of an already detached and expired subview over to the reclaimer
+    static void defer_unload(std::shared_ptr<node_view> subview);
+
+    // Appends the values of the subtree to the buffer
+    template <typename T>
+    void gather_values(const std::string& value_name, std::vector<T>& buffer) const;
+
+    // Aggregates the values of the subtree, subviews without subviews of their own aren't worth a task
+    template <typename T>
+    void aggregate_subtree(const std::string& value_name, aggregate_op op, const traversal_options& options,
+                           size_t depth, detail::task_group& group, detail::subtree_aggregate<T>& result) const;
+
+    // Collects the subviews, so no locks are held while they are processed
+    std::vector<std::shared_ptr<node_view>> subviews() const;
+
+    template <typename Function>
+    void visit_subtree_parallel(Function& f, const traversal_options& options, size_t depth,
+                                detail::task_group& group) const;
+
+    // Subviews which can match the next element of the pattern
+    std::vector<std::shared_ptr<node_view>> query_candidates(const path_pattern& pattern,
+                                                             path_pattern::state_set states) const;
+
+    template <typename Function>
+    static void query_subtree(const std::shared_ptr<node_view>& subview, const path_pattern& pattern,
+                              path_pattern::state_set parent_states, Function& f);
+
+    // Walks the path down to the parent of its last element without touching reference counters
+    // The epoch must stay pinned while the result is in use
+    const node_view* find_parent_pinned(path_view& subview_path) const;
+
     std::string full_path_str_; // Holds a string which is accessed by a path_view object below
     path_view full_path_view_;
-    detail::striped_hashmap<std::string, std::shared_ptr<node_view>> subviews_;
+    detail::striped_hashmap<std::string, std::shared_ptr<node_view>, detail::path_element_hash, detail::bucket_mutex>
+        subviews_;
+    detail::sorted_index<std::shared_ptr<node_view>> sorted_subviews_;
     detail::sorted_list<std::shared_ptr<node>, decltype(&detail::compare_nodes)> nodes_;
+
+    // Incremented every time a node is added to or removed from nodes_
+    std::atomic<uint64_t> nodes_generation_ = 0;
+
+    // Bumped by the observed nodes after every write of their values and whenever the observed nodes change
+    std::shared_ptr<std::atomic<uint64_t>> version_ = std::make_shared<std::atomic<uint64_t>>(0);
+    mutable detail::striped_hashmap<std::string, resolution, detail::path_element_hash, detail::bucket_mutex>
+        resolutions_;
+    mutable std::mutex merged_mutex_;
+    mutable std::shared_ptr<const merged_values> merged_;
     std::atomic_bool expired_ = false;
+
+    // Index of all node views of the vault, null for node views which don't belong to a vault
+    std::shared_ptr<detail::view_index> index_;
 };
 
+template <typename Predicate>
+void node_view::remove_nodes(Predicate p)
+{
+    nodes_.remove_if([&](const std::shared_ptr<node>& n) {
+        if (!p(n))
+            return false;
+
+        n->remove_view_version(version_.get());
+        if (index_)
+            n->remove_view_version(index_->version.get());
+        return true;
+    });
+    drop_cached_values();
+}
+
+template <typename Function>
+void node_view::resolve_value(const std::string& value_name, Function f) const
+{
+    bool hit = false;
+    resolutions_.visit(value_name, detail::path_element_hash{}(value_name), [&](const resolution& r) {
+        hit = fresh(r);
+        if (hit)
+            f(r.value);
+    });
+
+    if (!hit)
+        f(resolve_uncached(value_name));
+}
+
 template <typename Function>
 void node_view::for_each_subnode(Function f) const
 {
     if (expired_)
         return;
 
-    subviews_.for_each(f);
+    subviews_.for_each_snapshot(f);
+}
+
+template <typename Function>
+void node_view::parallel_for_each_subnode(Function f, const traversal_options& options) const
+{
+    if (expired_)
+        return;
+
+    detail::task_group group(detail::thread_pool::instance(), options.max_parallelism);
+    visit_subtree_parallel(f, options, 0, group);
+    group.wait();
+}
+
+template <typename Function>
+void node_view::visit_subtree_parallel(Function& f, const traversal_options& options, size_t depth,
+                                       detail::task_group& group) const
+{
+    for (const std::shared_ptr<node_view>& subview : subviews())
+    {
+        f(subview);
+
+        if (depth < options.max_fork_depth)
+        {
+            group.run([&f, &options, &group, subview, depth]() {
+                subview->visit_subtree_parallel(f, options, depth + 1, group);
+            });
+        }
+        else
+        {
+            subview->visit_subtree_parallel(f, options, depth + 1, group);
+        }
+    }
+}
+
+template <typename Function>
+void node_view::for_each_subnode_in_range(std::string_view first, std::string_view last, Function f) const
+{
+    if (expired_)
+        return;
+
+    sorted_subviews_.for_each_from(subviews_, first, true, [&](const std::shared_ptr<node_view>& subview) {
+        if (!last.empty() && subview->name() >= last)
+            return false;
+
+        if (!subview->expired())
+            f(subview);
+        return true;
+    });
+}
+
+template <typename Function>
+void node_view::for_each_subnode_with_prefix(std::string_view prefix, Function f) const
+{
+    if (expired_)
+        return;
+
+    sorted_subviews_.for_each_from(subviews_, prefix, true, [&](const std::shared_ptr<node_view>& subview) {
+        if (subview->name().substr(0, prefix.size()) != prefix)
+            return false;
+
+        if (!subview->expired())
+            f(subview);
+        return true;
+    });
 }
 
 template <typename Function>
@@ -123,18 +494,134 @@ void node_view::for_each_value(Function f) const
     if (expired_)
         return;
 
-    std::unordered_map<std::string, attr> values;
+    const std::shared_ptr<const merged_values> merged = merge_values();
+    for (const auto& [a, priority] : merged->values)
+        f(a);
+}
+
+template <typename Function>
+void node_view::for_each_value_with_priority(Function f) const
+{
+    if (expired_)
+        return;
+
+    const std::shared_ptr<const merged_values> merged = merge_values();
+    for (const auto& [a, priority] : merged->values)
+        f(a, priority);
+}
+
+template <typename Function>
+void node_view::query(const path_pattern& pattern, Function f, bool parallel) const
+{
+    if (!pattern.valid() || expired_)
+        return;
+
+    const path_pattern::state_set states = pattern.initial();
+    const std::vector<std::shared_ptr<node_view>> candidates = query_candidates(pattern, states);
 
-    // Take care of a case when multiple nodes might have a value with the same name
-    // by storing values in a map first
-    nodes_.for_each([&](const std::shared_ptr<node>& node) {
-        node->for_each_value([&](const attr& a) {
-            values.emplace(a.name(), a);
+    if (!parallel)
+    {
+        for (const std::shared_ptr<node_view>& subview : candidates)
+            query_subtree(subview, pattern, states, f);
+        return;
+    }
+
+    detail::task_group group(detail::thread_pool::instance(), traversal_options().max_parallelism);
+    for (const std::shared_ptr<node_view>& subview : candidates)
+    {
+        group.run([&, subview]() {
+            query_subtree(subview, pattern, states, f);
         });
-    });
+    }
+    group.wait();
+}
 
-    for (const auto& [key, value] : values)
-        f(value);
+template <typename Function>
+void node_view::query_subtree(const std::shared_ptr<node_view>& subview, const path_pattern& pattern,
+                              path_pattern::state_set parent_states, Function& f)
+{
+    const path_pattern::state_set states = pattern.advance(parent_states, subview->name());
+    if (pattern.accepts(states))
+        f(subview);
+
+    // Subtrees which can't match the rest of the pattern are skipped
+    if (!pattern.expects_more(states))
+        return;
+
+    for (const std::shared_ptr<node_view>& child : subview->query_candidates(pattern, states))
+        query_subtree(child, pattern, states, f);
+}
+
+template <typename T, typename>
+[[nodiscard]] std::optional<T> node_view::aggregate(const std::string& value_name, aggregate_op op,
+                                                    const traversal_options& options) const
+{
+    detail::partial_aggregate<T> result;
+    if (expired_)
+        return result.result(op);
+
+    detail::subtree_aggregate<T> subtree;
+    {
+        detail::task_group group(detail::thread_pool::instance(), options.max_parallelism);
+        aggregate_subtree(value_name, op, options, 0, group, subtree);
+        group.wait();
+    }
+    subtree.combine_into(result, op);
+
+    return result.result(op);
+}
+
+template <typename T>
+void node_view::aggregate_subtree(const std::string& value_name, aggregate_op op, const traversal_options& options,
+                                  size_t depth, detail::task_group& group, detail::subtree_aggregate<T>& result) const
+{
+    std::vector<T> buffer;
+    if (depth >= options.max_fork_depth)
+    {
+        gather_values(value_name, buffer);
+        result.own = detail::partial_aggregate<T>::reduce(buffer, op);
+        return;
+    }
+
+    if (expired_)
+        return;
+
+    std::vector<std::shared_ptr<node_view>> forked;
+    std::vector<std::shared_ptr<node_view>> leaves;
+    for (const std::shared_ptr<node_view>& subview : subviews())
+        (subview->subviews_.size() > 0 ? forked : leaves).push_back(subview);
+
+    // Sized before any task starts, so the tasks can fill in their parts without a lock
+    result.forked.resize(forked.size());
+    for (size_t i = 0; i < forked.size(); ++i)
+    {
+        group.run([&value_name, &options, &group, op, depth, subview = forked[i], part = &result.forked[i]]() {
+            subview->aggregate_subtree(value_name, op, options, depth + 1, group, *part);
+        });
+    }
+
+    if (const std::optional<T> value = get_value<T>(value_name))
+        buffer.push_back(*value);
+
+    for (const std::shared_ptr<node_view>& leaf : leaves)
+        leaf->gather_values(value_name, buffer);
+
+    result.own = detail::partial_aggregate<T>::reduce(buffer, op);
+}
+
+template <typename T>
+void node_view::gather_values(const std::string& value_name, std::vector<T>& buffer) const
+{
+    if (expired_)
+        return;
+
+    if (const std::optional<T> value = get_value<T>(value_name))
+        buffer.push_back(*value);
+
+    // Bucket locks are not held while gathering the values of the subviews
+    subviews_.for_each_snapshot([&](const std::shared_ptr<node_view>& subview) {
+        subview->gather_values(value_name, buffer);
+    });
 }
 
 template <typename T>
@@ -144,8 +631,22 @@ template <typename T>
         return std::nullopt;
 
     std::optional<T> value;
+    bool other_type = false;
 
     // Return a value from a node based on node/volume priority
+    resolve_value(value_name, [&](const std::optional<value_type>& resolved) {
+        if (!resolved)
+            return;
+
+        if (const T* v = std::get_if<T>(&*resolved))
+            value = *v;
+        else
+            other_type = true;
+    });
+    if (!other_type)
+        return value;
+
+    // A node with a lower priority might still have a value of the requested type
     nodes_.find_first_if([&](const std::shared_ptr<node>& node) {
         value = node->get_value<T>(value_name);
         return value;
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "datastore/path_view.hpp"
+
+namespace datastore
+{
+// Pattern matching paths relative to a node, e.g. "vol.*.metrics" or "**.metrics"
+// Elements are separated by dots, each element is either a name, "*" matching any single element
+// or "**" matching any number of elements including none.
+// The pattern is compiled once into a matcher which can be used for any number of queries.
+class path_pattern
+{
+    friend class node;
+    friend class node_view;
+
+  public:
+    constexpr static std::string_view any_element = "*";
+    constexpr static std::string_view any_elements = "**";
+
+    path_pattern(std::string_view pattern)
+        : pattern_(pattern)
+    {
+        valid_ = parse();
+    }
+
+    path_pattern(const char* pattern)
+        : path_pattern(std::string_view(pattern))
+    {
+    }
+
+    path_pattern(const std::string& pattern)
+        : path_pattern(std::string_view(pattern))
+    {
+    }
+
+    [[nodiscard]] bool valid() const noexcept
+    {
+        return valid_;
+    }
+
+    [[nodiscard]] size_t size() const noexcept
+    {
+        return elements_.size();
+    }
+
+    [[nodiscard]] std::string_view str() const noexcept
+    {
+        return pattern_;
+    }
+
+  private:
+    enum class element_kind : uint8_t
+    {
+        name,
+        any_element,
+        any_elements
+    };
+
+    // Names refer to the pattern string by offsets, so the pattern can be copied
+    struct element
+    {
+        element_kind kind;
+        uint16_t offset;
+        uint16_t length;
+        uint64_t hash;
+    };
+
+    // Set of pattern positions the matcher can be at, bit i means that i elements have been matched
+    using state_set = uint64_t;
+
+    bool parse()
+    {
+        if (pattern_.empty() || pattern_.size() > path_view::max_path_size_bytes)
+            return false;
+
+        const std::string_view pattern = pattern_;
+        size_t start = 0;
+        while (start <= pattern.size())
+        {
+            size_t end = pattern.find(path_view::path_separator, start);
+            if (end == std::string_view::npos)
+                end = pattern.size();
+
+            const std::string_view name = pattern.substr(start, end - start);
+            const auto offset = static_cast<uint16_t>(start);
+            const auto length = static_cast<uint16_t>(name.size());
+            if (name == any_element)
+                elements_.push_back({element_kind::any_element, offset, length, 0});
+            else if (name == any_elements)
+                elements_.push_back({element_kind::any_elements, offset, length, 0});
+            else if (!name.empty() && std::all_of(name.begin(), name.end(), detail::is_path_char))
+                elements_.push_back({element_kind::name, offset, length, detail::hash_path_element(name)});
+            else
+                return false;
+
+            if (elements_.size() > path_view::max_path_depth)
+                return false;
+
+            start = end + 1;
+        }
+
+        return true;
+    }
+
+    // Adds positions reachable without consuming a path element, i.e. skipping "**"
+    [[nodiscard]] state_set closure(state_set states) const noexcept
+    {
+        for (size_t i = 0; i < elements_.size(); ++i)
+        {
+            if ((states & (state_set(1) << i)) && elements_[i].kind == element_kind::any_elements)
+                states |= state_set(1) << (i + 1);
+        }
+        return states;
+    }
+
+    [[nodiscard]] state_set initial() const noexcept
+    {
+        return closure(1);
+    }
+
+    // Moves the matcher over a path element, no states left means that nothing below can match
+    [[nodiscard]] state_set advance(state_set states, std::string_view name) const noexcept
+    {
+        state_set next = 0;
+        for (size_t i = 0; i < elements_.size(); ++i)
+        {
+            if (!(states & (state_set(1) << i)))
+                continue;
+
+            const element& e = elements_[i];
+            if (e.kind == element_kind::any_elements)
+                next |= state_set(1) << i;
+            else if (e.kind == element_kind::any_element || name_of(e) == name)
+                next |= state_set(1) << (i + 1);
+        }
+        return closure(next);
+    }
+
+    // Checks whether the whole pattern has been matched
+    [[nodiscard]] bool accepts(state_set states) const noexcept
+    {
+        return states & (state_set(1) << elements_.size());
+    }
+
+    // Checks whether deeper elements can still be matched
+    [[nodiscard]] bool expects_more(state_set states) const noexcept
+    {
+        return states & ((state_set(1) << elements_.size()) - 1);
+    }
+
+    // Checks whether only the elements with specific names can be matched next,
+    // in which case they can be looked up directly instead of iterating over all subnodes
+    [[nodiscard]] bool names_only(state_set states) const noexcept
+    {
+        for (size_t i = 0; i < elements_.size(); ++i)
+        {
+            if ((states & (state_set(1) << i)) && elements_[i].kind != element_kind::name)
+                return false;
+        }
+        return true;
+    }
+
+    // Calls the function once for every distinct name which can be matched next
+    template <typename Function>
+    void for_each_name(state_set states, Function f) const
+    {
+        for (size_t i = 0; i < elements_.size(); ++i)
+        {
+            if (!(states & (state_set(1) << i)))
+                continue;
+
+            bool seen = false;
+            for (size_t j = 0; j < i && !seen; ++j)
+                seen = (states & (state_set(1) << j)) && name_of(elements_[j]) == name_of(elements_[i]);
+
+            if (!seen)
+                f(name_of(elements_[i]), elements_[i].hash);
+        }
+    }
+
+    [[nodiscard]] std::string_view name_of(const element& e) const noexcept
+    {
+        return std::string_view(pattern_).substr(e.offset, e.length);
+    }
+
+    std::string pattern_;
+    std::vector<element> elements_;
+    bool valid_ = false;
+};
+} // namespace datastore
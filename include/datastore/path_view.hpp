@@ -1,12 +1,56 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <list>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 namespace datastore
 {
+class static_path;
+
+namespace detail
+{
+constexpr uint64_t path_hash_seed = 14695981039346656037ull;
+
+// FNV-1a hash of a path element
+// Usable in constant expressions, so literal paths can carry precomputed element hashes
+// Passing the hash of a prefix as a seed continues hashing, i.e. the result is the hash of the concatenation
+constexpr uint64_t hash_path_element(std::string_view element, uint64_t seed = path_hash_seed) noexcept
+{
+    uint64_t hash = seed;
+    for (const char c : element)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Hasher for maps keyed by path elements, matches the hashes stored in path_view
+struct path_element_hash
+{
+    size_t operator()(std::string_view element) const noexcept
+    {
+        return static_cast<size_t>(hash_path_element(element));
+    }
+};
+
+constexpr bool is_path_char(char c) noexcept
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+}
+
+// Intentionally not constexpr: reaching it while evaluating a literal path fails the compilation
+inline void invalid_path_literal() noexcept
+{
+}
+} // namespace detail
+
 // Paths in the form "^[a-zA-Z0-9]+(\.[a-zA-Z0-9]+)*$" are supported, e.g. "abc" or "a.b.c"
 // Only alphanumeric path elements are allowed, max length: 1024 characters
 class path_view
@@ -29,61 +73,80 @@ class path_view
     path_view& operator=(path_view const& other) = default;
     path_view& operator=(path_view&& other) noexcept = default;
 
+    // Borrows the already validated elements of a literal path without parsing or copying them
+    // Like the path string, the literal path must outlive the path_view.
+    path_view(const static_path& path);
+
     path_view(std::nullptr_t) = delete;
 
     [[nodiscard]] bool valid() const noexcept
     {
-        return valid_ && !elements_.empty();
+        return valid_ && num_elements() > 0;
     }
 
     [[nodiscard]] bool composite() const
     {
-        return valid_ && elements_.size() > 1;
+        return valid_ && num_elements() > 1;
     }
 
     [[nodiscard]] std::optional<std::string_view> front() const
     {
-        if (!valid_ || elements_.empty())
+        if (!valid())
             return std::nullopt;
 
-        return elements_.front();
+        return front_element().first;
+    }
+
+    // Hash of the first path element as computed by detail::path_element_hash
+    [[nodiscard]] size_t front_hash() const noexcept
+    {
+        if (!valid())
+            return 0;
+
+        return static_cast<size_t>(front_element().second);
     }
 
     [[nodiscard]] std::optional<std::string_view> back() const
     {
-        if (!valid_ || elements_.empty())
+        if (!valid())
             return std::nullopt;
 
-        return elements_.back();
+        return back_element().first;
     }
 
     void pop_front()
     {
-        if (!valid_ || elements_.empty())
+        if (!valid())
             return;
 
-        path_.remove_prefix(elements_.front().size());
+        path_.remove_prefix(front_element().first.size());
         if (!path_.empty() && path_.front() == path_separator)
             path_.remove_prefix(1);
 
-        elements_.pop_front();
+        if (literal_)
+            ++first_;
+        else
+            elements_.pop_front();
     }
 
     void pop_back()
     {
-        if (!valid_ || elements_.empty())
+        if (!valid())
             return;
 
-        path_.remove_suffix(elements_.back().size());
+        path_.remove_suffix(back_element().first.size());
         if (!path_.empty() && path_.back() == path_separator)
             path_.remove_suffix(1);
 
-        elements_.pop_back();
+        if (literal_)
+            --last_;
+        else
+            elements_.pop_back();
     }
 
     [[nodiscard]] size_t size() const noexcept
     {
-        return valid_ ? elements_.size() : 0;
+        return valid_ ? num_elements() : 0;
     }
 
     [[nodiscard]] std::string str() const
@@ -97,6 +160,21 @@ class path_view
     }
 
   private:
+    using element = std::pair<std::string_view, uint64_t>;
+
+    [[nodiscard]] size_t num_elements() const noexcept
+    {
+        return literal_ ? last_ - first_ : elements_.size();
+    }
+
+    [[nodiscard]] element front_element() const noexcept;
+    [[nodiscard]] element back_element() const noexcept;
+
+    void add_element(std::string_view name)
+    {
+        elements_.emplace_back(name, detail::hash_path_element(name));
+    }
+
     bool parse(std::string_view path)
     {
         if (path.size() > max_path_size_bytes)
@@ -121,27 +199,177 @@ class path_view
             if (end == std::string_view::npos)
                 break;
 
-            elements_.emplace_back(&path[start], end - start);
+            add_element(std::string_view(&path[start], end - start));
 
             start = end + 1;
         }
 
         if (start < path.size())
-            elements_.emplace_back(&path[start], path.size() - start);
+            add_element(std::string_view(&path[start], path.size() - start));
         else
-            elements_.emplace_back("");
+            add_element("");
 
         // Check that all path elements are not empty
-        return std::all_of(elements_.begin(), elements_.end(), [](auto element) {
-            return !element.empty();
+        return std::all_of(elements_.begin(), elements_.end(), [](const element& e) {
+            return !e.first.empty();
         });
     }
 
     std::string_view path_;
-    std::list<std::string_view> elements_;
+    std::list<element> elements_;
+
+    // Literal paths keep their elements in the static_path, [first_, last_) is the range still in the view
+    const static_path* literal_ = nullptr;
+    size_t first_ = 0;
+    size_t last_ = 0;
+
     bool valid_;
 };
 
+// Path validated and split at compile time, see literals::operator""_path
+// Keeps element offsets and hashes so that lookups don't need to parse or hash the path at runtime
+class static_path
+{
+    friend class path_view;
+
+  public:
+    constexpr explicit static_path(std::string_view path)
+        : path_(path)
+    {
+        valid_ = parse();
+        if (!valid_)
+            detail::invalid_path_literal();
+    }
+
+    [[nodiscard]] constexpr bool valid() const noexcept
+    {
+        return valid_;
+    }
+
+    [[nodiscard]] constexpr size_t size() const noexcept
+    {
+        return valid_ ? size_ : 0;
+    }
+
+    [[nodiscard]] constexpr std::string_view element(size_t idx) const noexcept
+    {
+        return path_.substr(offsets_[idx], lengths_[idx]);
+    }
+
+    [[nodiscard]] constexpr uint64_t element_hash(size_t idx) const noexcept
+    {
+        return hashes_[idx];
+    }
+
+    [[nodiscard]] constexpr std::string_view str() const noexcept
+    {
+        return valid_ ? path_ : std::string_view();
+    }
+
+  private:
+    // Same rules as path_view::parse()
+    constexpr bool parse()
+    {
+        if (path_.empty() || path_.size() > path_view::max_path_size_bytes)
+            return false;
+
+        size_t start = 0;
+        for (size_t i = 0; i <= path_.size(); ++i)
+        {
+            if (i < path_.size() && detail::is_path_char(path_[i]))
+                continue;
+
+            if (i < path_.size() && path_[i] != path_view::path_separator)
+                return false;
+
+            // Empty elements and paths deeper than the limit are not allowed
+            if (i == start || size_ > path_view::max_path_depth)
+                return false;
+
+            offsets_[size_] = static_cast<uint16_t>(start);
+            lengths_[size_] = static_cast<uint16_t>(i - start);
+            hashes_[size_] = detail::hash_path_element(path_.substr(start, i - start));
+            ++size_;
+
+            start = i + 1;
+        }
+
+        return true;
+    }
+
+    std::string_view path_;
+    std::array<uint16_t, path_view::max_path_depth + 1> offsets_{};
+    std::array<uint16_t, path_view::max_path_depth + 1> lengths_{};
+    std::array<uint64_t, path_view::max_path_depth + 1> hashes_{};
+    size_t size_ = 0;
+    bool valid_ = false;
+};
+
+inline path_view::path_view(const static_path& path)
+    : path_(path.str()),
+      literal_(&path),
+      first_(0),
+      last_(path.size()),
+      valid_(path.valid())
+{
+}
+
+inline path_view::element path_view::front_element() const noexcept
+{
+    if (literal_)
+        return {literal_->element(first_), literal_->element_hash(first_)};
+
+    return elements_.front();
+}
+
+inline path_view::element path_view::back_element() const noexcept
+{
+    if (literal_)
+        return {literal_->element(last_ - 1), literal_->element_hash(last_ - 1)};
+
+    return elements_.back();
+}
+
+namespace detail
+{
+// Literal path stored for the whole run of the program, initializing it is a constant expression,
+// so an invalid literal fails the compilation wherever it is used
+template <char... Chars>
+struct path_literal
+{
+    static constexpr char chars[] = {Chars..., '\0'};
+    static constexpr static_path path{std::string_view(chars, sizeof...(Chars))};
+};
+} // namespace detail
+
+namespace literals
+{
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#ifdef __clang__
+#pragma GCC diagnostic ignored "-Wgnu-string-literal-operator-template"
+#endif
+
+// Literal paths are always validated at compile time: "a.b.c"_path
+template <typename Char, Char... Chars>
+constexpr const static_path& operator""_path()
+{
+    static_assert(std::is_same_v<Char, char>, "Only narrow literal paths are supported");
+    return detail::path_literal<Chars...>::path;
+}
+
+#pragma GCC diagnostic pop
+#else
+// Compilers without literal operator templates validate literal paths at compile time
+// only when used in a constant expression: constexpr auto path = "a.b.c"_path;
+constexpr static_path operator""_path(const char* path, size_t size)
+{
+    return static_path(std::string_view(path, size));
+}
+#endif
+} // namespace literals
+
 inline std::string operator+(const path_view& path, const std::string& str)
 {
     std::string result = path.str();
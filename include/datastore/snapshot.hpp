@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "datastore/node.hpp"
+
+namespace datastore
+{
+class node_view;
+
+// Reads values as they were at the moment the snapshot was taken
+// Writers are not blocked, values they overwrite are kept until all snapshots which can see them are destroyed,
+// so snapshots should be short-lived.
+// Only values are versioned, node views resolve their nodes as they are at the moment of the read.
+class snapshot final
+{
+    friend class vault;
+    friend class volume;
+
+  public:
+    snapshot(const snapshot& other) = delete;
+    snapshot(snapshot&& other) noexcept;
+
+    snapshot& operator=(const snapshot& rhs) = delete;
+    snapshot& operator=(snapshot&& rhs) noexcept;
+
+    ~snapshot();
+
+    // Retrieves the value associated with the specified name
+    template <typename T, typename = std::enable_if_t<detail::allowed<T>::value>>
+    [[nodiscard]] std::optional<T> get_value(const std::shared_ptr<node>& n, const std::string& value_name) const;
+
+    // Retrieves the value from the node with the highest priority which had it
+    template <typename T, typename = std::enable_if_t<detail::allowed<T>::value>>
+    [[nodiscard]] std::optional<T> get_value(const std::shared_ptr<node_view>& view,
+                                             const std::string& value_name) const;
+
+    // Retrieves the data type of the value associated with the specified name
+    [[nodiscard]] std::optional<value_kind> get_value_kind(const std::shared_ptr<node>& n,
+                                                           const std::string& value_name) const;
+    [[nodiscard]] std::optional<value_kind> get_value_kind(const std::shared_ptr<node_view>& view,
+                                                           const std::string& value_name) const;
+
+  private:
+    snapshot();
+
+    std::optional<value_type> read(const std::shared_ptr<node>& n, std::string_view value_name) const;
+    std::optional<value_type> read(const std::shared_ptr<node_view>& view, std::string_view value_name) const;
+
+    uint64_t time_;
+    bool active_ = true;
+};
+
+template <typename T, typename>
+[[nodiscard]] std::optional<T> snapshot::get_value(const std::shared_ptr<node>& n, const std::string& value_name) const
+{
+    const std::optional<value_type> value = read(n, value_name);
+    if (!value)
+        return std::nullopt;
+
+    const T* typed_value = std::get_if<T>(&*value);
+    return typed_value ? std::make_optional(*typed_value) : std::nullopt;
+}
+
+template <typename T, typename>
+[[nodiscard]] std::optional<T> snapshot::get_value(const std::shared_ptr<node_view>& view,
+                                                   const std::string& value_name) const
+{
+    const std::optional<value_type> value = read(view, value_name);
+    if (!value)
+        return std::nullopt;
+
+    const T* typed_value = std::get_if<T>(&*value);
+    return typed_value ? std::make_optional(*typed_value) : std::nullopt;
+}
+} // namespace datastore
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "datastore/node.hpp"
+
+namespace datastore
+{
+class node_view;
+
+// Reads and writes values of multiple nodes, so that the writes are applied all at once or not at all
+// Writes are buffered until commit() and are visible to the reads of the same transaction.
+// Commit fails if any node read or written by the transaction has been changed in the meantime,
+// in which case the transaction has to be started over.
+// Transaction must not be shared between threads.
+class transaction final
+{
+    friend class vault;
+    friend class volume;
+
+  public:
+    transaction(const transaction& other) = delete;
+    transaction(transaction&& other) noexcept = default;
+
+    transaction& operator=(const transaction& rhs) = delete;
+    transaction& operator=(transaction&& rhs) noexcept = default;
+
+    // Retrieves the value associated with the specified name
+    template <typename T, typename = std::enable_if_t<detail::allowed<T>::value>>
+    [[nodiscard]] std::optional<T> get_value(const std::shared_ptr<node>& n, const std::string& value_name);
+
+    // Retrieves the value from the node with the highest priority which has it
+    template <typename T, typename = std::enable_if_t<detail::allowed<T>::value>>
+    [[nodiscard]] std::optional<T> get_value(const std::shared_ptr<node_view>& view, const std::string& value_name);
+
+    // Sets the value of a name/value pair in the node once the transaction is committed
+    template <typename T, typename = std::enable_if_t<std::is_constructible_v<value_type, T>>>
+    bool set_value(const std::shared_ptr<node>& n, const std::string& value_name, T&& new_value);
+
+    // Sets the value in the observed node with the highest priority once the transaction is committed
+    template <typename T, typename = std::enable_if_t<std::is_constructible_v<value_type, T>>>
+    bool set_value(const std::shared_ptr<node_view>& view, const std::string& value_name, T&& new_value);
+
+    // Deletes the value from the node once the transaction is committed
+    bool delete_value(const std::shared_ptr<node>& n, const std::string& value_name);
+
+    // Deletes the value from the observed node with the highest priority which has it
+    bool delete_value(const std::shared_ptr<node_view>& view, const std::string& value_name);
+
+    // Checks that nothing read by the transaction has changed and applies the writes
+    // Transaction can't be used after the commit
+    bool commit();
+
+    // Checks whether the transaction can still be committed
+    [[nodiscard]] bool valid() const;
+
+  private:
+    struct read_record
+    {
+        std::shared_ptr<node> target;
+        uint64_t version;
+    };
+
+    struct write_record
+    {
+        std::shared_ptr<node> target;
+        value_batch batch;
+    };
+
+    transaction() = default;
+
+    std::optional<value_type> read(const std::shared_ptr<node>& n, std::string_view value_name);
+    std::optional<value_type> read(const std::shared_ptr<node_view>& view, std::string_view value_name);
+
+    bool write(const std::shared_ptr<node>& n, std::string_view value_name, std::optional<value_type> value);
+    bool write(const std::shared_ptr<node_view>& view, std::string_view value_name, value_type value);
+
+    // Locks written nodes in order, the versions they had before locking are stored for validation
+    // Fails if any of the nodes is deleted, in which case the nodes locked so far have to be unlocked
+    bool lock_writes(std::vector<uint64_t>& locked_versions);
+    bool validate_reads(const std::vector<uint64_t>& locked_versions) const;
+    bool writes_fit_limits() const;
+
+    std::vector<read_record> reads_;
+    std::vector<write_record> writes_;
+    bool valid_ = true;
+};
+
+template <typename T, typename>
+[[nodiscard]] std::optional<T> transaction::get_value(const std::shared_ptr<node>& n, const std::string& value_name)
+{
+    const std::optional<value_type> value = read(n, value_name);
+    if (!value)
+        return std::nullopt;
+
+    const T* typed_value = std::get_if<T>(&*value);
+    return typed_value ? std::make_optional(*typed_value) : std::nullopt;
+}
+
+template <typename T, typename>
+[[nodiscard]] std::optional<T> transaction::get_value(const std::shared_ptr<node_view>& view,
+                                                      const std::string& value_name)
+{
+    const std::optional<value_type> value = read(view, value_name);
+    if (!value)
+        return std::nullopt;
+
+    const T* typed_value = std::get_if<T>(&*value);
+    return typed_value ? std::make_optional(*typed_value) : std::nullopt;
+}
+
+template <typename T, typename>
+bool transaction::set_value(const std::shared_ptr<node>& n, const std::string& value_name, T&& new_value)
+{
+    return write(n, value_name, value_type(std::forward<T>(new_value)));
+}
+
+template <typename T, typename>
+bool transaction::set_value(const std::shared_ptr<node_view>& view, const std::string& value_name, T&& new_value)
+{
+    return write(view, value_name, value_type(std::forward<T>(new_value)));
+}
+} // namespace datastore
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <mutex>
+
+#include "datastore/frozen_vault.hpp"
 #include "datastore/node_view.hpp"
+#include "datastore/snapshot.hpp"
+#include "datastore/transaction.hpp"
 
 namespace datastore
 {
@@ -10,12 +15,73 @@ class vault final
     // Maximum depth of the vault node_views hierarchy
     constexpr static size_t max_tree_depth = 7;
 
+    vault() = default;
+
+    vault(const vault& other) = delete;
+    vault& operator=(const vault& rhs) = delete;
+
+    ~vault()
+    {
+        // Node views own the index and the index owns the node views, so the cycle is broken here
+        // Node views which outlive the vault walk the paths instead of using the index
+        detail::view_index& index = *root_->index_;
+        index.closed = true;
+        // Erased one by one, so no more than a single bucket of the index is locked at a time
+        for (const std::shared_ptr<node_view>& view : index.views.values())
+        {
+            index.views.erase_if(
+                view->full_path_str_,
+                [&](const std::shared_ptr<node_view>& indexed_view) {
+                    return indexed_view == view;
+                },
+                [](std::string_view, const std::shared_ptr<node_view>* removed, const std::shared_ptr<node_view>*) {
+                    detail::epoch_domain::instance().retire(*removed);
+                });
+        }
+    }
+
     std::shared_ptr<node_view> root()
     {
         return root_;
     }
 
+    // Unlike root() doesn't take a shared ownership of the root node view
+    borrowed_ptr<node_view> borrow_root() const
+    {
+        return borrowed_ptr<node_view>(detail::epoch_guard(), root_.get());
+    }
+
+    // Starts a transaction which can read and write values of multiple node views of this vault atomically
+    [[nodiscard]] transaction begin_transaction() const
+    {
+        return transaction();
+    }
+
+    // Takes a snapshot which reads values of node views as they are at this moment
+    // Writers active at this moment are waited for, writers which start later are not blocked
+    [[nodiscard]] datastore::snapshot snapshot() const
+    {
+        return datastore::snapshot();
+    }
+
+    // Compiles the values visible through the node views of this vault into an immutable image, see frozen_vault
+    // The image is reused until any node view or node of the vault changes, then it's built again.
+    // Checking the image loads a single version of the vault, so freezing an unchanged vault costs O(1).
+    [[nodiscard]] std::shared_ptr<const frozen_vault> freeze() const
+    {
+        std::scoped_lock lock(frozen_mutex_);
+        const uint64_t version = root_->index_->version->load();
+        if (!frozen_ || frozen_->vault_version_ != version)
+            frozen_ = frozen_vault::build(root_, version);
+
+        return frozen_;
+    }
+
   private:
-    std::shared_ptr<node_view> root_ = std::shared_ptr<node_view>(new node_view("root"));
+    std::shared_ptr<node_view> root_ =
+        std::shared_ptr<node_view>(new node_view("root", std::make_shared<detail::view_index>()));
+
+    mutable std::mutex frozen_mutex_;
+    mutable std::shared_ptr<const frozen_vault> frozen_;
 };
 } // namespace datastore
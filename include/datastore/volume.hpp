@@ -1,9 +1,12 @@
 #pragma once
 
 #include <filesystem>
+#include <memory_resource>
 #include <optional>
 
 #include "datastore/node.hpp"
+#include "datastore/snapshot.hpp"
+#include "datastore/transaction.hpp"
 
 namespace datastore
 {
@@ -12,11 +15,12 @@ namespace detail
 class serializer final
 {
   public:
-    std::optional<node> deserialize_node(path_view path, uint8_t volume_priority, std::vector<uint8_t>& buffer,
+    std::optional<node> deserialize_node(path_view path, uint8_t volume_priority,
+                                         const std::shared_ptr<volume_context>& context, std::vector<uint8_t>& buffer,
                                          size_t& pos);
     bool serialize_node(const node& n, std::vector<uint8_t>& buffer);
 
-    std::optional<volume> deserialize_volume(std::vector<uint8_t>& buffer);
+    std::optional<volume> deserialize_volume(std::vector<uint8_t>& buffer, std::pmr::memory_resource* resource);
     bool serialize_volume(volume& vol, std::vector<uint8_t>& buffer);
 };
 } // namespace detail
@@ -46,7 +50,19 @@ class volume final
     // Maximum depth of the nodes hierarchy
     constexpr static size_t max_tree_depth = 5;
 
-    volume(path_view root_name, priority_t priority);
+    // Maximum number of composite paths remembered by the volume to speed up repeated lookups
+    constexpr static size_t max_cached_paths = 128;
+
+    // All nodes of the volume, their values and containers are allocated from the given memory resource,
+    // so a pool or monotonic arena can be used to avoid heap fragmentation and release the memory in bulk.
+    // The memory resource has to be thread-safe if the volume is accessed concurrently
+    // and must outlive the volume and any node references obtained from it, e.g. held by vaults.
+    // A volume destroyed by a thread holding a borrowed pointer, even one of another volume,
+    // releases its nodes only once that thread releases the pointer.
+    // Destroying a volume waits for the background teardown and the observer notifications pending at that moment,
+    // except for those queued to the thread destroying it, e.g. when an observer destroys the volume.
+    volume(path_view root_name, priority_t priority,
+           std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
     volume(const volume& other) = delete;
     volume(volume&& other) noexcept = default;
@@ -54,21 +70,106 @@ class volume final
     volume& operator=(const volume& rhs) = delete;
     volume& operator=(volume&& rhs) noexcept = default;
 
+    ~volume();
+
     bool save(const std::filesystem::path& filepath);
-    static std::optional<volume> load(const std::filesystem::path& filepath);
+    static std::optional<volume> load(const std::filesystem::path& filepath,
+                                      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
     std::shared_ptr<node> root()
     {
         return root_;
     }
 
+    // Unlike root() doesn't take a shared ownership of the root node
+    borrowed_ptr<node> borrow_root() const
+    {
+        return borrowed_ptr<node>(detail::epoch_guard(), root_.get());
+    }
+
+    // Starts a transaction which can read and write values of multiple nodes of this volume atomically
+    [[nodiscard]] transaction begin_transaction() const
+    {
+        return transaction();
+    }
+
+    // Takes a snapshot which reads values of nodes as they are at this moment
+    [[nodiscard]] datastore::snapshot snapshot() const
+    {
+        return datastore::snapshot();
+    }
+
+    // Chooses how observers, e.g. vaults the volume is loaded into, learn about created and deleted nodes
+    // Asynchronous dispatch takes the notification of observers off the writer, so the writes stay fast
+    // no matter how many observers there are, but observers see the changes with a delay.
+    void set_observer_dispatch(dispatch mode)
+    {
+        context_->observer_dispatch = mode;
+    }
+
+    // Blocks until observers have been notified about all the changes made so far with asynchronous dispatch
+    // and value watches have received all the changes of values made so far, see node::watch_values()
+    void wait_for_observers() const
+    {
+        detail::event_dispatcher::instance().flush();
+        detail::watch_dispatcher::instance().flush();
+    }
+
+    // Starts recording the changes of the volume, the feed keeps at least the given number of the latest changes
+    // Every change then takes a single mutex of the volume, so changes are recorded in the order they were made,
+    // but writes of different nodes don't run in parallel anymore. Only enable the feed if it is consumed.
+    // Every write of a value is recorded, including one which sets the same value and every update of a batch.
+    // Fails if the feed has been enabled already.
+    bool enable_change_feed(size_t capacity = 4096)
+    {
+        return context_->changes.enable(capacity);
+    }
+
+    // Sequence number the next recorded change will get
+    [[nodiscard]] uint64_t change_feed_end() const
+    {
+        return context_->changes.end();
+    }
+
+    // Reads at most max_count changes starting from the given sequence number and moves it past the read changes
+    // Fails without moving the position if some of the changes have been overwritten already,
+    // the consumer then has to reload the volume and continue from the end of the feed taken before the reload.
+    [[nodiscard]] std::optional<std::vector<change_record>> read_changes(uint64_t& position, size_t max_count) const;
+
+    // Starts indexing the nodes of the volume by the value with the given name
+    // Existing nodes are indexed right away, later writes and deletions keep the index up to date.
+    // Writes of indexed values get serialized, so only the values which are looked up often should be indexed.
+    bool create_index(std::string_view value_name);
+
+    // Stops indexing the nodes by the value with the given name
+    bool drop_index(std::string_view value_name);
+
+    // Retrieves the nodes having the indexed value equal to the given one
+    // Fails if the value is not indexed
+    [[nodiscard]] std::optional<std::vector<std::shared_ptr<node>>> find_nodes(std::string_view value_name,
+                                                                               const value_type& value) const;
+
+    // Retrieves the nodes having the indexed value of the given type within the inclusive range
+    // Fails if the value is not indexed
+    template <typename T, typename = std::enable_if_t<detail::aggregatable<T>::value>>
+    [[nodiscard]] std::optional<std::vector<std::shared_ptr<node>>> find_nodes_in_range(std::string_view value_name,
+                                                                                        T min, T max) const
+    {
+        return find_nodes_between(value_name, min, max);
+    }
+
     [[nodiscard]] priority_t priority() const
     {
         return priority_;
     }
 
   private:
+    std::optional<std::vector<std::shared_ptr<node>>> find_nodes_between(std::string_view value_name,
+                                                                         const value_type& min,
+                                                                         const value_type& max) const;
+
     priority_t priority_;
+    std::shared_ptr<detail::volume_context> context_;
     std::shared_ptr<node> root_;
 };
 } // namespace datastore
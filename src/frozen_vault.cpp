@@ -0,0 +1,106 @@
+#include "datastore/frozen_vault.hpp"
+
+namespace datastore
+{
+std::optional<value_kind> frozen_vault::get_value_kind(std::string_view view_path, std::string_view value_name) const
+{
+    const attr* a = find_value(view_path, value_name);
+    if (!a)
+        return std::nullopt;
+
+    return a->get_value_kind();
+}
+
+bool frozen_vault::contains(std::string_view view_path) const
+{
+    return find_view(view_path) != nullptr;
+}
+
+size_t frozen_vault::size() const
+{
+    return values_.size();
+}
+
+bool frozen_vault::current() const
+{
+    for (const observed_view& observed : observed_)
+    {
+        if (observed.view->expired() || observed.view->subviews_.generation() != observed.subviews_generation)
+            return false;
+
+        if (!observed.view->fresh(*observed.merged))
+            return false;
+    }
+
+    return true;
+}
+
+std::shared_ptr<const frozen_vault> frozen_vault::build(const std::shared_ptr<node_view>& root,
+                                                       uint64_t vault_version)
+{
+    std::shared_ptr<frozen_vault> frozen(new frozen_vault());
+    frozen->vault_version_ = vault_version;
+    frozen->add_view(root, std::string());
+
+    frozen->view_index_.build(frozen->views_.size(), [&](uint32_t i, uint64_t seed) {
+        return hash_view(frozen->views_[i].path, seed);
+    });
+    frozen->value_index_.build(frozen->values_.size(), [&](uint32_t i, uint64_t seed) {
+        return hash_value(frozen->views_[frozen->value_views_[i]].path, frozen->values_[i].name(), seed);
+    });
+
+    return frozen;
+}
+
+void frozen_vault::add_view(const std::shared_ptr<node_view>& view, std::string path)
+{
+    // Taken before the subviews are collected, so a subview added in the meantime makes the image stale
+    const uint64_t subviews_generation = view->subviews_.generation();
+    std::shared_ptr<const node_view::merged_values> merged = view->merge_values();
+
+    const auto view_index = static_cast<uint32_t>(views_.size());
+    const auto first_value = static_cast<uint32_t>(values_.size());
+    for (const auto& [a, priority] : merged->values)
+    {
+        values_.push_back(a);
+        value_views_.push_back(view_index);
+    }
+    views_.push_back({path, first_value, static_cast<uint32_t>(values_.size())});
+    observed_.push_back({view, subviews_generation, std::move(merged)});
+
+    for (const std::shared_ptr<node_view>& subview : view->subviews())
+    {
+        if (!subview->expired())
+            add_view(subview, path.empty() ? std::string(subview->name()) : path + "." + std::string(subview->name()));
+    }
+}
+
+const frozen_vault::frozen_view* frozen_vault::find_view(std::string_view view_path) const
+{
+    const uint32_t i = view_index_.find(hash_view(view_path, view_index_.seed()));
+    if (i == detail::perfect_hash::npos || views_[i].path != view_path)
+        return nullptr;
+
+    return &views_[i];
+}
+
+const attr* frozen_vault::find_value(std::string_view view_path, std::string_view value_name) const
+{
+    const uint32_t i = value_index_.find(hash_value(view_path, value_name, value_index_.seed()));
+    if (i == detail::perfect_hash::npos || values_[i].name() != value_name || views_[value_views_[i]].path != view_path)
+        return nullptr;
+
+    return &values_[i];
+}
+
+uint64_t frozen_vault::hash_view(std::string_view view_path, uint64_t seed)
+{
+    return detail::hash_path_element(view_path, detail::path_hash_seed + seed * 0x9e3779b97f4a7c15ull);
+}
+
+uint64_t frozen_vault::hash_value(std::string_view view_path, std::string_view value_name, uint64_t seed)
+{
+    // Length of the path separates it from the name, so the path "a" with the name "bc" differs from "ab" and "c"
+    return detail::hash_path_element(value_name, hash_view(view_path, seed) ^ (view_path.size() + 1));
+}
+} // namespace datastore
@@ -1,8 +1,412 @@
 #include "datastore/node.hpp"
 #include "datastore/volume.hpp"
 
+#include <algorithm>
+#include <set>
+#include <thread>
+
 namespace datastore
 {
+namespace
+{
+// Full path of a node split at the point where a relative path starts
+// Allows probing the path cache without concatenating the strings
+struct joined_path
+{
+    std::string_view prefix;
+    std::string_view suffix;
+};
+
+bool operator==(std::string_view lhs, const joined_path& rhs)
+{
+    return lhs.size() == rhs.prefix.size() + 1 + rhs.suffix.size() && lhs.substr(0, rhs.prefix.size()) == rhs.prefix &&
+           lhs[rhs.prefix.size()] == path_view::path_separator && lhs.substr(rhs.prefix.size() + 1) == rhs.suffix;
+}
+} // namespace
+
+namespace detail
+{
+value_history::value_history(std::pmr::memory_resource* resource)
+    : entries_(resource)
+{
+}
+
+value_history::value_history(value_history&& other) noexcept
+    : entries_(std::move(other.entries_))
+{
+}
+
+value_history& value_history::operator=(value_history&& rhs) noexcept
+{
+    entries_ = std::move(rhs.entries_);
+    return *this;
+}
+
+void value_history::record(std::string_view value_name, const value_type& value, uint64_t written,
+                           uint64_t overwritten)
+{
+    const uint64_t oldest_snapshot = version_clock::instance().oldest_snapshot();
+
+    std::scoped_lock lock(mutex_);
+
+    // Drop the values which none of the snapshots can see anymore
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [&](const entry& e) {
+                                      return e.overwritten <= oldest_snapshot;
+                                  }),
+                   entries_.end());
+
+    if (overwritten > oldest_snapshot && written < overwritten)
+        entries_.push_back({std::pmr::string(value_name, entries_.get_allocator()), value, written, overwritten});
+}
+
+std::optional<value_type> value_history::find(std::string_view value_name, uint64_t time) const
+{
+    std::scoped_lock lock(mutex_);
+
+    for (const entry& e : entries_)
+    {
+        if (e.written <= time && time < e.overwritten && e.name == value_name)
+            return e.value;
+    }
+
+    return std::nullopt;
+}
+
+value_indexes::value_indexes(std::pmr::memory_resource* resource)
+    : indexes_(resource)
+{
+}
+
+bool value_indexes::create(std::string_view value_name)
+{
+    std::unique_lock lock(mutex_);
+
+    const auto [it, inserted] = indexes_.try_emplace(std::pmr::string(value_name, indexes_.get_allocator()));
+    if (inserted)
+    {
+        it->second.value_name = it->first;
+        num_indexes_.fetch_add(1);
+    }
+
+    return inserted;
+}
+
+bool value_indexes::drop(std::string_view value_name)
+{
+    std::unique_lock lock(mutex_);
+
+    const auto it = indexes_.find(value_name);
+    if (it == indexes_.end())
+        return false;
+
+    indexes_.erase(it);
+    num_indexes_.fetch_sub(1);
+
+    return true;
+}
+
+value_indexes::index* value_indexes::find(std::string_view value_name)
+{
+    const auto it = indexes_.find(value_name);
+    return it != indexes_.end() ? &it->second : nullptr;
+}
+
+void value_indexes::lock(std::vector<index*>& locked)
+{
+    std::sort(locked.begin(), locked.end(), std::less<index*>());
+    locked.erase(std::unique(locked.begin(), locked.end()), locked.end());
+
+    for (index* i : locked)
+        i->mutex.lock();
+}
+
+void value_indexes::unlock(const std::vector<index*>& locked)
+{
+    for (index* i : locked)
+        i->mutex.unlock();
+}
+
+event_dispatcher& event_dispatcher::instance()
+{
+    static event_dispatcher dispatcher;
+    return dispatcher;
+}
+
+event_dispatcher::event_dispatcher()
+    : thread_(&event_dispatcher::dispatcher_thread, this)
+{
+}
+
+event_dispatcher::~event_dispatcher()
+{
+    // Events posted before the exit are still dispatched
+    {
+        std::scoped_lock lock(mutex_);
+        done_ = true;
+    }
+    wake_.notify_all();
+
+    thread_.join();
+}
+
+void event_dispatcher::post(event_kind kind, std::shared_ptr<node> source, std::shared_ptr<node> subnode)
+{
+    {
+        std::scoped_lock lock(mutex_);
+        events_.push_back({kind, std::move(source), std::move(subnode)});
+    }
+    wake_.notify_all();
+}
+
+void event_dispatcher::flush()
+{
+    // An observer flushing the events would wait for itself
+    if (std::this_thread::get_id() == thread_.get_id())
+        return;
+
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [&]() {
+        return events_.empty() && !busy_;
+    });
+}
+
+void event_dispatcher::dispatcher_thread()
+{
+    std::unique_lock lock(mutex_);
+    while (true)
+    {
+        wake_.wait(lock, [&]() {
+            return done_ || !events_.empty();
+        });
+        if (events_.empty())
+            return;
+
+        // Events posted while the batch is dispatched make up the next batch
+        std::vector<event> batch;
+        batch.swap(events_);
+        busy_ = true;
+
+        lock.unlock();
+        for (const event& e : coalesce(std::move(batch)))
+            e.source->notify_observers(e.kind, e.subnode);
+        lock.lock();
+
+        busy_ = false;
+        if (events_.empty())
+            idle_.notify_all();
+    }
+}
+
+std::vector<event_dispatcher::event> event_dispatcher::coalesce(std::vector<event> batch)
+{
+    using event_key = std::pair<const node*, const node*>;
+
+    std::set<event_key> deleted;
+    for (const event& e : batch)
+    {
+        if (e.kind == event_kind::delete_subnode)
+            deleted.emplace(e.source.get(), e.subnode.get());
+    }
+
+    std::set<std::pair<event_kind, event_key>> dispatched;
+    std::vector<event> result;
+    result.reserve(batch.size());
+    for (event& e : batch)
+    {
+        const event_key key(e.source.get(), e.subnode.get());
+        if (e.kind == event_kind::create_subnode && deleted.count(key) > 0)
+            continue;
+
+        if (dispatched.emplace(e.kind, key).second)
+            result.push_back(std::move(e));
+    }
+
+    return result;
+}
+
+watch_dispatcher& watch_dispatcher::instance()
+{
+    static watch_dispatcher dispatcher;
+    return dispatcher;
+}
+
+watch_dispatcher::watch_dispatcher()
+    : thread_(&watch_dispatcher::dispatcher_thread, this)
+{
+}
+
+watch_dispatcher::~watch_dispatcher()
+{
+    // Changes posted before the exit are still delivered
+    {
+        std::scoped_lock lock(mutex_);
+        done_ = true;
+    }
+    wake_.notify_all();
+
+    thread_.join();
+}
+
+void watch_dispatcher::post(std::vector<watched_change> changes)
+{
+    {
+        std::scoped_lock lock(mutex_);
+        changes_.insert(changes_.end(), std::make_move_iterator(changes.begin()),
+                        std::make_move_iterator(changes.end()));
+    }
+    wake_.notify_all();
+}
+
+void watch_dispatcher::flush()
+{
+    // A watcher flushing the changes would wait for itself
+    if (std::this_thread::get_id() == thread_.get_id())
+        return;
+
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [&]() {
+        return changes_.empty() && !busy_;
+    });
+}
+
+void watch_dispatcher::dispatcher_thread()
+{
+    std::unique_lock lock(mutex_);
+    while (true)
+    {
+        wake_.wait(lock, [&]() {
+            return done_ || !changes_.empty();
+        });
+        if (changes_.empty())
+            return;
+
+        // Changes posted while the batch is delivered make up the next batch
+        std::vector<watched_change> batch;
+        batch.swap(changes_);
+        busy_ = true;
+
+        lock.unlock();
+        deliver(std::move(batch));
+        lock.lock();
+
+        busy_ = false;
+        if (changes_.empty())
+            idle_.notify_all();
+    }
+}
+
+void watch_dispatcher::deliver(std::vector<watched_change> batch)
+{
+    struct delivery
+    {
+        std::shared_ptr<value_watch> watch;
+        std::vector<value_change> changes;
+
+        // Position of the change of every value among the changes
+        std::map<std::pair<std::string, std::string>, size_t> positions;
+    };
+
+    // Watches receive their changes in the order they were first changed within the batch
+    std::vector<delivery> deliveries;
+    std::map<const value_watch*, size_t> watch_positions;
+    for (watched_change& c : batch)
+    {
+        std::shared_ptr<value_watch> watch = c.watch.lock();
+        if (!watch)
+            continue;
+
+        const auto [watch_pos, new_watch] = watch_positions.emplace(watch.get(), deliveries.size());
+        if (new_watch)
+            deliveries.push_back({std::move(watch), {}, {}});
+        delivery& d = deliveries[watch_pos->second];
+
+        // Repeated changes of a value keep the kind it had before the first one
+        const auto [pos, new_value] =
+            d.positions.emplace(std::make_pair(c.change.path, c.change.value_name), d.changes.size());
+        if (new_value)
+            d.changes.push_back(std::move(c.change));
+        else
+            d.changes[pos->second].new_kind = c.change.new_kind;
+    }
+
+    for (delivery& d : deliveries)
+    {
+        // Values created and deleted within the batch have never been seen by the watch
+        d.changes.erase(std::remove_if(d.changes.begin(), d.changes.end(),
+                                       [](const value_change& change) {
+                                           return !change.old_kind && !change.new_kind;
+                                       }),
+                        d.changes.end());
+
+        if (!d.changes.empty())
+            d.watch->watcher_(d.changes);
+    }
+}
+
+value_watches::value_watches(std::pmr::memory_resource* resource)
+    : watches_(resource)
+{
+}
+
+void value_watches::add(const node* n, std::weak_ptr<node> ref, const std::shared_ptr<value_watch>& watch)
+{
+    std::unique_lock lock(mutex_);
+    watches_.emplace(n, registration{std::move(ref), watch.get(), watch});
+    ++num_watches_;
+}
+
+void value_watches::remove(const node* n, const value_watch* watch)
+{
+    std::unique_lock lock(mutex_);
+
+    const auto [first, last] = watches_.equal_range(n);
+    for (auto it = first; it != last; ++it)
+    {
+        if (it->second.id == watch)
+        {
+            watches_.erase(it);
+            --num_watches_;
+            return;
+        }
+    }
+}
+
+std::vector<std::shared_ptr<value_watch>> value_watches::find(const node* n) const
+{
+    std::vector<std::shared_ptr<value_watch>> result;
+
+    std::shared_lock lock(mutex_);
+    const auto [first, last] = watches_.equal_range(n);
+    for (auto it = first; it != last; ++it)
+    {
+        // Registrations of a released node must not be taken over by a new node at the same address
+        if (it->second.ref.lock().get() != n)
+            continue;
+
+        if (std::shared_ptr<value_watch> watch = it->second.watch.lock())
+            result.push_back(std::move(watch));
+    }
+
+    return result;
+}
+} // namespace detail
+
+value_watch::value_watch(value_watcher watcher, watch_scope scope)
+    : watcher_(std::move(watcher)),
+      scope_(scope)
+{
+}
+
+value_watch::~value_watch()
+{
+    for (const registration& r : registrations_)
+    {
+        if (const std::shared_ptr<detail::volume_context> context = r.context.lock())
+            context->watches.remove(r.n, this);
+    }
+}
+
 std::ostream& operator<<(std::ostream& lhs, const value_type& rhs)
 {
     const auto kind = static_cast<value_kind>(rhs.index());
@@ -22,10 +426,14 @@ std::ostream& operator<<(std::ostream& lhs, const value_type& rhs)
     return lhs;
 }
 
-node::node(path_view full_path, uint8_t volume_priority)
-    : full_path_str_(full_path.str()),
+node::node(path_view full_path, uint8_t volume_priority, std::shared_ptr<detail::volume_context> context)
+    : full_path_str_(std::string_view(full_path), context->resource),
       full_path_view_(full_path_str_),
-      volume_priority(volume_priority)
+      full_path_hash_(detail::hash_path_element(full_path_str_)),
+      volume_priority(volume_priority),
+      context_(std::move(context)),
+      subnodes_(13, context_->resource),
+      values_(13, context_->resource)
 {
     // Play dead if the path is invalid
     if (!full_path_view_.valid())
@@ -35,11 +443,15 @@ node::node(path_view full_path, uint8_t volume_priority)
 node::node(node&& other) noexcept
     : full_path_str_(std::move(other.full_path_str_)),
       full_path_view_(full_path_str_),
+      full_path_hash_(other.full_path_hash_),
       volume_priority(other.volume_priority),
+      context_(std::move(other.context_)),
       subnodes_(std::move(other.subnodes_)),
       values_(std::move(other.values_)),
-      observers_(std::move(other.observers_)),
-      deleted_(other.deleted_.load())
+      extras_(other.extras_.exchange(nullptr)),
+      deleted_(other.deleted_.load()),
+      parent_(std::move(other.parent_)),
+      version_(other.version_.load())
 {
 }
 
@@ -47,36 +459,92 @@ node& node::operator=(node&& rhs) noexcept
 {
     full_path_str_ = std::move(rhs.full_path_str_);
     full_path_view_ = path_view(full_path_str_);
+    full_path_hash_ = rhs.full_path_hash_;
     volume_priority = rhs.volume_priority;
+    context_ = std::move(rhs.context_);
     subnodes_ = std::move(rhs.subnodes_);
     values_ = std::move(rhs.values_);
-    observers_ = std::move(rhs.observers_);
+    release_extras();
+    extras_ = rhs.extras_.exchange(nullptr);
     deleted_ = rhs.deleted_.load();
+    parent_ = std::move(rhs.parent_);
+    version_ = rhs.version_.load();
 
     return *this;
 }
 
+node::~node()
+{
+    release_extras();
+}
+
+detail::node_extras& node::extras() const
+{
+    if (detail::node_extras* e = find_extras())
+        return *e;
+
+    std::pmr::polymorphic_allocator<detail::node_extras> alloc(context_->resource);
+    detail::node_extras* created = alloc.allocate(1);
+    new (created) detail::node_extras(context_->resource);
+
+    // Another thread might have allocated them meanwhile, its copy wins
+    detail::node_extras* expected = nullptr;
+    if (extras_.compare_exchange_strong(expected, created, std::memory_order_acq_rel))
+        return *created;
+
+    created->~node_extras();
+    alloc.deallocate(created, 1);
+    return *expected;
+}
+
+void node::release_extras()
+{
+    detail::node_extras* e = extras_.exchange(nullptr);
+    if (!e)
+        return;
+
+    std::pmr::polymorphic_allocator<detail::node_extras> alloc(context_->resource);
+    e->~node_extras();
+    alloc.deallocate(e, 1);
+}
+
 std::shared_ptr<node> node::create_subnode(path_view subnode_path)
 {
     if (!subnode_path.valid())
         return nullptr;
 
-    if (deleted_)
+    if (deleted())
         return nullptr;
 
     if (full_path_view_.size() >= volume::max_tree_depth)
         return nullptr;
 
     // Take the first element of the given path
-    const std::string subnode_name = std::string(*subnode_path.front());
+    const std::string_view subnode_name = *subnode_path.front();
 
     // Try to find an existing subnode or create a new one if the limit of subnodes is not reached
-    const auto& subnode_success_pair = subnodes_.find_or_insert_with_limit(
-        subnode_name, new node(full_path_view_ + subnode_name, volume_priority), max_num_subnodes);
-    const auto& [subnode, success] = subnode_success_pair;
+    // Subnode is made only if it doesn't exist yet, so opening an existing one doesn't allocate
+    bool created = false;
+    std::unique_lock lock = lock_changes();
+    const auto [subnode, success] = subnodes_.find_or_emplace_with_limit(
+        subnode_name,
+        [&]() {
+            created = true;
+            std::shared_ptr<node> n =
+                make(context_->resource, full_path_view_ + std::string(subnode_name), volume_priority, context_);
+
+            // Parent is set before the subnode becomes reachable, so it's never written concurrently with readers
+            n->parent_ = weak_from_this();
+            return n;
+        },
+        max_num_subnodes);
     if (!success)
         return nullptr;
 
+    if (created)
+        record_change(change_kind::create_subnode, subnode->path());
+    lock = {};
+
     // Recursively create subnodes if a composite path was specified
     if (subnode_path.composite())
     {
@@ -84,19 +552,9 @@ std::shared_ptr<node> node::create_subnode(path_view subnode_path)
         return subnode->create_subnode(std::move(subnode_path));
     }
 
-    // Cleanup expired observers
-    observers_.remove_if([](const std::weak_ptr<detail::node_observer>& observer) {
-        return observer.expired();
-    });
-
-    // Notify existing observers about subnode creation
-    // TODO: don't notify if it was just an opening of an existing subnode
-    observers_.for_each([&](const std::weak_ptr<detail::node_observer>& observer) {
-        if (const std::shared_ptr<detail::node_observer>& valid_observer = observer.lock())
-        {
-            valid_observer->on_create_subnode(subnode_success_pair.first);
-        }
-    });
+    // Notify existing observers about subnode creation, opening an existing subnode doesn't change anything for them
+    if (created)
+        publish_event(detail::event_kind::create_subnode, subnode);
 
     return subnode;
 }
@@ -106,115 +564,603 @@ std::shared_ptr<node> node::open_subnode(path_view subnode_path) const
     if (!subnode_path.valid())
         return nullptr;
 
-    if (deleted_)
+    if (deleted())
+        return nullptr;
+
+    // Single level lookups are as cheap as a cache probe
+    if (!subnode_path.composite() || !context_)
+        return open_subnode_uncached(std::move(subnode_path));
+
+    // Full path of the subnode is this node path followed by the relative path
+    // Its hash is computed by continuing the hash of this node path
+    const std::string_view relative_path = subnode_path;
+    const joined_path full_path{full_path_view_, relative_path};
+    const size_t full_path_hash = static_cast<size_t>(detail::hash_path_element(
+        relative_path, detail::hash_path_element(std::string_view(&path_view::path_separator, 1), full_path_hash_)));
+
+    if (const auto& cached = context_->path_cache.find(full_path, full_path_hash))
+    {
+        if (std::shared_ptr<node> subnode = cached->lock(); subnode && !subnode->deleted())
+            return subnode;
+    }
+
+    std::shared_ptr<node> subnode = open_subnode_uncached(std::move(subnode_path));
+    if (!subnode)
         return nullptr;
 
-    // Take the first element of the given path and try to find a subnode with this name
-    const std::string subnode_name = std::string(*subnode_path.front());
+    // Checked under the bucket lock the deletion erases the entry under, so a deleted subnode never stays cached
+    const auto alive = [&]() {
+        return !subnode->deleted();
+    };
+    if (!context_->path_cache.assign_or_insert_if(subnode->full_path_str_, std::weak_ptr<node>(subnode),
+                                                  volume::max_cached_paths, alive))
+    {
+        // Once the cache is full a single entry makes room for the new one
+        if (context_->path_cache.evict_one())
+            context_->path_cache.assign_or_insert_if(subnode->full_path_str_, std::weak_ptr<node>(subnode),
+                                                     volume::max_cached_paths, alive);
+    }
+
+    return subnode;
+}
+
+std::shared_ptr<node> node::open_subnode_uncached(path_view subnode_path) const
+{
+    // Intermediate nodes are only borrowed, so only the reference counter of the resulting subnode is touched
+    detail::epoch_guard guard;
 
-    const auto& opt = subnodes_.find(subnode_name);
+    const node* parent = find_parent_pinned(subnode_path);
+    if (!parent)
+        return nullptr;
+
+    // Element hash is already known to the path, so the lookup doesn't need to build a string and rehash it
+    const auto& opt = parent->subnodes_.find(*subnode_path.front(), subnode_path.front_hash());
     if (!opt)
         return nullptr;
 
-    const std::shared_ptr<node>& subnode = *opt;
+    return *opt;
+}
+
+borrowed_ptr<node> node::borrow_subnode(path_view subnode_path) const
+{
+    if (!subnode_path.valid())
+        return {};
 
-    // Open subnodes recursively if the path has multiple elements
-    if (subnode_path.composite())
+    detail::epoch_guard guard;
+
+    const node* parent = find_parent_pinned(subnode_path);
+    if (!parent)
+        return {};
+
+    node* subnode = nullptr;
+    parent->subnodes_.visit(*subnode_path.front(), subnode_path.front_hash(),
+                            [&](const std::shared_ptr<node>& found) {
+                                subnode = found.get();
+                            });
+    if (!subnode)
+        return {};
+
+    return borrowed_ptr<node>(std::move(guard), subnode);
+}
+
+const node* node::find_parent_pinned(path_view& subnode_path) const
+{
+    const node* current = this;
+    while (true)
     {
+        if (current->deleted())
+            return nullptr;
+
+        if (!subnode_path.composite())
+            return current;
+
+        // Deleted subnodes are retired rather than released, so the pointer stays valid while the epoch is pinned
+        const node* next = nullptr;
+        current->subnodes_.visit(*subnode_path.front(), subnode_path.front_hash(),
+                                 [&](const std::shared_ptr<node>& subnode) {
+                                     next = subnode.get();
+                                 });
+        if (!next)
+            return nullptr;
+
+        current = next;
         subnode_path.pop_front();
-        return subnode->open_subnode(std::move(subnode_path));
     }
+}
 
-    return subnode;
+bool node::ancestor_deleted() const
+{
+    // Loaded before the walk, so a subtree detached during the walk makes the result stale
+    const uint64_t generation = context_->detach_generation.load();
+    if (alive_generation_.load(std::memory_order_relaxed) == generation)
+        return false;
+
+    for (std::shared_ptr<node> ancestor = parent_.lock(); ancestor; ancestor = ancestor->parent_.lock())
+    {
+        if (ancestor->deleted_)
+            return true;
+
+        // The rest of the ancestors has already been walked since the last subtree was detached
+        if (ancestor->alive_generation_.load(std::memory_order_relaxed) == generation)
+            break;
+    }
+
+    alive_generation_.store(generation, std::memory_order_relaxed);
+    return false;
 }
 
-void node::notify_on_delete_subnode_observers(const std::shared_ptr<node>& subnode)
+void node::publish_event(detail::event_kind kind, const std::shared_ptr<node>& subnode)
 {
-    // Go bottom up the tree
-    subnode->for_each_subnode([&](const std::shared_ptr<node>& node) {
-        subnode->notify_on_delete_subnode_observers(node);
-    });
+    if (context_ && context_->observer_dispatch == dispatch::asynchronous)
+        detail::event_dispatcher::instance().post(kind, shared_from_this(), subnode);
+    else
+        notify_observers(kind, subnode);
+}
+
+void node::notify_observers(detail::event_kind kind, const std::shared_ptr<node>& subnode)
+{
+    // Nodes which have never been observed have nobody to notify
+    detail::node_extras* e = find_extras();
+    if (!e)
+        return;
 
-    // Cleanup observers list
-    observers_.remove_if([](const std::weak_ptr<detail::node_observer>& observer) {
+    // Cleanup expired observers
+    e->observers.remove_if([](const std::weak_ptr<detail::node_observer>& observer) {
         return observer.expired();
     });
 
-    // Let existing observers know about the subnode deletion
-    observers_.for_each([&](const std::weak_ptr<detail::node_observer>& observer) {
+    e->observers.for_each([&](const std::weak_ptr<detail::node_observer>& observer) {
         if (const std::shared_ptr<detail::node_observer>& valid_observer = observer.lock())
         {
-            valid_observer->on_delete_subnode(subnode);
+            if (kind == detail::event_kind::create_subnode)
+                valid_observer->on_create_subnode(subnode);
+            else
+                valid_observer->on_delete_subnode(subnode);
         }
     });
+}
+
+void node::defer_teardown(std::shared_ptr<node> subnode)
+{
+    // Counted before the subnode is marked, so its subnodes see the deleted ancestor as soon as it's marked
+    ++context_->num_detached_subtrees;
+    subnode->deleted_ = true;
+    ++context_->detach_generation;
+    subnode->bump_version();
+
+    // Deferred tasks post observer events, so the dispatcher must outlive the reclaimer
+    detail::event_dispatcher::instance();
+    detail::reclaimer::instance().defer([parent = shared_from_this(), subnode = std::move(subnode)]() {
+        parent->notify_on_delete_subnode_observers(subnode);
+        --parent->context_->num_detached_subtrees;
+
+        // Concurrent readers might still be walking through the subnode without owning it
+        detail::epoch_domain::instance().retire(subnode);
+    });
+}
+
+void node::link_subnodes()
+{
+    subnodes_.for_each_snapshot([&](const std::shared_ptr<node>& subnode) {
+        subnode->parent_ = weak_from_this();
+        subnode->link_subnodes();
+    });
+}
+
+void node::notify_on_delete_subnode_observers(const std::shared_ptr<node>& subnode)
+{
+    // Go bottom up the tree, subnodes of a deferred teardown are already marked as deleted
+    subnode->subnodes_.for_each_snapshot([&](const std::shared_ptr<node>& node) {
+        subnode->notify_on_delete_subnode_observers(node);
+    });
+
+    // Let existing observers know about the subnode deletion
+    publish_event(detail::event_kind::delete_subnode, subnode);
 
     // Finally mark the subnode as deleted
     subnode->deleted_ = true;
+    subnode->bump_version();
+    subnode->unindex_values();
+
+    // Make sure the subnode can't be found using the path cache anymore
+    if (context_)
+        context_->path_cache.erase(subnode->full_path_str_);
 
     // TODO: subnodes don't erase children recursively
 }
 
-bool node::delete_subnode_tree(path_view subnode_name)
+bool node::delete_subnode_tree(path_view subnode_name, teardown mode)
 {
     if (!subnode_name.valid() || subnode_name.composite())
         return false;
 
-    if (deleted_)
+    if (deleted())
         return false;
 
-    const std::optional<std::shared_ptr<node>> opt = subnodes_.find(subnode_name.str());
+    if (mode == teardown::deferred)
+    {
+        std::unique_lock lock = lock_changes();
+        std::optional<std::shared_ptr<node>> extracted = subnodes_.extract(*subnode_name.front());
+        if (!extracted)
+            return false;
+        reset_sorted_subnodes();
+        record_change(change_kind::delete_subnode, (*extracted)->path());
+        lock = {};
+
+        defer_teardown(std::move(*extracted));
+        return true;
+    }
+
+    const std::optional<std::shared_ptr<node>> opt = subnodes_.find(*subnode_name.front(), subnode_name.front_hash());
     if (!opt)
         return false;
     const std::shared_ptr<node>& subnode = opt.value();
 
     notify_on_delete_subnode_observers(subnode);
 
-    const bool success = subnodes_.erase(subnode_name.str()) > 0;
-    if (!success)
+    const std::unique_lock lock = lock_changes();
+    std::optional<std::shared_ptr<node>> extracted = subnodes_.extract(*subnode_name.front());
+    if (!extracted)
         return false;
+    reset_sorted_subnodes();
+    record_change(change_kind::delete_subnode, (*extracted)->path());
 
-    return success;
+    // Concurrent readers might still be walking through the subnode without owning it
+    detail::epoch_domain::instance().retire(std::move(*extracted));
+
+    return true;
 }
 
-bool node::delete_subnode_tree()
+bool node::delete_subnode_tree(teardown mode)
 {
-    if (deleted_)
+    if (deleted())
         return false;
 
-    // notify_on_delete_subnode_observers() doesn't take subnodes_ locks internally
-    // So it's safe to call it already holding a lock in for_each()
-    subnodes_.for_each([&](const std::shared_ptr<node>& subnode) {
+    if (mode == teardown::deferred)
+    {
+        std::unique_lock lock = lock_changes();
+        std::vector<std::shared_ptr<node>> extracted = subnodes_.extract_all();
+        reset_sorted_subnodes();
+        for (const std::shared_ptr<node>& subnode : extracted)
+            record_change(change_kind::delete_subnode, subnode->path());
+        lock = {};
+
+        for (std::shared_ptr<node>& subnode : extracted)
+            defer_teardown(std::move(subnode));
+
+        return true;
+    }
+
+    // Observers take the locks of their own subviews, so the subnodes are notified without holding any bucket locks
+    subnodes_.for_each_snapshot([&](const std::shared_ptr<node>& subnode) {
         // Entire observers hierarchy needs to be notified about the subnode tree deletion first
         notify_on_delete_subnode_observers(subnode);
     });
 
-    subnodes_.clear();
+    // Concurrent readers might still be walking through the subnodes without owning them
+    const std::unique_lock lock = lock_changes();
+    for (std::shared_ptr<node>& subnode : subnodes_.extract_all())
+    {
+        record_change(change_kind::delete_subnode, subnode->path());
+        detail::epoch_domain::instance().retire(std::move(subnode));
+    }
+    reset_sorted_subnodes();
 
     return true;
 }
 
 size_t node::delete_value(const std::string& value_name)
 {
-    if (deleted_)
+    if (deleted())
         return 0;
 
-    return values_.erase(value_name);
+    const plain_write_guard guard(*this);
+    const detail::write_scope scope;
+    const auto written_names = [&](auto f) {
+        f(std::string_view(value_name));
+    };
+    const size_t num_deleted = write_watched(scope.stamp(), written_names, [&](auto on_write) {
+        return values_.erase(std::string_view(value_name), on_write);
+    });
+    if (num_deleted > 0)
+        bump_version();
+
+    return num_deleted;
 }
 
 void node::delete_values()
 {
-    if (deleted_)
+    if (deleted())
+        return;
+
+    const plain_write_guard guard(*this);
+    const detail::write_scope scope;
+    write_watched(scope.stamp(), any_value_name(), [&](auto on_write) {
+        values_.clear(on_write);
+        return true;
+    });
+    bump_version();
+}
+
+std::vector<std::shared_ptr<node>> node::query(const path_pattern& pattern) const
+{
+    std::vector<std::shared_ptr<node>> subnodes;
+    query(pattern, [&](const std::shared_ptr<node>& subnode) {
+        subnodes.push_back(subnode);
+    });
+
+    return subnodes;
+}
+
+std::vector<std::shared_ptr<node>> node::query_candidates(const path_pattern& pattern,
+                                                          path_pattern::state_set states) const
+{
+    std::vector<std::shared_ptr<node>> candidates;
+    if (deleted())
+        return candidates;
+
+    // Look up the named subnodes directly when the pattern doesn't allow any other names
+    if (pattern.names_only(states))
+    {
+        pattern.for_each_name(states, [&](std::string_view name, uint64_t hash) {
+            if (std::optional<std::shared_ptr<node>> subnode = subnodes_.find(name, hash))
+                candidates.push_back(std::move(*subnode));
+        });
+        return candidates;
+    }
+
+    subnodes_.for_each([&](const std::shared_ptr<node>& subnode) {
+        candidates.push_back(subnode);
+    });
+    return candidates;
+}
+
+std::vector<std::shared_ptr<node>> node::subnodes() const
+{
+    if (deleted())
+        return {};
+
+    return subnodes_.values();
+}
+
+std::vector<std::shared_ptr<node>> node::list_subnodes(std::string_view after, size_t max_count) const
+{
+    std::vector<std::shared_ptr<node>> page;
+    if (deleted() || max_count == 0)
+        return page;
+
+    extras().sorted_subnodes.for_each_from(subnodes_, after, false, [&](const std::shared_ptr<node>& subnode) {
+        if (!subnode->deleted())
+            page.push_back(subnode);
+        return page.size() < max_count;
+    });
+
+    return page;
+}
+
+bool node::set_values(std::initializer_list<std::pair<std::string_view, value_type>> values)
+{
+    value_batch batch;
+    for (const auto& [value_name, value] : values)
+        batch.set_value(value_name, value);
+
+    return apply_batch(batch);
+}
+
+bool node::apply_batch(const value_batch& batch)
+{
+    if (deleted())
+        return false;
+
+    for (const auto& [value_name, value] : batch.updates_)
+    {
+        if (value && !valid_value(value_name, *value))
+            return false;
+    }
+
+    const plain_write_guard guard(*this);
+    const bool success = write_batch(batch) == 0;
+    bump_version();
+
+    return success;
+}
+
+size_t node::write_batch(const value_batch& batch)
+{
+    // All updates of the batch become visible to snapshots at once
+    const detail::write_scope scope;
+
+    // Construct the values before taking any locks
+    std::vector<std::pair<std::string_view, std::optional<attr>>> updates;
+    updates.reserve(batch.size());
+    for (const auto& [value_name, value] : batch.updates_)
+    {
+        if (value)
+        {
+            attr& a = updates.emplace_back(value_name, attr(value_name, *value, context_->resource)).second.value();
+            a.stamp_ = scope.stamp();
+        }
+        else
+        {
+            updates.emplace_back(value_name, std::nullopt);
+        }
+    }
+
+    const auto written_names = [&](auto f) {
+        for (const auto& [value_name, value] : updates)
+            f(value_name);
+    };
+    return write_watched(scope.stamp(), written_names, [&](auto on_write) {
+        return values_.apply_batch(std::move(updates), max_num_values, on_write);
+    });
+}
+
+void node::index_subtree(std::string_view value_name)
+{
+    if (deleted())
+        return;
+
+    {
+        detail::value_indexes& indexes = context_->indexes;
+        std::shared_lock lock(indexes.mutex());
+        detail::value_indexes::index* i = indexes.find(value_name);
+        if (!i)
+            return;
+
+        // Checked under the lock, so a concurrent deletion can't leave the values in the index
+        std::unique_lock index_lock(i->mutex);
+        if (!deleted())
+        {
+            if (const std::optional<attr> a = values_.find(value_name))
+                i->insert(a->value_, this, weak_from_this());
+        }
+    }
+
+    // Subnodes are collected first, the locks are never held together with the subnodes locks
+    std::vector<std::shared_ptr<node>> subnodes;
+    subnodes_.for_each([&](const std::shared_ptr<node>& subnode) {
+        subnodes.push_back(subnode);
+    });
+
+    for (const std::shared_ptr<node>& subnode : subnodes)
+        subnode->index_subtree(value_name);
+}
+
+void node::unindex_values()
+{
+    if (!context_ || !context_->indexes.active())
+        return;
+
+    detail::value_indexes& indexes = context_->indexes;
+    std::shared_lock lock(indexes.mutex());
+
+    std::vector<detail::value_indexes::index*> locked;
+    indexes.for_each_index([&](detail::value_indexes::index& i) {
+        locked.push_back(&i);
+    });
+    detail::value_indexes::lock(locked);
+
+    values_.for_each([&](const attr& a) {
+        if (detail::value_indexes::index* i = indexes.find(a.name()))
+            i->erase(a.value_, this);
+    });
+
+    detail::value_indexes::unlock(locked);
+}
+
+std::shared_ptr<value_watch> node::watch_values(value_watcher watcher, watch_scope scope)
+{
+    if (deleted() || !watcher)
+        return nullptr;
+
+    std::shared_ptr<value_watch> watch(new value_watch(std::move(watcher), scope));
+    add_watch(watch);
+
+    return watch;
+}
+
+void node::add_watch(const std::shared_ptr<value_watch>& watch)
+{
+    watch->registrations_.push_back({context_, this});
+    context_->watches.add(this, weak_from_this(), watch);
+}
+
+std::vector<node::watch_target> node::find_watch_targets() const
+{
+    std::vector<watch_target> targets;
+    if (!context_->watches.active())
+        return targets;
+
+    // Watches of the ancestors receive the changes only if they watch the whole subtree
+    std::shared_ptr<node> ancestor;
+    size_t depth = 0;
+    for (const node* n = this; n != nullptr; ++depth)
+    {
+        for (const std::shared_ptr<value_watch>& watch : context_->watches.find(n))
+        {
+            if (depth > 0 && watch->scope() != watch_scope::subtree)
+                continue;
+
+            path_view relative_path = full_path_view_;
+            while (relative_path.size() > depth)
+                relative_path.pop_front();
+
+            targets.push_back({watch, relative_path.str()});
+        }
+
+        ancestor = n->parent_.lock();
+        n = ancestor.get();
+    }
+
+    return targets;
+}
+
+void node::report_value_change(const std::vector<watch_target>& targets, std::string_view value_name,
+                               const attr* old_value, const attr* new_value) const
+{
+    // The feed records every write, even one which sets the same value again
+    if (new_value)
+        record_change(change_kind::set_value, full_path_view_, value_name, new_value->value_);
+    else
+        record_change(change_kind::delete_value, full_path_view_, value_name);
+
+    // Watches are told only about writes which change the value
+    if (targets.empty() || (old_value && new_value && old_value->value_ == new_value->value_))
+        return;
+
+    std::optional<value_kind> old_kind;
+    if (old_value)
+        old_kind = old_value->get_value_kind();
+    std::optional<value_kind> new_kind;
+    if (new_value)
+        new_kind = new_value->get_value_kind();
+
+    std::vector<detail::watch_dispatcher::watched_change> watched;
+    watched.reserve(targets.size());
+    for (const watch_target& target : targets)
+        watched.push_back({target.watch, {target.path, std::string(value_name), old_kind, new_kind}});
+
+    // Posted under the bucket lock, so the watches receive the changes of a value in the order they were made
+    detail::watch_dispatcher::instance().post(std::move(watched));
+}
+
+std::unique_lock<std::mutex> node::lock_changes() const
+{
+    if (!context_ || !context_->changes.enabled())
+        return {};
+
+    return std::unique_lock(context_->changes_mutex);
+}
+
+void node::record_change(change_kind kind, path_view path, std::string_view value_name,
+                         std::optional<value_type> value) const
+{
+    if (!context_ || !context_->changes.enabled())
         return;
 
-    values_.clear();
+    // Sequence number is assigned by the feed
+    context_->changes.append({0, kind, path.str(), std::string(value_name), std::move(value)});
+}
+
+std::optional<value_type> node::value_at(std::string_view value_name, uint64_t time) const
+{
+    // Writers keep the overwritten value before replacing it,
+    // so if the current value is too new the one visible at the given time is already in the history
+    if (const std::optional<attr> a = values_.find(value_name); a && a->stamp_ <= time)
+        return a->value_;
+
+    // History is allocated before the overwriting value is written, so it's found once the new value is seen
+    const detail::node_extras* e = find_extras();
+    return e ? e->history.find(value_name, time) : std::nullopt;
 }
 
 std::optional<value_kind> node::get_value_kind(const std::string& value_name) const
 {
-    if (deleted_)
+    if (deleted())
         return std::nullopt;
 
-    const auto& opt_value = values_.find(value_name);
+    wait_unlocked();
+    const auto& opt_value = values_.find(std::string_view(value_name));
 
     if (!opt_value)
         return std::nullopt;
@@ -237,17 +1183,121 @@ uint8_t node::priority() const
     return volume_priority;
 }
 
-bool node::deleted() const
+bool node::valid_value(std::string_view value_name, const value_type& value)
+{
+    if (value_name.size() > max_value_name_size_bytes)
+        return false;
+
+    const value_kind kind = static_cast<value_kind>(value.index());
+    if (kind == value_kind::str && std::get<std::string>(value).size() > max_str_value_size_bytes)
+        return false;
+    if (kind == value_kind::bin && std::get<binary_blob_t>(value).size() > max_bin_value_size_bytes)
+        return false;
+
+    return true;
+}
+
+void node::bump_version()
+{
+    // Keeps the parity, so a node held by a committing transaction stays held
+    version_.fetch_add(2);
+    bump_view_versions();
+}
+
+void node::bump_view_versions()
+{
+    // Nodes of volumes which aren't loaded into any vault don't take the lock
+    detail::node_extras* e = find_extras();
+    if (!e || e->num_view_versions.load() == 0)
+        return;
+
+    std::shared_lock lock(e->view_versions_mutex);
+    for (const std::shared_ptr<std::atomic<uint64_t>>& version : e->view_versions)
+        version->fetch_add(1);
+}
+
+void node::add_view_version(std::shared_ptr<std::atomic<uint64_t>> version)
+{
+    detail::node_extras& e = extras();
+    std::unique_lock lock(e.view_versions_mutex);
+
+    // Versions only the node holds belong to node views which are gone
+    e.view_versions.erase(std::remove_if(e.view_versions.begin(), e.view_versions.end(),
+                                         [](const std::shared_ptr<std::atomic<uint64_t>>& registered) {
+                                             return registered.use_count() == 1;
+                                         }),
+                          e.view_versions.end());
+    e.view_versions.push_back(std::move(version));
+    e.num_view_versions = e.view_versions.size();
+}
+
+void node::remove_view_version(const std::atomic<uint64_t>* version)
+{
+    detail::node_extras* e = find_extras();
+    if (!e)
+        return;
+
+    std::unique_lock lock(e->view_versions_mutex);
+
+    // Version of a vault is registered once by every node view of the vault observing the node
+    const auto it = std::find_if(e->view_versions.begin(), e->view_versions.end(),
+                                 [&](const std::shared_ptr<std::atomic<uint64_t>>& registered) {
+                                     return registered.get() == version;
+                                 });
+    if (it != e->view_versions.end())
+        e->view_versions.erase(it);
+    e->num_view_versions = e->view_versions.size();
+}
+
+uint64_t node::wait_unlocked() const
+{
+    uint64_t version = version_.load();
+    while (version % 2 != 0)
+    {
+        std::this_thread::yield();
+        version = version_.load();
+    }
+    return version;
+}
+
+node::plain_write_guard::plain_write_guard(node& n)
+    : n_(n)
+{
+    while (true)
+    {
+        n_.wait_unlocked();
+        n_.num_plain_writes_.fetch_add(1);
+
+        // A transaction taking the node checks for plain writes only after taking it, so one of the two backs off
+        if (n_.version_.load() % 2 == 0)
+            return;
+
+        n_.num_plain_writes_.fetch_sub(1);
+    }
+}
+
+node::plain_write_guard::~plain_write_guard()
 {
-    return deleted_;
+    n_.num_plain_writes_.fetch_sub(1);
 }
 
 void node::register_observer(const std::shared_ptr<detail::node_observer>& observer)
 {
-    if (deleted_)
+    if (deleted())
         return;
 
-    observers_.push(observer);
+    detail::node_extras& e = extras();
+    e.observers.push(observer);
+
+    // Node views of unloaded subtrees are otherwise dropped only by the next notification,
+    // pruning them once the list doubles keeps a node loaded into many short-lived vaults from growing unbounded
+    if (e.observers.size() < e.next_observer_prune.load())
+        return;
+
+    e.observers.remove_if([](const std::weak_ptr<detail::node_observer>& registered) {
+        return registered.expired();
+    });
+    e.next_observer_prune = std::max(detail::node_extras::min_observers_to_prune, 2 * e.observers.size());
 }
 
 std::ostream& operator<<(std::ostream& lhs, const node& rhs)
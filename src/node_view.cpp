@@ -1,7 +1,8 @@
 #include "datastore/node_view.hpp"
-
 #include "datastore/vault.hpp"
 
+#include <algorithm>
+
 namespace datastore
 {
 namespace detail
@@ -16,10 +17,11 @@ bool compare_nodes(const std::shared_ptr<node>& n1, const std::shared_ptr<node>&
 
 } // namespace detail
 
-node_view::node_view(path_view full_path)
+node_view::node_view(path_view full_path, std::shared_ptr<detail::view_index> index)
     : full_path_str_(full_path.str()),
       full_path_view_(full_path_str_),
-      nodes_(&detail::compare_nodes)
+      nodes_(&detail::compare_nodes),
+      index_(std::move(index))
 {
     // Play dead if somehow the path was invalid
     if (!full_path_view_.valid())
@@ -30,13 +32,17 @@ node_view::node_view(node_view&& other) noexcept
     : full_path_str_(std::move(other.full_path_str_)),
       full_path_view_(full_path_str_),
       subviews_(std::move(other.subviews_)),
+      sorted_subviews_(std::move(other.sorted_subviews_)),
       nodes_(std::move(other.nodes_)),
-      expired_(other.expired_.load())
+      nodes_generation_(other.nodes_generation_.load() + 1),
+      version_(std::move(other.version_)),
+      expired_(other.expired_.load()),
+      index_(std::move(other.index_))
 {
     // Iterate over newly acquired nodes and update their observers lists
     // TODO: operating on subviews doesn't make much sense and needs to be reverted back
     // Likely I'd be better off inhereting from std::enable_shared_from_this
-    subviews_.for_each([&](const std::shared_ptr<node_view>& subview) {
+    subviews_.for_each_snapshot([&](const std::shared_ptr<node_view>& subview) {
         subview->nodes_.for_each([&](const std::shared_ptr<node>& node) {
             node->register_observer(std::static_pointer_cast<node_observer>(subview));
         });
@@ -48,13 +54,16 @@ node_view& node_view::operator=(node_view&& rhs) noexcept
     full_path_str_ = std::move(rhs.full_path_str_);
     full_path_view_ = path_view(full_path_str_);
     subviews_ = std::move(rhs.subviews_);
+    sorted_subviews_ = std::move(rhs.sorted_subviews_);
     nodes_ = std::move(rhs.nodes_);
+    drop_cached_values();
     expired_ = rhs.expired_.load();
+    index_ = std::move(rhs.index_);
 
     // Iterate over newly acquired nodes and update their observers lists
     // TODO: operating on subviews doesn't make much sense and needs to be reverted back
     // Likely I'd be better off inhereting from std::enable_shared_from_this
-    subviews_.for_each([&](const std::shared_ptr<node_view>& subview) {
+    subviews_.for_each_snapshot([&](const std::shared_ptr<node_view>& subview) {
         subview->nodes_.for_each([&](const std::shared_ptr<node>& node) {
             node->register_observer(std::static_pointer_cast<node_observer>(subview));
         });
@@ -79,7 +88,7 @@ std::shared_ptr<node_view> node_view::create_subnode(path_view subnode_path)
     const std::string subnode_name = std::string(*subnode_path.front());
 
     // root subview never has a node loaded
-    if (std::optional<std::shared_ptr<node_view>> opt = subviews_.find(subnode_name))
+    if (std::optional<std::shared_ptr<node_view>> opt = subviews_.find(subnode_name, subnode_path.front_hash()))
     {
         if (!subnode_path.composite())
             return opt.value();
@@ -93,22 +102,26 @@ std::shared_ptr<node_view> node_view::create_subnode(path_view subnode_path)
     if (!main_node)
         return nullptr;
 
-    const std::shared_ptr<node>& subnode = (*main_node)->create_subnode(std::move(subnode_path));
+    // Subnodes are created one level at a time, so every subview observes the node of its own level
+    const std::shared_ptr<node>& subnode = (*main_node)->create_subnode(subnode_name);
     if (!subnode)
         return nullptr;
 
-    // TODO: subnode is actually the deepest subnode on the given path, so the code below is wrong
-    const auto [subview, success] = subviews_.find_or_insert_with_limit(
-        subnode_name, new node_view(full_path_view_ + subnode_name), max_num_subviews);
+    const auto [subview, success] =
+        subviews_.find_or_emplace_with_limit(subnode_name, subview_factory(subnode_name), max_num_subviews);
     if (!success)
         return nullptr;
+    index_subview(subview);
 
-    // TODO: node::create_subnode() might have just opened an already existing subnode
-    // So starting observing this subnode again in this case is incorrect
-    subview->nodes_.push(subnode);
-    subnode->register_observer(subview);
+    // The subview might already observe the subnode if the create event has been delivered meanwhile
+    if (subview->add_node(subnode))
+        subnode->register_observer(subview);
 
-    return subview;
+    if (!subnode_path.composite())
+        return subview;
+
+    subnode_path.pop_front();
+    return subview->create_subnode(std::move(subnode_path));
 }
 
 std::shared_ptr<node_view> node_view::open_subnode(path_view subview_path) const
@@ -116,28 +129,53 @@ std::shared_ptr<node_view> node_view::open_subnode(path_view subview_path) const
     if (!subview_path.valid())
         return nullptr;
 
-    if (expired_)
-        return nullptr;
+    // Intermediate subviews are only borrowed, so only the reference counter of the resulting subview is touched
+    detail::epoch_guard guard;
 
-    // Take the first element of the given path
-    const std::string subview_name = std::string(*subview_path.front());
+    // A single lookup finds a subview at any depth
+    if (indexed())
+    {
+        std::shared_ptr<node_view> subview;
+        return find_indexed_pinned(subview_path, &subview) ? subview : nullptr;
+    }
+
+    const node_view* parent = find_parent_pinned(subview_path);
+    if (!parent)
+        return nullptr;
 
-    const auto& opt = subviews_.find(subview_name);
+    const auto& opt = parent->subviews_.find(*subview_path.front(), subview_path.front_hash());
     if (!opt)
-    {
         return nullptr;
-    }
 
-    const std::shared_ptr<node_view>& subview = opt.value();
+    return opt.value();
+}
 
-    // Recursively open subnodes if the path is composite
-    if (subview_path.composite())
+borrowed_ptr<node_view> node_view::borrow_subnode(path_view subview_path) const
+{
+    if (!subview_path.valid())
+        return {};
+
+    detail::epoch_guard guard;
+
+    if (indexed())
     {
-        subview_path.pop_front();
-        return subview->open_subnode(std::move(subview_path));
+        node_view* subview = find_indexed_pinned(subview_path);
+        return subview ? borrowed_ptr<node_view>(std::move(guard), subview) : borrowed_ptr<node_view>();
     }
 
-    return subview;
+    const node_view* parent = find_parent_pinned(subview_path);
+    if (!parent)
+        return {};
+
+    node_view* subview = nullptr;
+    parent->subviews_.visit(*subview_path.front(), subview_path.front_hash(),
+                            [&](const std::shared_ptr<node_view>& found) {
+                                subview = found.get();
+                            });
+    if (!subview)
+        return {};
+
+    return borrowed_ptr<node_view>(std::move(guard), subview);
 }
 
 std::shared_ptr<node_view> node_view::load_subnode_tree(const std::shared_ptr<node>& subnode)
@@ -148,7 +186,7 @@ std::shared_ptr<node_view> node_view::load_subnode_tree(const std::shared_ptr<no
     if (!subnode)
         return nullptr;
 
-    if (subnode->deleted_)
+    if (subnode->deleted())
         return nullptr;
 
     // Maximum vault hierarchy depth is already reached, can't load a subnode
@@ -159,10 +197,11 @@ std::shared_ptr<node_view> node_view::load_subnode_tree(const std::shared_ptr<no
 
     // Create a subview to hold the subnode
     const auto& subview_success_pair =
-        subviews_.find_or_insert_with_limit(name, new node_view(full_path_view_ + name), max_num_subviews);
+        subviews_.find_or_emplace_with_limit(name, subview_factory(name), max_num_subviews);
     const auto& [subview, success] = subview_success_pair;
     if (!success)
         return nullptr;
+    index_subview(subview);
 
     // Try to load all subnodes of a given subnode recursively
     bool subnodes_loaded = true;
@@ -177,15 +216,138 @@ std::shared_ptr<node_view> node_view::load_subnode_tree(const std::shared_ptr<no
         return nullptr;
     }
 
-    // TODO: in case the user calls this function twice with the same node
-    // Node subscription will be performed twice
-    subview->nodes_.push(subnode);
-    subnode->register_observer(subview);
+    // Loading the same node twice doesn't subscribe the subview twice
+    if (subview->add_node(subnode))
+        subnode->register_observer(subview);
 
     return subview;
 }
 
-bool node_view::unload_subnode_tree(path_view subview_name)
+std::shared_ptr<node_view> node_view::mount_subnode_tree(const std::shared_ptr<node>& subnode,
+                                                     const traversal_options& options)
+{
+    if (expired_)
+        return nullptr;
+
+    if (!subnode)
+        return nullptr;
+
+    if (subnode->deleted())
+        return nullptr;
+
+    // Maximum vault hierarchy depth is already reached, can't load a subnode
+    if (full_path_view_.size() >= vault::max_tree_depth)
+        return nullptr;
+
+    const std::string name = std::string(subnode->name());
+
+    // Subviews which are already visible can't appear at once, the nodes are merged into them one by one
+    if (subviews_.find(name))
+        return load_subnode_tree(subnode);
+
+    // Subviews of the new subtree are indexed while it's built, but the subtree root only once it's published
+    const bool counted = indexed();
+    if (counted)
+        ++index_->num_partial_subtrees;
+
+    const std::shared_ptr<node_view> subview = subview_factory(name)();
+    std::atomic_bool failed = false;
+    {
+        detail::task_group group(detail::thread_pool::instance(), options.max_parallelism);
+        build_subtree(subview, subnode, options, 0, group, failed);
+        group.wait();
+    }
+
+    bool published = false;
+    if (!failed)
+    {
+        const auto [found, success] = subviews_.find_or_emplace_with_limit(
+            name,
+            [&]() {
+                return subview;
+            },
+            max_num_subviews);
+        published = success && found == subview;
+    }
+
+    if (published)
+    {
+        index_subview(subview);
+        bump_vault_version();
+    }
+    else
+    {
+        // Subtree has never been published, so it is unloaded right away
+        subview->unload_subviews();
+        subview->remove_nodes([](const std::shared_ptr<node>&) {
+            return true;
+        });
+        subview->expired_ = true;
+    }
+
+    if (counted)
+        --index_->num_partial_subtrees;
+
+    // Another thread has loaded a subview with the same name in the meantime, the nodes are merged into it
+    if (!published && !failed)
+        return load_subnode_tree(subnode);
+
+    return published ? subview : nullptr;
+}
+
+void node_view::build_subtree(const std::shared_ptr<node_view>& view, const std::shared_ptr<node>& n,
+                              const traversal_options& options, size_t depth, detail::task_group& group,
+                              std::atomic_bool& failed)
+{
+    node_observations observations;
+    build_subviews(view, n, options, depth, group, failed, observations);
+
+    for (const auto& [observed, observer] : observations)
+        observed->register_observer(observer);
+}
+
+void node_view::build_subviews(const std::shared_ptr<node_view>& view, const std::shared_ptr<node>& n,
+                               const traversal_options& options, size_t depth, detail::task_group& group,
+                               std::atomic_bool& failed, node_observations& observations)
+{
+    view->add_node(n);
+    observations.emplace_back(n, view);
+
+    n->for_each_subnode([&](const std::shared_ptr<node>& sub) {
+        if (failed || sub->deleted())
+            return;
+
+        // Maximum vault hierarchy depth is reached, the whole subtree can't be loaded
+        if (view->full_path_view_.size() >= vault::max_tree_depth)
+        {
+            failed = true;
+            return;
+        }
+
+        const std::string name = std::string(sub->name());
+        const auto [subview, success] =
+            view->subviews_.find_or_emplace_with_limit(name, view->subview_factory(name), max_num_subviews);
+        if (!success)
+        {
+            failed = true;
+            return;
+        }
+        view->index_subview(subview);
+
+        if (depth < options.max_fork_depth)
+        {
+            group.run([&options, &group, &failed, subview = subview, sub, depth]() {
+                build_subtree(subview, sub, options, depth + 1, group, failed);
+            });
+        }
+        else
+        {
+            build_subviews(subview, sub, options, depth + 1, group, failed, observations);
+        }
+    });
+}
+
+bool node_view::unload_subnode_tree(path_view subview_name, teardown mode)
 {
     if (!subview_name.valid() || subview_name.composite())
         return false;
@@ -193,6 +355,18 @@ bool node_view::unload_subnode_tree(path_view subview_name)
     if (expired_)
         return false;
 
+    if (mode == teardown::deferred)
+    {
+        std::optional<std::shared_ptr<node_view>> extracted = subviews_.extract(*subview_name.front());
+        if (!extracted)
+            return false;
+        sorted_subviews_.reset();
+        bump_vault_version();
+
+        defer_unload(std::move(*extracted));
+        return true;
+    }
+
     // Find a subview with the given name
     const std::shared_ptr<node_view>& subview = open_subnode(subview_name);
     if (!subview)
@@ -205,33 +379,91 @@ bool node_view::unload_subnode_tree(path_view subview_name)
     subview->expired_ = true;
 
     // Make the subview stop observing any nodes
-    subview->nodes_.remove_if([](const std::shared_ptr<node>&) {
+    subview->remove_nodes([](const std::shared_ptr<node>&) {
         return true;
     });
 
-    return subviews_.erase(subview_name.str()) > 0;
+    unindex_subview(*subview);
+    std::optional<std::shared_ptr<node_view>> extracted = subviews_.extract(*subview_name.front());
+    if (!extracted)
+        return false;
+    sorted_subviews_.reset();
+    bump_vault_version();
+
+    // Concurrent readers might still be walking through the subview without owning it
+    detail::epoch_domain::instance().retire(std::move(*extracted));
+
+    return true;
 }
 
-void node_view::unload_subnode_tree()
+void node_view::unload_subnode_tree(teardown mode)
 {
     if (expired_)
         return;
 
-    subviews_.for_each([&](const std::shared_ptr<node_view>& subview) {
+    if (mode == teardown::deferred)
+    {
+        for (std::shared_ptr<node_view>& subview : subviews_.extract_all())
+            defer_unload(std::move(subview));
+        sorted_subviews_.reset();
+        bump_vault_version();
+
+        return;
+    }
+
+    unload_subviews();
+}
+
+void node_view::unload_subviews()
+{
+    // Unloading takes the bucket locks of the subviews, so it's done without holding any
+    subviews_.for_each_snapshot([&](const std::shared_ptr<node_view>& subview) {
         subview->unload_subnode_tree();
 
         // Make the subview stop observing any nodes
-        subview->nodes_.remove_if([](const std::shared_ptr<node>&) {
+        subview->remove_nodes([](const std::shared_ptr<node>&) {
             return true;
         });
 
         subview->expired_ = true;
+        unindex_subview(*subview);
     });
 
-    subviews_.clear();
+    // Concurrent readers might still be walking through the subviews without owning them
+    for (std::shared_ptr<node_view>& subview : subviews_.extract_all())
+        detail::epoch_domain::instance().retire(std::move(subview));
+    sorted_subviews_.reset();
+    bump_vault_version();
 }
 
-bool node_view::delete_subview_tree(path_view subview_name)
+void node_view::defer_unload(std::shared_ptr<node_view> subview)
+{
+    subview->expired_ = true;
+
+    // Counted before the subview is removed, so lookups of its subviews check the ancestors as soon as it's gone
+    const bool indexed = subview->indexed();
+    if (indexed)
+    {
+        ++subview->index_->num_partial_subtrees;
+        subview->unindex_subview(*subview);
+    }
+
+    detail::reclaimer::instance().defer([subview = std::move(subview), indexed]() {
+        subview->unload_subviews();
+        if (indexed)
+            --subview->index_->num_partial_subtrees;
+
+        // Make the subview stop observing any nodes
+        subview->remove_nodes([](const std::shared_ptr<node>&) {
+            return true;
+        });
+
+        // Concurrent readers might still be walking through the subview without owning it
+        detail::epoch_domain::instance().retire(subview);
+    });
+}
+
+bool node_view::delete_subview_tree(path_view subview_name, teardown mode)
 {
     if (!subview_name.valid() || subview_name.composite())
         return false;
@@ -244,13 +476,13 @@ bool node_view::delete_subview_tree(path_view subview_name)
     bool success = false;
     // subview will be deleted in the on_delete_subnode() callback
     nodes_.for_each([&](const std::shared_ptr<node>& node) {
-        success = success || node->delete_subnode_tree(target_subview_name);
+        success = success || node->delete_subnode_tree(target_subview_name, mode);
     });
 
     return success;
 }
 
-bool node_view::delete_subview_tree()
+bool node_view::delete_subview_tree(teardown mode)
 {
     if (expired_)
         return false;
@@ -258,7 +490,7 @@ bool node_view::delete_subview_tree()
     bool success = false;
     // each subview will be deleted in the on_delete_subnode() callback
     nodes_.for_each([&](const std::shared_ptr<node>& node) {
-        success = success || node->delete_subnode_tree();
+        success = success || node->delete_subnode_tree(mode);
     });
 
     return success;
@@ -291,6 +523,87 @@ void node_view::delete_values()
     });
 }
 
+std::vector<std::shared_ptr<node_view>> node_view::query(const path_pattern& pattern) const
+{
+    std::vector<std::shared_ptr<node_view>> subviews;
+    query(pattern, [&](const std::shared_ptr<node_view>& subview) {
+        subviews.push_back(subview);
+    });
+
+    return subviews;
+}
+
+std::vector<std::shared_ptr<node_view>> node_view::query_candidates(const path_pattern& pattern,
+                                                                    path_pattern::state_set states) const
+{
+    std::vector<std::shared_ptr<node_view>> candidates;
+    if (expired_)
+        return candidates;
+
+    // Look up the named subviews directly when the pattern doesn't allow any other names
+    if (pattern.names_only(states))
+    {
+        pattern.for_each_name(states, [&](std::string_view name, uint64_t hash) {
+            if (std::optional<std::shared_ptr<node_view>> subview = subviews_.find(name, hash))
+                candidates.push_back(std::move(*subview));
+        });
+        return candidates;
+    }
+
+    subviews_.for_each([&](const std::shared_ptr<node_view>& subview) {
+        candidates.push_back(subview);
+    });
+    return candidates;
+}
+
+std::vector<std::shared_ptr<node_view>> node_view::subviews() const
+{
+    if (expired_)
+        return {};
+
+    return subviews_.values();
+}
+
+std::vector<std::shared_ptr<node_view>> node_view::list_subnodes(std::string_view after, size_t max_count) const
+{
+    std::vector<std::shared_ptr<node_view>> page;
+    if (expired_ || max_count == 0)
+        return page;
+
+    sorted_subviews_.for_each_from(subviews_, after, false, [&](const std::shared_ptr<node_view>& subview) {
+        if (!subview->expired())
+            page.push_back(subview);
+        return page.size() < max_count;
+    });
+
+    return page;
+}
+
+bool node_view::set_values(std::initializer_list<std::pair<std::string_view, value_type>> values)
+{
+    value_batch batch;
+    for (const auto& [value_name, value] : values)
+        batch.set_value(value_name, value);
+
+    return apply_batch(batch);
+}
+
+bool node_view::apply_batch(const value_batch& batch)
+{
+    if (expired_)
+        return false;
+
+    bool success = false;
+
+    // Node list is walked once for the whole batch
+    nodes_.find_first_if([&](const std::shared_ptr<node>& node) {
+        success = node->apply_batch(batch);
+        return success;
+    });
+
+    return success;
+}
+
 std::optional<value_kind> node_view::get_value_kind(const std::string& value_name) const
 {
     if (expired_)
@@ -298,15 +611,147 @@ std::optional<value_kind> node_view::get_value_kind(const std::string& value_nam
 
     std::optional<value_kind> kind;
 
-    // Iterate over observed nodes until we find one which has an attribute with the given name
-    nodes_.find_first_if([&](const std::shared_ptr<node>& node) {
-        kind = node->get_value_kind(value_name);
-        return kind.has_value();
+    // Take the kind of the value of the first observed node which has an attribute with the given name
+    resolve_value(value_name, [&](const std::optional<value_type>& resolved) {
+        if (resolved)
+            kind = static_cast<value_kind>(resolved->index());
     });
 
     return kind;
 }
 
+bool node_view::add_node(const std::shared_ptr<node>& n)
+{
+    if (!nodes_.push_unique(n))
+        return false;
+
+    n->add_view_version(version_);
+    if (index_)
+        n->add_view_version(index_->version);
+    drop_cached_values();
+    return true;
+}
+
+void node_view::drop_cached_values()
+{
+    ++nodes_generation_;
+    version_->fetch_add(1);
+    bump_vault_version();
+    resolutions_.clear();
+
+    std::scoped_lock lock(merged_mutex_);
+    merged_.reset();
+}
+
+void node_view::bump_vault_version() const
+{
+    if (index_)
+        index_->version->fetch_add(1);
+}
+
+bool node_view::unchanged(uint64_t nodes_generation, const node_versions& nodes) const
+{
+    if (nodes_generation != nodes_generation_.load())
+        return false;
+
+    for (const auto& [node, version] : nodes)
+    {
+        if (node->version_.load() != version)
+            return false;
+    }
+
+    return true;
+}
+
+std::optional<value_type> node_view::resolve_uncached(const std::string& value_name) const
+{
+    resolution r;
+
+    // Version is taken before the probes, so a write racing with a probe makes the resolution stale
+    r.version = version_->load();
+    nodes_.find_first_if([&](const std::shared_ptr<node>& node) {
+        node->wait_unlocked();
+        if (node->deleted())
+            return false;
+
+        if (const std::optional<attr> a = node->values_.find(std::string_view(value_name)))
+        {
+            r.holder = node;
+            r.value = a->value();
+            return true;
+        }
+        return false;
+    });
+
+    // Misses are not cached, so lookups of names which no node has can't crowd out the values
+    if (!r.value)
+        return std::nullopt;
+
+    // Once the cache is full a single entry makes room for the new one
+    if (!resolutions_.assign_or_insert_with_limit(value_name, r, max_num_resolutions) && resolutions_.evict_one())
+        resolutions_.assign_or_insert_with_limit(value_name, r, max_num_resolutions);
+
+    return r.value;
+}
+
+bool node_view::fresh(const resolution& r) const
+{
+    if (r.version != version_->load())
+        return false;
+
+    // Nodes of a detached subtree are marked as deleted without a version bump once the reclaimer reaches them
+    return !r.holder->deleted();
+}
+
+bool node_view::fresh(const merged_values& merged) const
+{
+    if (!unchanged(merged.nodes_generation, merged.read_nodes))
+        return false;
+
+    return std::none_of(merged.read_nodes.begin(), merged.read_nodes.end(), [](const auto& n) {
+        return n.first->deleted();
+    });
+}
+
+std::shared_ptr<const node_view::merged_values> node_view::merge_values() const
+{
+    std::shared_ptr<const merged_values> merged;
+    {
+        std::scoped_lock lock(merged_mutex_);
+        merged = merged_;
+    }
+
+    if (merged && fresh(*merged))
+        return merged;
+
+    auto remerged = std::make_shared<merged_values>();
+    remerged->nodes_generation = nodes_generation_.load();
+
+    // Nodes are visited in the priority order, so the first value with a given name hides the rest
+    nodes_.for_each([&](const std::shared_ptr<node>& node) {
+        const uint64_t version = node->wait_unlocked();
+        if (node->deleted())
+            return;
+        remerged->read_nodes.emplace_back(node, version);
+
+        node->values_.for_each([&](const attr& a) {
+            const bool hidden =
+                std::any_of(remerged->values.begin(), remerged->values.end(), [&](const auto& merged_value) {
+                    return merged_value.first.name() == a.name();
+                });
+            if (!hidden)
+                remerged->values.emplace_back(a, node->priority());
+        });
+    });
+
+    {
+        std::scoped_lock lock(merged_mutex_);
+        merged_ = remerged;
+    }
+
+    return remerged;
+}
+
 std::string_view node_view::name() const
 {
     return *full_path_view_.back();
@@ -317,6 +762,19 @@ path_view node_view::path() const
     return full_path_view_;
 }
 
+std::shared_ptr<value_watch> node_view::watch_values(value_watcher watcher, watch_scope scope)
+{
+    if (expired_ || !watcher)
+        return nullptr;
+
+    std::shared_ptr<value_watch> watch(new value_watch(std::move(watcher), scope));
+    nodes_.for_each([&](const std::shared_ptr<node>& node) {
+        node->add_watch(watch);
+    });
+
+    return watch;
+}
+
 bool node_view::expired() const
 {
     return expired_;
@@ -337,7 +795,7 @@ std::ostream& operator<<(std::ostream& lhs, const node_view& rhs)
         });
     });
 
-    rhs.subviews_.for_each([&](const std::shared_ptr<node_view>& subview) {
+    rhs.subviews_.for_each_snapshot([&](const std::shared_ptr<node_view>& subview) {
         lhs << *subview;
     });
 
@@ -345,7 +803,6 @@ std::ostream& operator<<(std::ostream& lhs, const node_view& rhs)
 }
 
 // Called when an observed node creates a new subnode
-// TODO: currently it's also called if an existing subnode was opened using node::create_subnode()
 void node_view::on_create_subnode(const std::shared_ptr<node>& subnode)
 {
     if (expired_)
@@ -353,17 +810,19 @@ void node_view::on_create_subnode(const std::shared_ptr<node>& subnode)
 
     std::string subnode_name = std::string(subnode->name());
 
-    const auto [subview, success] = subviews_.find_or_insert_with_limit(
-        subnode_name, new node_view(full_path_view_ + subnode_name), max_num_subviews);
+    const auto [subview, success] =
+        subviews_.find_or_emplace_with_limit(subnode_name, subview_factory(subnode_name), max_num_subviews);
     if (!success)
     {
         // Too many subviews exist already
         return;
     }
+    index_subview(subview);
 
     // Make the subview start observing the subnode and subscribe to notifications from it
-    subview->nodes_.push(subnode);
-    subnode->register_observer(subview);
+    // The subview might already observe it if it was created through the subview itself
+    if (subview->add_node(subnode))
+        subnode->register_observer(subview);
 }
 
 // Called when a subnode of an observed node was deleted
@@ -382,7 +841,7 @@ void node_view::on_delete_subnode(const std::shared_ptr<node>& subnode)
     const std::shared_ptr<node_view>& subview = opt.value();
 
     // Make the subview stop observing the deleted subnode
-    subview->nodes_.remove_if([&](const std::shared_ptr<node>& node) {
+    subview->remove_nodes([&](const std::shared_ptr<node>& node) {
         return node == subnode;
     });
 
@@ -393,7 +852,118 @@ void node_view::on_delete_subnode(const std::shared_ptr<node>& subnode)
     if (subview->nodes_.size() == 0)
     {
         subview->expired_ = true;
-        subviews_.erase(subnode_name);
+        unindex_subview(*subview);
+
+        // Concurrent readers might still be walking through the subview without owning it
+        if (std::optional<std::shared_ptr<node_view>> extracted = subviews_.extract(subnode_name))
+            detail::epoch_domain::instance().retire(std::move(*extracted));
+        sorted_subviews_.reset();
+        bump_vault_version();
+    }
+}
+
+void node_view::index_subview(const std::shared_ptr<node_view>& subview) const
+{
+    if (!indexed() || subview->expired_)
+        return;
+
+    // Subviews are indexed every time they are opened, so the index is only written to if the subview is missing
+    bool present = false;
+    index_->views.visit(subview->full_path_str_, detail::path_element_hash{}(subview->full_path_str_),
+                        [&](const std::shared_ptr<node_view>& indexed_subview) {
+                            present = indexed_subview == subview;
+                        });
+    if (present)
+        return;
+
+    index_->views.assign_or_insert_with_limit(
+        subview->full_path_str_, subview, std::numeric_limits<size_t>::max(),
+        [](std::string_view, const std::shared_ptr<node_view>* replaced, const std::shared_ptr<node_view>*) {
+            if (replaced)
+                detail::epoch_domain::instance().retire(*replaced);
+        });
+}
+
+void node_view::unindex_subview(const node_view& subview) const
+{
+    if (!index_)
+        return;
+
+    // The path might have been taken by another subview already
+    index_->views.erase_if(
+        subview.full_path_str_,
+        [&](const std::shared_ptr<node_view>& indexed_subview) {
+            return indexed_subview.get() == &subview;
+        },
+        [](std::string_view, const std::shared_ptr<node_view>* removed, const std::shared_ptr<node_view>*) {
+            detail::epoch_domain::instance().retire(*removed);
+        });
+}
+
+bool node_view::indexed() const
+{
+    return index_ && !index_->closed;
+}
+
+node_view* node_view::find_indexed_pinned(path_view subview_path, std::shared_ptr<node_view>* owner) const
+{
+    if (expired_)
+        return nullptr;
+
+    const detail::joined_path key{full_path_view_, subview_path};
+    node_view* subview = nullptr;
+    index_->views.visit(key, key.hash(), [&](const std::shared_ptr<node_view>& indexed_subview) {
+        subview = indexed_subview.get();
+        if (owner)
+            *owner = indexed_subview;
+    });
+    if (!subview || subview->expired_)
+        return nullptr;
+
+    // Subviews of a subtree unloaded with a deferred teardown expire only once the reclaimer reaches them
+    // and subviews of a subtree being mounted are indexed before its root,
+    // until then the subview is reachable only if all of its ancestors are indexed
+    if (index_->num_partial_subtrees > 0)
+    {
+        while (subview_path.composite())
+        {
+            subview_path.pop_back();
+
+            bool reachable = false;
+            const detail::joined_path ancestor_key{full_path_view_, subview_path};
+            index_->views.visit(ancestor_key, ancestor_key.hash(), [&](const std::shared_ptr<node_view>& ancestor) {
+                reachable = !ancestor->expired_;
+            });
+            if (!reachable)
+                return nullptr;
+        }
+    }
+
+    return subview;
+}
+
+const node_view* node_view::find_parent_pinned(path_view& subview_path) const
+{
+    const node_view* current = this;
+    while (true)
+    {
+        if (current->expired_)
+            return nullptr;
+
+        if (!subview_path.composite())
+            return current;
+
+        // Unloaded subviews are retired rather than released, so the pointer stays valid while the epoch is pinned
+        const node_view* next = nullptr;
+        current->subviews_.visit(*subview_path.front(), subview_path.front_hash(),
+                                 [&](const std::shared_ptr<node_view>& subview) {
+                                     next = subview.get();
+                                 });
+        if (!next)
+            return nullptr;
+
+        current = next;
+        subview_path.pop_front();
     }
 }
 } // namespace datastore
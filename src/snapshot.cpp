@@ -0,0 +1,81 @@
+#include "datastore/snapshot.hpp"
+
+#include "datastore/node_view.hpp"
+
+namespace datastore
+{
+snapshot::snapshot()
+    : time_(detail::version_clock::instance().acquire_snapshot())
+{
+}
+
+snapshot::snapshot(snapshot&& other) noexcept
+    : time_(other.time_),
+      active_(std::exchange(other.active_, false))
+{
+}
+
+snapshot& snapshot::operator=(snapshot&& rhs) noexcept
+{
+    if (this == &rhs)
+        return *this;
+
+    if (active_)
+        detail::version_clock::instance().release_snapshot(time_);
+
+    time_ = rhs.time_;
+    active_ = std::exchange(rhs.active_, false);
+
+    return *this;
+}
+
+snapshot::~snapshot()
+{
+    if (active_)
+        detail::version_clock::instance().release_snapshot(time_);
+}
+
+std::optional<value_kind> snapshot::get_value_kind(const std::shared_ptr<node>& n,
+                                                   const std::string& value_name) const
+{
+    const std::optional<value_type> value = read(n, value_name);
+    if (!value)
+        return std::nullopt;
+
+    return static_cast<value_kind>(value->index());
+}
+
+std::optional<value_kind> snapshot::get_value_kind(const std::shared_ptr<node_view>& view,
+                                                   const std::string& value_name) const
+{
+    const std::optional<value_type> value = read(view, value_name);
+    if (!value)
+        return std::nullopt;
+
+    return static_cast<value_kind>(value->index());
+}
+
+std::optional<value_type> snapshot::read(const std::shared_ptr<node>& n, std::string_view value_name) const
+{
+    if (!active_ || !n)
+        return std::nullopt;
+
+    return n->value_at(value_name, time_);
+}
+
+std::optional<value_type> snapshot::read(const std::shared_ptr<node_view>& view, std::string_view value_name) const
+{
+    if (!active_ || !view || view->expired_)
+        return std::nullopt;
+
+    std::optional<value_type> value;
+
+    // Return a value from a node based on node/volume priority
+    view->nodes_.find_first_if([&](const std::shared_ptr<node>& n) {
+        value = n->value_at(value_name, time_);
+        return value.has_value();
+    });
+
+    return value;
+}
+} // namespace datastore
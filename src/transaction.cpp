@@ -0,0 +1,234 @@
+#include "datastore/transaction.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "datastore/node_view.hpp"
+
+namespace datastore
+{
+bool transaction::delete_value(const std::shared_ptr<node>& n, const std::string& value_name)
+{
+    return write(n, value_name, std::nullopt);
+}
+
+bool transaction::delete_value(const std::shared_ptr<node_view>& view, const std::string& value_name)
+{
+    if (!valid_ || !view || view->expired_)
+        return false;
+
+    // Same as node_view::delete_value(), the value is deleted from the first node that has it
+    std::shared_ptr<node> target;
+    view->nodes_.find_first_if([&](const std::shared_ptr<node>& n) {
+        if (read(n, value_name))
+            target = n;
+        return target != nullptr;
+    });
+
+    return target && write(target, value_name, std::nullopt);
+}
+
+bool transaction::commit()
+{
+    if (!valid_)
+        return false;
+    valid_ = false;
+
+    // Nodes are always locked in the same order, so concurrent commits can't deadlock
+    std::sort(writes_.begin(), writes_.end(), [](const write_record& lhs, const write_record& rhs) {
+        return lhs.target.get() < rhs.target.get();
+    });
+
+    std::vector<uint64_t> locked_versions;
+    const bool success = lock_writes(locked_versions) && validate_reads(locked_versions) && writes_fit_limits();
+
+    // Writes to all nodes share the same stamp, so snapshots see either all of them or none
+    const detail::write_scope scope;
+    bool applied = true;
+    for (size_t i = 0; i < locked_versions.size(); ++i)
+    {
+        std::atomic<uint64_t>& version = writes_[i].target->version_;
+        if (success)
+        {
+            // Nothing else writes to the held nodes, so the limits checked above still hold
+            applied = writes_[i].target->write_batch(writes_[i].batch) == 0 && applied;
+            writes_[i].target->bump_view_versions();
+
+            // Unlock and publish a new version at once
+            version.fetch_add(1);
+        }
+        else
+        {
+            // Nothing has changed, plain writes which were applied while the node was being taken
+            // might have bumped the version in the meantime
+            version.fetch_sub(1);
+        }
+    }
+
+    reads_.clear();
+    writes_.clear();
+
+    return success && applied;
+}
+
+bool transaction::valid() const
+{
+    return valid_;
+}
+
+std::optional<value_type> transaction::read(const std::shared_ptr<node>& n, std::string_view value_name)
+{
+    if (!valid_ || !n)
+        return std::nullopt;
+
+    // Reads see the writes made by this transaction
+    const auto write_it = std::find_if(writes_.begin(), writes_.end(), [&](const write_record& w) {
+        return w.target == n;
+    });
+    if (write_it != writes_.end())
+    {
+        const auto& updates = write_it->batch.updates_;
+        const auto update_it = std::find_if(updates.rbegin(), updates.rend(), [&](const auto& update) {
+            return update.first == value_name;
+        });
+        if (update_it != updates.rend())
+            return update_it->second;
+    }
+
+    const uint64_t version = n->wait_unlocked();
+
+    std::optional<value_type> value;
+    if (!n->deleted())
+    {
+        if (const std::optional<attr> a = n->values_.find(value_name))
+            value = a->value();
+    }
+
+    // All reads of the same node must observe the same version
+    const auto read_it = std::find_if(reads_.begin(), reads_.end(), [&](const read_record& r) {
+        return r.target == n;
+    });
+    if (read_it == reads_.end())
+        reads_.push_back({n, version});
+    else if (read_it->version != version)
+        valid_ = false;
+
+    return value;
+}
+
+std::optional<value_type> transaction::read(const std::shared_ptr<node_view>& view, std::string_view value_name)
+{
+    if (!valid_ || !view || view->expired_)
+        return std::nullopt;
+
+    std::optional<value_type> value;
+
+    // Nodes without the value are read as well, so a value added to a node with a higher priority is detected
+    view->nodes_.find_first_if([&](const std::shared_ptr<node>& n) {
+        value = read(n, value_name);
+        return value.has_value();
+    });
+
+    return value;
+}
+
+bool transaction::write(const std::shared_ptr<node>& n, std::string_view value_name, std::optional<value_type> value)
+{
+    if (!valid_ || !n || n->deleted())
+        return false;
+
+    if (value && !node::valid_value(value_name, *value))
+        return false;
+
+    auto write_it = std::find_if(writes_.begin(), writes_.end(), [&](const write_record& w) {
+        return w.target == n;
+    });
+    if (write_it == writes_.end())
+        write_it = writes_.insert(writes_.end(), {n, value_batch()});
+
+    write_it->batch.updates_.emplace_back(std::string(value_name), std::move(value));
+
+    return true;
+}
+
+bool transaction::write(const std::shared_ptr<node_view>& view, std::string_view value_name, value_type value)
+{
+    if (!valid_ || !view || view->expired_)
+        return false;
+
+    // Same as node_view::set_value(), the value is written to the node with the highest priority
+    const std::shared_ptr<std::shared_ptr<node>> main_node = view->nodes_.front();
+    if (!main_node)
+        return false;
+
+    return write(*main_node, value_name, std::move(value));
+}
+
+bool transaction::lock_writes(std::vector<uint64_t>& locked_versions)
+{
+    locked_versions.reserve(writes_.size());
+
+    for (const write_record& w : writes_)
+    {
+        uint64_t version = w.target->wait_unlocked();
+        while (!w.target->version_.compare_exchange_weak(version, version + 1))
+            version = w.target->wait_unlocked();
+
+        locked_versions.push_back(version);
+
+        // Plain writes which have started before the node was taken are let finish, later ones wait for the commit
+        while (w.target->num_plain_writes_.load() > 0)
+            std::this_thread::yield();
+
+        if (w.target->deleted())
+            return false;
+    }
+
+    return true;
+}
+
+bool transaction::validate_reads(const std::vector<uint64_t>& locked_versions) const
+{
+    for (const read_record& r : reads_)
+    {
+        const auto write_it = std::lower_bound(writes_.begin(), writes_.end(), r.target.get(),
+                                               [](const write_record& w, const node* target) {
+                                                   return w.target.get() < target;
+                                               });
+
+        // Nodes locked by this transaction must not have changed since they were read, including the lock time
+        const uint64_t version = r.target->version_.load();
+        if (write_it != writes_.end() && write_it->target == r.target)
+        {
+            if (r.version != locked_versions[write_it - writes_.begin()] || version != r.version + 1)
+                return false;
+        }
+        else if (version != r.version)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool transaction::writes_fit_limits() const
+{
+    // Updates are applied bucket by bucket, so deletions don't make room for insertions in advance
+    for (const write_record& w : writes_)
+    {
+        std::vector<std::string_view> inserted;
+        for (const auto& [value_name, value] : w.batch.updates_)
+        {
+            if (value && std::find(inserted.begin(), inserted.end(), value_name) == inserted.end() &&
+                !w.target->values_.find(std::string_view(value_name)))
+                inserted.push_back(value_name);
+        }
+
+        if (w.target->values_.size() + inserted.size() > node::max_num_values)
+            return false;
+    }
+
+    return true;
+}
+} // namespace datastore
@@ -259,13 +259,14 @@ namespace detail
     auto var = std::get<type>(opt.value());
 
 std::optional<node> serializer::deserialize_node(path_view path, volume::priority_t volume_priority,
+                                                 const std::shared_ptr<volume_context>& context,
                                                  std::vector<uint8_t>& buffer, size_t& pos)
 {
     std::optional<value_type> opt;
 
     DESERIALIZE_OPT(std::string, name, deserialize_str)
 
-    node n(path + name, volume_priority);
+    node n(path + name, volume_priority, context);
 
     DESERIALIZE_OPT(uint64_t, values_count, deserialize_u64)
     for (size_t i = 0; i < values_count; ++i)
@@ -278,20 +279,21 @@ std::optional<node> serializer::deserialize_node(path_view path, volume::priorit
         if (!opt)
             return std::nullopt;
         value_type value = opt.value();
-        attr a(value_name, std::move(value));
-        n.values_.assign_or_insert_with_limit(value_name, std::move(a), node::max_num_values);
+        attr a(value_name, std::move(value), context->resource);
+        n.values_.assign_or_insert_with_limit(std::string_view(value_name), std::move(a), node::max_num_values);
     }
 
     DESERIALIZE_OPT(uint64_t, subnodes_count, deserialize_u64)
     for (size_t i = 0; i < subnodes_count; ++i)
     {
-        std::optional<node> child = deserialize_node(n.path(), volume_priority, buffer, pos);
+        std::optional<node> child = deserialize_node(n.path(), volume_priority, context, buffer, pos);
         if (!child)
             return std::nullopt;
 
-        std::string subnode_name = std::string(child->name());
+        const std::string subnode_name = std::string(child->name());
         auto [subnode, success] = n.subnodes_.find_or_insert_with_limit(
-            std::move(subnode_name), std::make_shared<node>(std::move(child.value())), node::max_num_subnodes);
+            std::string_view(subnode_name), node::make(context->resource, std::move(child.value())),
+            node::max_num_subnodes);
 
         if (!success)
             return std::nullopt;
@@ -338,7 +340,7 @@ bool serializer::serialize_node(const node& n, std::vector<uint8_t>& buffer)
     return success;
 }
 
-std::optional<volume> serializer::deserialize_volume(std::vector<uint8_t>& buffer)
+std::optional<volume> serializer::deserialize_volume(std::vector<uint8_t>& buffer, std::pmr::memory_resource* resource)
 {
     size_t pos = 0;
     std::optional<value_type> opt;
@@ -356,12 +358,14 @@ std::optional<volume> serializer::deserialize_volume(std::vector<uint8_t>& buffe
 
     DESERIALIZE_OPT(uint32_t, priority, deserialize_u32)
 
-    volume vol("root", static_cast<volume::priority_t>(priority));
+    volume vol("root", static_cast<volume::priority_t>(priority), resource);
 
-    std::optional<node> root_opt = deserialize_node("", static_cast<volume::priority_t>(priority), buffer, pos);
+    std::optional<node> root_opt =
+        deserialize_node("", static_cast<volume::priority_t>(priority), vol.context_, buffer, pos);
     if (!root_opt)
         return std::nullopt;
-    vol.root_ = std::make_shared<node>(std::move(root_opt.value()));
+    vol.root_ = node::make(resource, std::move(root_opt.value()));
+    vol.root_->link_subnodes();
 
     if (pos != buffer.size())
         return std::nullopt;
@@ -382,10 +386,95 @@ bool serializer::serialize_volume(volume& vol, std::vector<uint8_t>& buffer)
 }
 } // namespace detail
 
-volume::volume(path_view root_name, priority_t priority)
+volume::volume(path_view root_name, priority_t priority, std::pmr::memory_resource* resource)
     : priority_(priority),
-      root_(new node(std::move(root_name), priority))
+      context_(std::allocate_shared<detail::volume_context>(
+          std::pmr::polymorphic_allocator<detail::volume_context>(resource), resource)),
+      root_(node::make(resource, std::move(root_name), priority, context_))
 {
+    // The destructor drains the background threads, so they must outlive the volume
+    detail::reclaimer::instance();
+    detail::event_dispatcher::instance();
+    detail::watch_dispatcher::instance();
+}
+
+volume::~volume()
+{
+    if (!root_)
+        return;
+
+    // Readers might still hold borrowed pointers to the root or to deleted nodes,
+    // make sure the nodes are released once the readers leave but before the memory resource goes away
+    detail::epoch_domain::instance().retire(std::move(root_));
+
+    // Pending background tasks might still own nodes of the volume, let them finish before the memory resource goes
+    // Teardown tasks post observer events, so they are drained first
+    detail::reclaimer::instance().wait_idle();
+    wait_for_observers();
+
+    // A pinned thread can't wait for the readers, it waits once it leaves its own pinned scope
+    detail::epoch_domain::instance().synchronize_on_leave();
+}
+
+bool volume::create_index(std::string_view value_name)
+{
+    if (value_name.size() > max_value_name_size_bytes)
+        return false;
+
+    if (!context_->indexes.create(value_name))
+        return false;
+
+    // Writes which might have missed the new index are applied before the existing values are indexed
+    detail::version_clock::instance().wait_for_writes();
+    root_->index_subtree(value_name);
+
+    return true;
+}
+
+bool volume::drop_index(std::string_view value_name)
+{
+    return context_->indexes.drop(value_name);
+}
+
+std::optional<std::vector<change_record>> volume::read_changes(uint64_t& position, size_t max_count) const
+{
+    uint64_t next_position = position;
+    std::vector<change_record> changes;
+    const auto status =
+        context_->changes.read(next_position, max_count, [&](uint64_t sequence, const change_record& record) {
+            change_record& change = changes.emplace_back(record);
+            change.sequence = sequence;
+        });
+    if (status == detail::sequenced_ring<change_record>::read_status::overflow)
+        return std::nullopt;
+
+    position = next_position;
+    return changes;
+}
+
+std::optional<std::vector<std::shared_ptr<node>>> volume::find_nodes(std::string_view value_name,
+                                                                     const value_type& value) const
+{
+    return find_nodes_between(value_name, value, value);
+}
+
+std::optional<std::vector<std::shared_ptr<node>>> volume::find_nodes_between(std::string_view value_name,
+                                                                             const value_type& min,
+                                                                             const value_type& max) const
+{
+    std::shared_lock lock(context_->indexes.mutex());
+    const detail::value_indexes::index* i = context_->indexes.find(value_name);
+    if (!i)
+        return std::nullopt;
+
+    std::shared_lock index_lock(i->mutex);
+    std::vector<std::shared_ptr<node>> nodes;
+    i->for_each_between(min, max, [&](const std::weak_ptr<node>& ref) {
+        if (std::shared_ptr<node> n = ref.lock(); n && !n->deleted())
+            nodes.push_back(std::move(n));
+    });
+
+    return nodes;
 }
 
 bool volume::save(const std::filesystem::path& filepath)
@@ -409,7 +498,7 @@ bool volume::save(const std::filesystem::path& filepath)
     return true;
 }
 
-std::optional<volume> volume::load(const std::filesystem::path& filepath)
+std::optional<volume> volume::load(const std::filesystem::path& filepath, std::pmr::memory_resource* resource)
 {
     if (!std::filesystem::is_regular_file(filepath))
         return std::nullopt;
@@ -437,6 +526,6 @@ std::optional<volume> volume::load(const std::filesystem::path& filepath)
     ifs.close();
 
     detail::serializer s;
-    return s.deserialize_volume(buffer);
+    return s.deserialize_volume(buffer, resource);
 }
 } // namespace datastore
@@ -86,7 +86,7 @@ inline void node_get_tree(const std::shared_ptr<datastore::node>& parent, size_t
     }
 
     parent->for_each_subnode([&](const std::shared_ptr<datastore::node>& subnode) {
-        // Make sure it's safe to work with values while holding a subnodes lock
+        // Make sure it's safe to work with values while iterating over subnodes
         parent->for_each_value([&](const datastore::attr& a) {
             DATASTORE_UNUSED(*a.get_value_kind());
             DATASTORE_UNUSED(*a.get_value<std::string>());
@@ -122,14 +122,11 @@ inline void node_view_get_tree(const std::shared_ptr<datastore::node_view>& pare
     }
 
     parent->for_each_subnode([&](const std::shared_ptr<datastore::node_view>& subnode) {
-        // Due to a potential deadlock caused by a cycle in a lock order graph,
-        // it's NOT safe to work with values while holding a subviews lock
-        // Run with thread sanitizer for details.
-
-        // parent->for_each_value([&](const attr& a) {
-        //     DATASTORE_UNUSED(*a.get_value_kind());
-        //     DATASTORE_UNUSED(*a.get_value<std::string>());
-        // });
+        // Make sure it's safe to work with values while iterating over subviews
+        parent->for_each_value([&](const datastore::attr& a) {
+            DATASTORE_UNUSED(*a.get_value_kind());
+            DATASTORE_UNUSED(*a.get_value<std::string>());
+        });
 
         node_view_get_tree(subnode, cur_depth + 1);
     });
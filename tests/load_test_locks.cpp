@@ -0,0 +1,64 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "datastore/detail/reader_biased_mutex.hpp"
+#include "datastore/detail/striped_hashmap.hpp"
+
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+constexpr int num_keys = 10;
+constexpr int num_finds_per_thread = 100000;
+
+// Every thread looks up the same few keys, so all of them contend for the same bucket locks
+template <typename Mutex>
+size_t find_concurrently(const datastore::detail::striped_hashmap<int, int, std::hash<int>, Mutex>& map,
+                         size_t num_threads)
+{
+    std::vector<size_t> found(num_threads, 0);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            size_t count = 0;
+            for (int i = 0; i < num_finds_per_thread; ++i)
+                count += map.find(i % num_keys).has_value();
+            found[t] = count;
+        });
+    }
+
+    size_t total = 0;
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        threads[t].join();
+        total += found[t];
+    }
+    return total;
+}
+
+template <typename Mutex>
+void benchmark_finds(const std::string& lock_name)
+{
+    datastore::detail::striped_hashmap<int, int, std::hash<int>, Mutex> map;
+    for (int i = 0; i < num_keys; ++i)
+        map.assign_or_insert_with_limit(i, i, num_keys);
+
+    for (size_t num_threads = 1; num_threads <= 64; num_threads *= 2)
+    {
+        BENCHMARK("Benchmark concurrent finds with " + lock_name + ", " + std::to_string(num_threads) + " threads")
+        {
+            return find_concurrently(map, num_threads);
+        };
+    }
+}
+} // namespace
+
+TEST_CASE("Striped hashmap reads scale with the number of threads")
+{
+    benchmark_finds<std::shared_mutex>("std::shared_mutex");
+    benchmark_finds<datastore::detail::reader_biased_mutex>("reader_biased_mutex");
+}
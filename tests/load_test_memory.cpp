@@ -0,0 +1,124 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "datastore/volume.hpp"
+
+#include "load_test_common.hpp"
+
+#include <iostream>
+#include <memory_resource>
+
+using namespace datastore;
+
+namespace
+{
+// Upper bound of the memory allocated for an empty subnode with a short name
+// Includes a share of the buckets of the parent, which are allocated along with its first subnode.
+constexpr size_t max_empty_node_bytes = 640;
+
+// Counts allocations passed to the upstream resource
+class counting_resource : public std::pmr::memory_resource
+{
+  public:
+    size_t num_allocations = 0;
+    size_t num_bytes = 0;
+
+  private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        num_allocations++;
+        num_bytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+} // namespace
+
+TEST_CASE("Volume memory resource reduces the number of heap allocations")
+{
+    counting_resource heap;
+    {
+        volume vol("vol", volume::priority_class::medium, &heap);
+        load_test::node_create_tree(vol.root());
+    }
+
+    counting_resource pool_upstream;
+    {
+        std::pmr::synchronized_pool_resource pool(&pool_upstream);
+        volume vol("vol", volume::priority_class::medium, &pool);
+        load_test::node_create_tree(vol.root());
+    }
+
+    counting_resource arena_upstream;
+    {
+        std::pmr::monotonic_buffer_resource arena(&arena_upstream);
+        volume vol("vol", volume::priority_class::medium, &arena);
+        load_test::node_create_tree(vol.root());
+    }
+
+    std::cout << "Heap allocations using the default resource: " << heap.num_allocations << "\n";
+    std::cout << "Heap allocations using a pool resource: " << pool_upstream.num_allocations << "\n";
+    std::cout << "Heap allocations using a monotonic resource: " << arena_upstream.num_allocations << "\n";
+
+    CHECK(pool_upstream.num_allocations < heap.num_allocations);
+    CHECK(arena_upstream.num_allocations < heap.num_allocations);
+
+    BENCHMARK("Benchmark volume tree initialization and teardown using the default resource")
+    {
+        volume vol("vol", volume::priority_class::medium);
+        load_test::node_create_tree(vol.root());
+    };
+
+    BENCHMARK("Benchmark volume tree initialization and teardown using a pool resource")
+    {
+        std::pmr::synchronized_pool_resource pool;
+        volume vol("vol", volume::priority_class::medium, &pool);
+        load_test::node_create_tree(vol.root());
+    };
+
+    BENCHMARK("Benchmark volume tree initialization and teardown using a monotonic resource")
+    {
+        std::pmr::monotonic_buffer_resource arena;
+        volume vol("vol", volume::priority_class::medium, &arena);
+        load_test::node_create_tree(vol.root());
+    };
+}
+
+TEST_CASE("Sparsely populated nodes don't allocate memory for their buckets")
+{
+    counting_resource heap;
+    volume vol("vol", volume::priority_class::medium, &heap);
+
+    const size_t empty_before = heap.num_bytes;
+    for (size_t i = 0; i < node::max_num_subnodes; ++i)
+        vol.root()->create_subnode("empty" + std::to_string(i));
+    const size_t empty_bytes = (heap.num_bytes - empty_before) / node::max_num_subnodes;
+
+    const std::shared_ptr<node> populated = vol.root()->open_subnode("empty0");
+    const size_t populated_before = heap.num_bytes;
+    for (size_t i = 0; i < node::max_num_subnodes; ++i)
+    {
+        const std::shared_ptr<node> subnode = populated->create_subnode("populated" + std::to_string(i));
+        subnode->set_value("value", uint32_t(i));
+        subnode->create_subnode("subnode");
+    }
+    const size_t populated_bytes = (heap.num_bytes - populated_before) / node::max_num_subnodes;
+
+    std::cout << "Bytes allocated for an empty node: " << empty_bytes << "\n";
+    std::cout << "Bytes allocated for a node with a value and a subnode: " << populated_bytes << "\n";
+
+    CHECK(empty_bytes < populated_bytes);
+
+    // An empty node pays for itself, its control block and its entry in the parent,
+    // the parts used only by ordered scans, observers and snapshots aren't allocated
+    CHECK(empty_bytes <= max_empty_node_bytes);
+}
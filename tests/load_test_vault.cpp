@@ -7,6 +7,7 @@
 #include "load_test_common.hpp"
 
 using namespace datastore;
+using namespace datastore::literals;
 
 TEST_CASE("Vault supports basic operations at its elements size limits")
 {
@@ -41,3 +42,126 @@ TEST_CASE("Vault supports basic operations at its elements size limits")
         return load_test::node_view_unload_subnode(vol_root, 2);
     };
 }
+
+TEST_CASE("Volume writes are not slowed down by observing vaults with asynchronous dispatch")
+{
+    volume vol("vol", volume::priority_class::medium);
+
+    constexpr size_t num_vaults = 16;
+    std::vector<vault> vaults(num_vaults);
+    for (vault& vault : vaults)
+        CHECK(vault.root()->load_subnode_tree(vol.root()));
+
+    BENCHMARK("Benchmark volume tree initialization with synchronous dispatch")
+    {
+        vol.set_observer_dispatch(dispatch::synchronous);
+        load_test::node_create_tree(vol.root(), 3);
+        load_test::node_delete_tree(vol.root(), 3);
+    };
+
+    BENCHMARK_ADVANCED("Benchmark volume tree initialization with asynchronous dispatch")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        vol.set_observer_dispatch(dispatch::asynchronous);
+        meter.measure([&]() {
+            load_test::node_create_tree(vol.root(), 3);
+            load_test::node_delete_tree(vol.root(), 3);
+        });
+
+        // Observers catch up outside of the measurement, so the queue doesn't grow across the runs
+        vol.wait_for_observers();
+    };
+
+    vol.wait_for_observers();
+    for (vault& vault : vaults)
+        CHECK(vault.root()->open_subnode("vol") != nullptr);
+}
+
+TEST_CASE("Node view reads don't slow down with the number of stacked volumes")
+{
+    constexpr size_t num_volumes = 8;
+    std::vector<volume> volumes;
+    volumes.reserve(num_volumes);
+    volumes.emplace_back("vol", volume::priority_class::low);
+    for (size_t i = 1; i < num_volumes; ++i)
+        volumes.emplace_back("vol", volume::priority_class::medium);
+
+    // Only the volume with the lowest priority has the value, the rest are probed before it
+    vault vault;
+    CHECK(volumes.front().root()->set_value("k", 0_u32));
+    for (volume& vol : volumes)
+        CHECK(vault.root()->load_subnode_tree(vol.root()));
+    const std::shared_ptr<node_view> view = vault.root()->open_subnode("vol");
+
+    BENCHMARK("Benchmark node view reads of the lowest priority value")
+    {
+        return view->get_value<uint32_t>("k");
+    };
+
+    BENCHMARK("Benchmark node view reads of a missing value")
+    {
+        return view->get_value<uint32_t>("missing");
+    };
+
+    const std::shared_ptr<const frozen_vault> frozen = vault.freeze();
+    BENCHMARK("Benchmark frozen vault reads of the lowest priority value")
+    {
+        return frozen->get_value<uint32_t>("vol", "k");
+    };
+
+    BENCHMARK("Benchmark node view value iteration")
+    {
+        size_t num_values = 0;
+        view->for_each_value_with_priority([&](const attr&, uint8_t) {
+            ++num_values;
+        });
+        return num_values;
+    };
+}
+
+TEST_CASE("Deep node view paths are opened with a single lookup")
+{
+    volume vol("vol", volume::priority_class::medium);
+    CHECK(vol.root()->create_subnode("1")->create_subnode("2")->create_subnode("3")->create_subnode("4") != nullptr);
+
+    vault vault;
+    CHECK(vault.root()->load_subnode_tree(vol.root()));
+
+    BENCHMARK("Benchmark opening a node view five levels deep")
+    {
+        return vault.root()->open_subnode("vol.1.2.3.4");
+    };
+
+    BENCHMARK("Benchmark borrowing a node view five levels deep")
+    {
+        return vault.borrow_root()->borrow_subnode("vol.1.2.3.4").get();
+    };
+}
+
+TEST_CASE("Large volumes are mounted in parallel")
+{
+    volume vol("vol", volume::priority_class::medium);
+    for (size_t i = 0; i < node::max_num_subnodes; ++i)
+    {
+        for (size_t j = 0; j < node::max_num_subnodes; ++j)
+        {
+            for (size_t k = 0; k < node::max_num_subnodes; ++k)
+            {
+                const std::string path = std::to_string(i) + "." + std::to_string(j) + "." + std::to_string(k);
+                CHECK(vol.root()->create_subnode(path)->set_value("k", static_cast<uint64_t>(k)));
+            }
+        }
+    }
+
+    BENCHMARK("Benchmark loading a volume of a thousand nodes")
+    {
+        vault vault;
+        return vault.root()->load_subnode_tree(vol.root()) != nullptr;
+    };
+
+    BENCHMARK("Benchmark mounting a volume of a thousand nodes")
+    {
+        vault vault;
+        return vault.root()->mount_subnode_tree(vol.root()) != nullptr;
+    };
+}
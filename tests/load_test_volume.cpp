@@ -5,6 +5,11 @@
 
 #include "load_test_common.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+
 using namespace datastore;
 
 TEST_CASE("Volume supports basic operations at its elements size limits")
@@ -34,3 +39,127 @@ TEST_CASE("Volume supports basic operations at its elements size limits")
         return load_test::node_delete_tree(load_test::vol2.root());
     };
 }
+
+TEST_CASE("Volume node values can be updated in batches")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const std::shared_ptr<node>& root = vol.root();
+
+    value_batch batch;
+    for (size_t i = 0; i < node::max_num_values; ++i)
+        batch.set_value("value" + std::to_string(i), static_cast<uint64_t>(i));
+
+    BENCHMARK("Benchmark setting values one by one")
+    {
+        bool success = true;
+        for (size_t i = 0; i < node::max_num_values; ++i)
+            success = root->set_value("value" + std::to_string(i), static_cast<uint64_t>(i)) && success;
+        return success;
+    };
+
+    BENCHMARK("Benchmark setting values in a batch")
+    {
+        return root->apply_batch(batch);
+    };
+}
+
+TEST_CASE("Volume tree can be traversed in parallel")
+{
+    volume vol("vol", volume::priority_class::medium);
+    load_test::node_create_tree(vol.root());
+
+    // Reads all values of a node like a validation or an export job would
+    const auto visit = [](const std::shared_ptr<node>& n) {
+        n->for_each_value([&](const attr& a) {
+            DATASTORE_UNUSED(*a.get_value<std::string>());
+        });
+    };
+
+    BENCHMARK("Benchmark sequential tree traversal")
+    {
+        std::function<void(const std::shared_ptr<node>&)> traverse = [&](const std::shared_ptr<node>& parent) {
+            parent->for_each_subnode([&](const std::shared_ptr<node>& subnode) {
+                visit(subnode);
+                traverse(subnode);
+            });
+        };
+        traverse(vol.root());
+    };
+
+    BENCHMARK("Benchmark parallel tree traversal")
+    {
+        vol.root()->parallel_for_each_subnode(visit);
+    };
+}
+
+TEST_CASE("Volume subtrees can be deleted without stalling the caller")
+{
+    // Trees are too big to be rebuilt for every benchmark run, so a single deletion of each kind is timed
+    const auto time_deletion = [](teardown mode) {
+        volume vol("vol", volume::priority_class::medium);
+        load_test::node_create_tree(vol.root());
+
+        const auto start = std::chrono::steady_clock::now();
+        CHECK(vol.root()->delete_subnode_tree(mode));
+        const auto stall = std::chrono::steady_clock::now() - start;
+
+        detail::reclaimer::instance().wait_idle();
+        return std::chrono::duration_cast<std::chrono::microseconds>(stall).count();
+    };
+
+    std::cout << "Caller stall deleting a tree with an immediate teardown: " << time_deletion(teardown::immediate)
+              << " us\n";
+    std::cout << "Caller stall deleting a tree with a deferred teardown: " << time_deletion(teardown::deferred)
+              << " us\n";
+}
+
+TEST_CASE("Volume node values can be watched instead of polled")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const std::shared_ptr<node>& root = vol.root();
+
+    BENCHMARK("Benchmark setting values of an unwatched node")
+    {
+        return root->set_value("value", static_cast<uint64_t>(0)) && root->set_value("value", static_cast<uint64_t>(1));
+    };
+
+    std::atomic_size_t num_changes = 0;
+    const std::shared_ptr<value_watch> watch = root->watch_values([&](const std::vector<value_change>& changes) {
+        num_changes += changes.size();
+    });
+
+    BENCHMARK("Benchmark setting values of a watched node")
+    {
+        return root->set_value("value", static_cast<uint64_t>(0)) && root->set_value("value", static_cast<uint64_t>(1));
+    };
+
+    vol.wait_for_observers();
+    CHECK(num_changes > 0);
+}
+
+TEST_CASE("Volume changes can be recorded in a change feed")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const std::shared_ptr<node>& root = vol.root();
+
+    BENCHMARK("Benchmark volume tree initialization without a change feed")
+    {
+        load_test::node_create_tree(root, 3);
+        load_test::node_delete_tree(root, 3);
+    };
+
+    CHECK(vol.enable_change_feed());
+
+    BENCHMARK("Benchmark volume tree initialization with a change feed")
+    {
+        load_test::node_create_tree(root, 3);
+        load_test::node_delete_tree(root, 3);
+    };
+
+    uint64_t position = vol.change_feed_end() - 100;
+    BENCHMARK("Benchmark reading the change feed")
+    {
+        uint64_t p = position;
+        return vol.read_changes(p, 100);
+    };
+}
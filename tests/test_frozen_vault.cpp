@@ -0,0 +1,165 @@
+#include "datastore/vault.hpp"
+#include "datastore/volume.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+using namespace datastore;
+using namespace datastore::literals;
+
+TEST_CASE("Frozen vault serves the values resolved by priority", "[frozen_vault]")
+{
+    volume vol1("vol", volume::priority_class::low);
+    vol1.root()->set_value("k", "v1");
+    vol1.root()->set_value("low", 1_u32);
+    vol1.root()->create_subnode("1")->set_value("k", 1.0);
+
+    volume vol2("vol", volume::priority_class::medium);
+    vol2.root()->set_value("k", 2_u32);
+    vol2.root()->create_subnode("2")->create_subnode("3")->set_value("k", "v3");
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol1.root());
+    vault.root()->load_subnode_tree(vol2.root());
+
+    const std::shared_ptr<const frozen_vault> frozen = vault.freeze();
+    REQUIRE(frozen != nullptr);
+    CHECK(frozen->size() == 4);
+
+    CHECK(frozen->contains(""));
+    CHECK(frozen->contains("vol"));
+    CHECK(frozen->contains("vol.1"));
+    CHECK(frozen->contains("vol.2.3"));
+    CHECK_FALSE(frozen->contains("vol.4"));
+    CHECK_FALSE(frozen->contains("vol.2.3.4"));
+
+    CHECK(frozen->get_value_kind("vol", "k") == value_kind::u32);
+    CHECK(frozen->get_value<uint32_t>("vol", "k") == 2_u32);
+    CHECK(frozen->get_value<uint32_t>("vol", "low") == 1_u32);
+    CHECK(frozen->get_value<double>("vol.1", "k") == 1.0);
+    CHECK(frozen->get_value<std::string>("vol.2.3", "k") == "v3");
+
+    // The value of a lower priority node is hidden even if it has the requested type
+    CHECK_FALSE(frozen->get_value<std::string>("vol", "k"));
+
+    CHECK_FALSE(frozen->get_value_kind("vol", "missing"));
+    CHECK_FALSE(frozen->get_value_kind("vol.2", "k"));
+    CHECK_FALSE(frozen->get_value_kind("", "k"));
+
+    size_t num_values = 0;
+    frozen->for_each_value("vol", [&](const attr&) {
+        ++num_values;
+    });
+    CHECK(num_values == 2);
+}
+
+TEST_CASE("Frozen vault is rebuilt once the vault changes", "[frozen_vault]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    vol.root()->set_value("k", 1_u32);
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol.root());
+
+    const std::shared_ptr<const frozen_vault> frozen1 = vault.freeze();
+    CHECK(frozen1->current());
+    CHECK(vault.freeze() == frozen1);
+
+    // Value writes
+    vol.root()->set_value("k", 2_u32);
+    CHECK_FALSE(frozen1->current());
+    CHECK(frozen1->get_value<uint32_t>("vol", "k") == 1_u32);
+
+    const std::shared_ptr<const frozen_vault> frozen2 = vault.freeze();
+    CHECK(frozen2 != frozen1);
+    CHECK(frozen2->get_value<uint32_t>("vol", "k") == 2_u32);
+
+    // Created subnodes
+    vol.root()->create_subnode("1");
+    CHECK_FALSE(frozen2->current());
+    const std::shared_ptr<const frozen_vault> frozen3 = vault.freeze();
+    CHECK(frozen3->contains("vol.1"));
+
+    // Deleted subnodes
+    CHECK(vol.root()->delete_subnode_tree("1") == 1);
+    CHECK_FALSE(frozen3->current());
+    const std::shared_ptr<const frozen_vault> frozen4 = vault.freeze();
+    CHECK_FALSE(frozen4->contains("vol.1"));
+
+    // Unloaded volumes
+    CHECK(vault.root()->unload_subnode_tree("vol"));
+    CHECK_FALSE(frozen4->current());
+    const std::shared_ptr<const frozen_vault> frozen5 = vault.freeze();
+    CHECK_FALSE(frozen5->contains("vol"));
+    CHECK(frozen5->size() == 0);
+    CHECK(frozen5->current());
+}
+
+TEST_CASE("Frozen vault is reused while the vault doesn't change", "[frozen_vault]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    vol.root()->create_subnode("1")->create_subnode("2")->set_value("k", 1_u32);
+
+    volume other("other", volume::priority_class::medium);
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol.root());
+
+    const std::shared_ptr<const frozen_vault> frozen1 = vault.freeze();
+    CHECK(vault.freeze() == frozen1);
+
+    // Writes to the nodes which aren't loaded into the vault leave the image as it is
+    other.root()->set_value("k", 1_u32);
+    other.root()->create_subnode("1");
+    CHECK(vault.freeze() == frozen1);
+
+    // Writes deep in the tree
+    vol.root()->open_subnode("1.2")->set_value("k", 2_u32);
+    const std::shared_ptr<const frozen_vault> frozen2 = vault.freeze();
+    CHECK(frozen2 != frozen1);
+    CHECK(frozen2->get_value<uint32_t>("vol.1.2", "k") == 2_u32);
+    CHECK(vault.freeze() == frozen2);
+
+    // Nodes of an unloaded volume aren't observed anymore
+    CHECK(vault.root()->unload_subnode_tree("vol"));
+    const std::shared_ptr<const frozen_vault> frozen3 = vault.freeze();
+    CHECK_FALSE(frozen3->contains("vol"));
+
+    vol.root()->open_subnode("1.2")->set_value("k", 3_u32);
+    CHECK(vault.freeze() == frozen3);
+}
+
+TEST_CASE("Frozen vault finds every value of a large vault", "[frozen_vault]")
+{
+    constexpr size_t n = node::max_num_subnodes;
+    static_assert(node::max_num_values == n);
+
+    volume vol("vol", volume::priority_class::medium);
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t j = 0; j < n; ++j)
+        {
+            const std::shared_ptr<node> subnode = vol.root()->create_subnode(std::to_string(i))->create_subnode(
+                std::to_string(j));
+            for (size_t k = 0; k < n; ++k)
+                CHECK(subnode->set_value(std::to_string(k), static_cast<uint64_t>((i * n + j) * n + k)));
+        }
+    }
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol.root());
+
+    const std::shared_ptr<const frozen_vault> frozen = vault.freeze();
+    CHECK(frozen->size() == n * n * n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t j = 0; j < n; ++j)
+        {
+            const std::string path = "vol." + std::to_string(i) + "." + std::to_string(j);
+            for (size_t k = 0; k < n; ++k)
+                CHECK(frozen->get_value<uint64_t>(path, std::to_string(k)) == (i * n + j) * n + k);
+            CHECK_FALSE(frozen->get_value_kind(path, std::to_string(n)));
+        }
+    }
+}
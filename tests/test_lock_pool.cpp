@@ -0,0 +1,111 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "datastore/detail/lock_pool.hpp"
+#include "datastore/detail/striped_hashmap.hpp"
+
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+using datastore::detail::pooled_mutex;
+
+namespace
+{
+// Counts the allocations made through it
+class counting_resource : public std::pmr::memory_resource
+{
+  public:
+    size_t num_allocations = 0;
+
+  private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++num_allocations;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+} // namespace
+
+TEST_CASE("Pooled mutexes sharing a lock exclude each other", "[lock_pool]")
+{
+    // Pool of a single lock
+    pooled_mutex<std::shared_mutex, 1> mutex1;
+    pooled_mutex<std::shared_mutex, 1> mutex2;
+    CHECK(&mutex1.underlying() == &mutex2.underlying());
+    CHECK(lock_identity(mutex1) == lock_identity(mutex2));
+
+    std::unique_lock lock(mutex1);
+    std::thread([&]() {
+        CHECK(!mutex2.try_lock());
+        CHECK(!mutex2.try_lock_shared());
+    }).join();
+}
+
+TEST_CASE("Striped hashmap can lock all buckets sharing a single lock", "[lock_pool]")
+{
+    datastore::detail::striped_hashmap<int, int, std::hash<int>, pooled_mutex<std::shared_mutex, 1>> map;
+    for (int i = 0; i < 10; ++i)
+        CHECK(map.assign_or_insert_with_limit(i, i, 10));
+
+    int sum = 0;
+    map.for_each([&](int value) {
+        sum += value;
+    });
+    CHECK(sum == 45);
+
+    CHECK(map.extract_all().size() == 10);
+    CHECK(map.size() == 0);
+
+    CHECK(map.assign_or_insert_with_limit(1, 1, 10));
+    map.clear();
+    CHECK(map.size() == 0);
+}
+
+TEST_CASE("Striped hashmap allocates buckets on the first insertion", "[lock_pool]")
+{
+    counting_resource resource;
+    datastore::detail::striped_hashmap<int, int, std::hash<int>, pooled_mutex<>> map(13, &resource);
+
+    CHECK(!map.find(1).has_value());
+    CHECK(map.erase(1) == 0);
+    CHECK(!map.extract(1).has_value());
+    CHECK(map.values().empty());
+    CHECK(map.extract_all().empty());
+    map.clear();
+    CHECK(map.apply_batch<int, int>({{1, std::nullopt}}, 10) == 0);
+    CHECK(resource.num_allocations == 0);
+
+    CHECK(map.assign_or_insert_with_limit(1, 10, 10));
+    CHECK(resource.num_allocations > 0);
+    CHECK(map.find(1) == 10);
+}
+
+TEST_CASE("Striped hashmap buckets can be allocated concurrently", "[lock_pool]")
+{
+    datastore::detail::striped_hashmap<int, int> map;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 10; ++i)
+                map.assign_or_insert_with_limit(t * 10 + i, i, 100);
+        });
+    }
+    for (std::thread& t : threads)
+        t.join();
+
+    CHECK(map.size() == 40);
+}
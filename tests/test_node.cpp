@@ -3,7 +3,14 @@
 #include "datastore/node.hpp"
 #include "datastore/volume.hpp"
 
+#include <atomic>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace datastore;
 
@@ -23,6 +30,19 @@ TEST_CASE("Nodes can be created and opened", "[node]")
     CHECK(vol.root()->open_subnode("1.2.3") == node_1_2_3);
 }
 
+TEST_CASE("Nodes can be opened using literal paths", "[node]")
+{
+    using namespace datastore::literals;
+
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node_1_2_3 = vol.root()->create_subnode("1.2.3"_path);
+
+    CHECK(node_1_2_3 != nullptr);
+    CHECK(vol.root()->open_subnode("1.2.3"_path) == node_1_2_3);
+    CHECK(vol.root()->open_subnode("1.2"_path)->open_subnode("3"_path) == node_1_2_3);
+    CHECK(vol.root()->open_subnode("1.2.4"_path) == nullptr);
+}
+
 TEST_CASE("Node trees can be deleted", "[node]")
 {
     volume vol("vol", volume::priority_class::medium);
@@ -101,3 +121,598 @@ TEST_CASE("Subnodes can be iterated over", "[node]")
     CHECK(subnode1_present);
     CHECK(subnode2_present);
 }
+
+TEST_CASE("Deep node lookups are not affected by the path cache", "[node]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node_1_2_3 = vol.root()->create_subnode("1.2.3");
+
+    // Repeated lookups are served from the path cache
+    CHECK(vol.root()->open_subnode("1.2.3") == node_1_2_3);
+    CHECK(vol.root()->open_subnode("1.2.3") == node_1_2_3);
+    CHECK(vol.root()->open_subnode("1")->open_subnode("2.3") == node_1_2_3);
+
+    // Deleted subtrees can't be found
+    CHECK(vol.root()->delete_subnode_tree("1"));
+    CHECK(vol.root()->open_subnode("1.2.3") == nullptr);
+
+    // Recreated nodes are found instead of the deleted ones
+    const auto& new_node_1_2_3 = vol.root()->create_subnode("1.2.3");
+    CHECK(new_node_1_2_3 != node_1_2_3);
+    CHECK(vol.root()->open_subnode("1.2.3") == new_node_1_2_3);
+}
+
+TEST_CASE("Nodes can be opened once the path cache is full", "[node]")
+{
+    volume vol("vol", volume::priority_class::medium);
+
+    // More composite paths than the cache keeps
+    std::vector<std::pair<std::string, std::shared_ptr<node>>> nodes;
+    for (size_t i = 0; i < 10; ++i)
+    {
+        for (size_t j = 0; j < 10; ++j)
+        {
+            for (size_t k = 0; k < 2; ++k)
+            {
+                const std::string path = std::to_string(i) + "." + std::to_string(j) + "." + std::to_string(k);
+                nodes.emplace_back(path, vol.root()->create_subnode(path));
+            }
+        }
+    }
+    REQUIRE(nodes.size() > volume::max_cached_paths);
+
+    size_t num_found = 0;
+    for (size_t round = 0; round < 3; ++round)
+    {
+        for (const auto& [path, n] : nodes)
+        {
+            if (vol.root()->open_subnode(path) == n)
+                ++num_found;
+        }
+    }
+    CHECK(num_found == 3 * nodes.size());
+
+    // Evicted and cached nodes are both gone once deleted
+    CHECK(vol.root()->delete_subnode_tree("0"));
+    CHECK(vol.root()->open_subnode("0.0.0") == nullptr);
+    CHECK(vol.root()->open_subnode("0.9.1") == nullptr);
+    CHECK(vol.root()->open_subnode("9.9.1") == nodes.back().second);
+}
+
+TEST_CASE("Borrowed subnodes stay accessible after deletion", "[node]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node_1_2 = vol.root()->create_subnode("1.2");
+    node_1_2->set_value("k", "v");
+
+    // Borrowing a subnode doesn't take shared ownership of it
+    const long use_count = node_1_2.use_count();
+    borrowed_ptr<node> borrowed = vol.borrow_root()->borrow_subnode("1.2");
+    REQUIRE(borrowed);
+    CHECK(borrowed.get() == node_1_2.get());
+    CHECK(node_1_2.use_count() == use_count);
+
+    CHECK_FALSE(vol.root()->borrow_subnode("1.3"));
+    CHECK_FALSE(vol.root()->borrow_subnode("1.2.3"));
+
+    // Deleted subnode is kept alive while it is borrowed
+    CHECK(vol.root()->delete_subnode_tree("1"));
+    CHECK(borrowed->deleted());
+    CHECK(borrowed->path().str() == "vol.1.2");
+    CHECK_FALSE(vol.root()->borrow_subnode("1.2"));
+}
+
+TEST_CASE("Subtrees can be deleted with a deferred teardown", "[node]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node_1 = vol.root()->create_subnode("1");
+    const auto& node_1_2_3 = vol.root()->create_subnode("1.2.3");
+    node_1_2_3->set_value("k", "v");
+    CHECK(vol.root()->open_subnode("1.2.3") == node_1_2_3);
+
+    // Whole subtree is deleted as soon as its root is detached
+    CHECK(vol.root()->delete_subnode_tree("1", teardown::deferred));
+    CHECK(node_1->deleted());
+    CHECK(node_1_2_3->deleted());
+    CHECK(vol.root()->open_subnode("1") == nullptr);
+    CHECK(vol.root()->open_subnode("1.2.3") == nullptr);
+    CHECK_FALSE(node_1_2_3->set_value("k", "v2"));
+    CHECK(node_1_2_3->create_subnode("4") == nullptr);
+
+    detail::reclaimer::instance().wait_idle();
+    CHECK(node_1_2_3->deleted());
+    CHECK_FALSE(node_1_2_3->get_value<std::string>("k").has_value());
+
+    // Nodes with the same names can be created meanwhile
+    vol.root()->create_subnode("1.2.3");
+    vol.root()->create_subnode("2");
+    CHECK(vol.root()->delete_subnode_tree(teardown::deferred));
+    CHECK(vol.root()->open_subnode("1") == nullptr);
+    CHECK(vol.root()->open_subnode("2") == nullptr);
+    detail::reclaimer::instance().wait_idle();
+}
+
+TEST_CASE("Nodes found alive are deleted once another ancestor is detached", "[node]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node_1_2 = vol.root()->create_subnode("1.2");
+    const auto& node_1_2_3 = vol.root()->create_subnode("1.2.3");
+    const auto& node_4_5 = vol.root()->create_subnode("4.5");
+
+    // Keeps the reclaimer busy, so the detached subtrees aren't torn down while they are checked
+    std::atomic_bool released = false;
+    detail::reclaimer::instance().defer([&]() {
+        while (!released)
+            std::this_thread::yield();
+    });
+
+    CHECK(vol.root()->delete_subnode_tree("4", teardown::deferred));
+    CHECK(node_4_5->deleted());
+    CHECK_FALSE(node_1_2_3->deleted());
+    CHECK_FALSE(node_1_2->deleted());
+
+    // Nodes which have been found alive are walked again
+    CHECK(vol.root()->delete_subnode_tree("1", teardown::deferred));
+    CHECK(node_1_2->deleted());
+    CHECK(node_1_2_3->deleted());
+    CHECK(node_4_5->deleted());
+
+    released = true;
+    detail::reclaimer::instance().wait_idle();
+    CHECK(node_1_2_3->deleted());
+}
+
+TEST_CASE("Multiple values can be updated at once", "[node]")
+{
+    using namespace datastore::literals;
+
+    volume vol("vol", volume::priority_class::medium);
+    vol.root()->set_value("k1", "v");
+
+    CHECK(vol.root()->set_values({{"k2", 2_u32}, {"k3", 3.0}}));
+    CHECK(vol.root()->get_value<uint32_t>("k2") == 2_u32);
+    CHECK(vol.root()->get_value<double>("k3") == 3.0);
+
+    value_batch batch;
+    batch.set_value("k1", 1_u64).delete_value("k2").set_value("k4", "v4").set_value("k4", "v5");
+    CHECK(batch.size() == 4);
+    CHECK(vol.root()->apply_batch(batch));
+
+    CHECK(vol.root()->get_value<uint64_t>("k1") == 1_u64);
+    CHECK_FALSE(vol.root()->get_value_kind("k2"));
+    CHECK(vol.root()->get_value<double>("k3") == 3.0);
+    CHECK(vol.root()->get_value<std::string>("k4") == "v5");
+
+    // Batches with invalid values are rejected as a whole
+    value_batch invalid_batch;
+    invalid_batch.delete_value("k3").set_value(std::string(max_value_name_size_bytes + 1, 'k'), 1_u32);
+    CHECK_FALSE(vol.root()->apply_batch(invalid_batch));
+    CHECK(vol.root()->get_value<double>("k3") == 3.0);
+
+    // Values beyond the limit are not inserted
+    value_batch large_batch;
+    for (size_t i = 0; i < node::max_num_values; ++i)
+        large_batch.set_value("n" + std::to_string(i), 1_u32);
+    CHECK_FALSE(vol.root()->apply_batch(large_batch));
+    size_t num_values = 0;
+    vol.root()->for_each_value([&](const attr&) {
+        num_values++;
+    });
+    CHECK(num_values == node::max_num_values);
+}
+
+TEST_CASE("Value changes can be watched", "[node]")
+{
+    using namespace datastore::literals;
+
+    volume vol("vol", volume::priority_class::medium);
+    const std::shared_ptr<node> n = vol.root()->create_subnode("1");
+
+    std::vector<value_change> changes;
+    std::shared_ptr<value_watch> watch = n->watch_values([&](const std::vector<value_change>& batch) {
+        changes.insert(changes.end(), batch.begin(), batch.end());
+    });
+    REQUIRE(watch != nullptr);
+
+    CHECK(n->set_value("k", 0_u32));
+    vol.wait_for_observers();
+    REQUIRE(changes.size() == 1);
+    CHECK(changes[0].path.empty());
+    CHECK(changes[0].value_name == "k");
+    CHECK_FALSE(changes[0].old_kind);
+    CHECK(changes[0].new_kind == value_kind::u32);
+
+    // Writes which don't change the value are not reported
+    CHECK(n->set_values({{"k", "v"}, {"l", 1_u64}}));
+    CHECK(n->set_value("k", "v"));
+    vol.wait_for_observers();
+    REQUIRE(changes.size() == 3);
+
+    // Changes of different values made by a single write may come in any order
+    const auto k_change = changes[1].value_name == "k" ? changes[1] : changes[2];
+    CHECK(k_change.old_kind == value_kind::u32);
+    CHECK(k_change.new_kind == value_kind::str);
+    const auto l_change = changes[1].value_name == "l" ? changes[1] : changes[2];
+    CHECK(l_change.value_name == "l");
+    CHECK_FALSE(l_change.old_kind);
+
+    CHECK(n->delete_value("k") == 1);
+    vol.wait_for_observers();
+    REQUIRE(changes.size() == 4);
+    CHECK(changes[3].old_kind == value_kind::str);
+    CHECK_FALSE(changes[3].new_kind);
+
+    // Only the watched node is reported unless the whole subtree is watched
+    CHECK(n->create_subnode("2")->set_value("k", 0_u32));
+    CHECK(vol.root()->set_value("k", 0_u32));
+    vol.wait_for_observers();
+    CHECK(changes.size() == 4);
+
+    // Released watch is not delivered anything
+    watch.reset();
+    CHECK(n->set_value("k", 1_u32));
+    vol.wait_for_observers();
+    CHECK(changes.size() == 4);
+}
+
+TEST_CASE("Value changes of a subtree can be watched", "[node]")
+{
+    using namespace datastore::literals;
+
+    volume vol("vol", volume::priority_class::medium);
+
+    std::vector<value_change> changes;
+    const std::shared_ptr<value_watch> watch = vol.root()->watch_values(
+        [&](const std::vector<value_change>& batch) {
+            changes.insert(changes.end(), batch.begin(), batch.end());
+        },
+        watch_scope::subtree);
+
+    // Subnodes created after the watch are watched too
+    CHECK(vol.root()->create_subnode("1")->create_subnode("2")->set_value("k", 0_u32));
+    CHECK(vol.root()->set_value("k", 0_u32));
+    vol.wait_for_observers();
+    REQUIRE(changes.size() == 2);
+    CHECK(changes[0].path == "1.2");
+    CHECK(changes[1].path.empty());
+}
+
+TEST_CASE("Rapid value changes are coalesced", "[node]")
+{
+    using namespace datastore::literals;
+
+    volume vol("vol", volume::priority_class::medium);
+    const std::shared_ptr<node> n = vol.root()->create_subnode("1");
+
+    std::promise<void> delivering;
+    std::promise<void> release;
+    const std::shared_future<void> released = release.get_future().share();
+    std::vector<std::vector<value_change>> batches;
+    const std::shared_ptr<value_watch> watch = n->watch_values([&](const std::vector<value_change>& batch) {
+        batches.push_back(batch);
+        if (batches.size() == 1)
+            delivering.set_value();
+        released.wait();
+    });
+
+    // The first change keeps the delivery thread busy, so the following ones end up in a single batch
+    CHECK(n->set_value("a", 0_u32));
+    delivering.get_future().wait();
+    for (uint32_t i = 1; i <= 100; i++)
+        CHECK(n->set_value("b", i));
+    CHECK(n->set_value("c", "v"));
+    CHECK(n->delete_value("c") == 1);
+    CHECK(n->delete_value("a") == 1);
+    release.set_value();
+    vol.wait_for_observers();
+
+    REQUIRE(batches.size() == 2);
+    REQUIRE(batches[1].size() == 2);
+    CHECK(batches[1][0].value_name == "b");
+    CHECK_FALSE(batches[1][0].old_kind);
+    CHECK(batches[1][0].new_kind == value_kind::u32);
+    CHECK(batches[1][1].value_name == "a");
+    CHECK(batches[1][1].old_kind == value_kind::u32);
+    CHECK_FALSE(batches[1][1].new_kind);
+}
+
+TEST_CASE("Concurrent writes of a watched value are reported in order", "[node]")
+{
+    constexpr size_t num_threads = 4;
+    constexpr uint32_t num_writes = 500;
+
+    volume vol("vol", volume::priority_class::medium);
+    const std::shared_ptr<node> n = vol.root()->create_subnode("1");
+
+    std::vector<value_change> changes;
+    const std::shared_ptr<value_watch> watch = n->watch_values([&](const std::vector<value_change>& batch) {
+        changes.insert(changes.end(), batch.begin(), batch.end());
+    });
+
+    // Every write changes the kind of the value, so each change has to start from the kind the previous one left
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (uint32_t i = 0; i < num_writes; ++i)
+            {
+                if ((i + t) % 2 == 0)
+                    n->set_value("k", i);
+                else
+                    n->set_value("k", "v");
+                n->set_value(t % 2 == 0 ? "even" : "odd", i);
+            }
+        });
+    }
+
+    for (std::thread& t : threads)
+        t.join();
+    vol.wait_for_observers();
+
+    std::optional<value_kind> kind;
+    size_t num_broken = 0;
+    for (const value_change& change : changes)
+    {
+        if (change.value_name != "k")
+            continue;
+        if (change.old_kind != kind)
+            ++num_broken;
+        kind = change.new_kind;
+    }
+    CHECK(num_broken == 0);
+    CHECK(kind == n->get_value_kind("k"));
+}
+
+TEST_CASE("Values can be aggregated across a subtree", "[node]")
+{
+    using namespace datastore::literals;
+
+    volume vol("vol", volume::priority_class::medium);
+    const std::shared_ptr<node>& root = vol.root();
+    root->set_value("latency", 1.5);
+
+    // Enough values to go through both the vectorized and the remainder parts of the kernels
+    uint64_t expected_sum = 0;
+    for (uint64_t i = 0; i < 9; ++i)
+    {
+        const auto& subnode = root->create_subnode(std::to_string(i));
+        for (uint64_t j = 0; j < 7; ++j)
+        {
+            const uint64_t value = i * 10 + j;
+            subnode->create_subnode(std::to_string(j))->set_value("count", value);
+            expected_sum += value;
+        }
+        subnode->set_value("latency", static_cast<double>(i));
+    }
+    root->create_subnode("9")->set_value("count", "not a number");
+
+    CHECK(root->aggregate<uint64_t>("count", aggregate_op::sum) == expected_sum);
+    CHECK(root->aggregate<uint64_t>("count", aggregate_op::min) == 0_u64);
+    CHECK(root->aggregate<uint64_t>("count", aggregate_op::max) == 86_u64);
+    CHECK(root->aggregate<uint64_t>("count", aggregate_op::count) == 63_u64);
+
+    CHECK(root->aggregate<double>("latency", aggregate_op::sum) == 37.5);
+    CHECK(root->aggregate<double>("latency", aggregate_op::max) == 8.0);
+    CHECK(root->open_subnode("3")->aggregate<uint64_t>("count", aggregate_op::sum) == 30 * 7 + 21);
+
+    CHECK_FALSE(root->aggregate<uint32_t>("count", aggregate_op::sum));
+    CHECK(root->aggregate<uint32_t>("count", aggregate_op::count) == 0_u32);
+}
+
+TEST_CASE("Deep subtrees are aggregated with any fork depth", "[node]")
+{
+    using namespace datastore::literals;
+
+    volume vol("vol", volume::priority_class::medium);
+    const std::shared_ptr<node>& root = vol.root();
+
+    // Uneven tree with values on every level
+    uint64_t expected_sum = 0;
+    uint64_t expected_count = 0;
+    for (uint64_t i = 0; i < 4; ++i)
+    {
+        for (uint64_t j = 0; j <= i; ++j)
+        {
+            for (uint64_t k = 0; k < 3; ++k)
+            {
+                const std::string path = std::to_string(i) + "." + std::to_string(j) + "." + std::to_string(k);
+                root->create_subnode(path)->set_value("count", i * 100 + j * 10 + k);
+                expected_sum += i * 100 + j * 10 + k;
+                ++expected_count;
+            }
+            root->open_subnode(std::to_string(i) + "." + std::to_string(j))->set_value("count", 1_u64);
+            ++expected_sum;
+            ++expected_count;
+        }
+    }
+    root->set_value("count", 1000_u64);
+    expected_sum += 1000;
+    ++expected_count;
+
+    for (size_t max_fork_depth : {0, 1, 2, 3, 8})
+    {
+        for (size_t max_parallelism : {1, 4})
+        {
+            traversal_options options;
+            options.max_fork_depth = max_fork_depth;
+            options.max_parallelism = max_parallelism;
+
+            CHECK(root->aggregate<uint64_t>("count", aggregate_op::sum, options) == expected_sum);
+            CHECK(root->aggregate<uint64_t>("count", aggregate_op::count, options) == expected_count);
+            CHECK(root->aggregate<uint64_t>("count", aggregate_op::max, options) == 1000_u64);
+            CHECK(root->aggregate<uint64_t>("count", aggregate_op::min, options) == 0_u64);
+        }
+    }
+}
+
+TEST_CASE("Subnodes can be queried using path patterns", "[node]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& root = vol.root();
+    root->create_subnode("a.x.metrics");
+    root->create_subnode("a.y.metrics");
+    root->create_subnode("a.y.z.metrics");
+    root->create_subnode("b.metrics");
+
+    const auto names = [](const std::vector<std::shared_ptr<node>>& nodes) {
+        std::multiset<std::string> result;
+        for (const auto& n : nodes)
+            result.emplace(n->path().str());
+        return result;
+    };
+
+    CHECK(names(root->query("a.y.metrics")) == std::multiset<std::string>{"vol.a.y.metrics"});
+    CHECK(names(root->query("a.*.metrics")) == std::multiset<std::string>{"vol.a.x.metrics", "vol.a.y.metrics"});
+    CHECK(names(root->query("**.metrics")) == std::multiset<std::string>{"vol.a.x.metrics", "vol.a.y.metrics",
+                                                                        "vol.a.y.z.metrics", "vol.b.metrics"});
+    CHECK(names(root->query("a.**.z")) == std::multiset<std::string>{"vol.a.y.z"});
+    CHECK(names(root->query("*")) == std::multiset<std::string>{"vol.a", "vol.b"});
+    CHECK(root->query("**").size() == 9);
+    CHECK(root->open_subnode("a")->query("*.metrics").size() == 2);
+
+    CHECK(root->query("c.*").empty());
+    CHECK(root->query("a..b").empty());
+
+    std::atomic_size_t count = 0;
+    root->query(
+        "**.metrics",
+        [&](const std::shared_ptr<node>&) {
+            ++count;
+        },
+        true);
+    CHECK(count == 4);
+}
+
+TEST_CASE("Subnodes can be scanned in the name order", "[node]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& root = vol.root();
+    for (const char* name : {"b2", "a", "c", "b1", "b3", "d"})
+        root->create_subnode(name);
+
+    const auto names = [](const std::vector<std::shared_ptr<node>>& nodes) {
+        std::vector<std::string> result;
+        for (const auto& n : nodes)
+            result.emplace_back(n->name());
+        return result;
+    };
+
+    std::vector<std::shared_ptr<node>> scanned;
+    const auto collect = [&](const std::shared_ptr<node>& subnode) {
+        scanned.push_back(subnode);
+    };
+
+    root->for_each_subnode_in_range("b", "c", collect);
+    CHECK(names(scanned) == std::vector<std::string>{"b1", "b2", "b3"});
+
+    scanned.clear();
+    root->for_each_subnode_in_range("b3", "", collect);
+    CHECK(names(scanned) == std::vector<std::string>{"b3", "c", "d"});
+
+    scanned.clear();
+    root->for_each_subnode_with_prefix("b", collect);
+    CHECK(names(scanned) == std::vector<std::string>{"b1", "b2", "b3"});
+
+    // Pages continue after the name of the last subnode of the previous page
+    CHECK(names(root->list_subnodes("", 4)) == std::vector<std::string>{"a", "b1", "b2", "b3"});
+    CHECK(names(root->list_subnodes("b3", 4)) == std::vector<std::string>{"c", "d"});
+    CHECK(root->list_subnodes("d", 4).empty());
+
+    // Sorted order follows insertions and deletions
+    root->create_subnode("b0");
+    CHECK(root->delete_subnode_tree("b2"));
+    CHECK(names(root->list_subnodes("a", 3)) == std::vector<std::string>{"b0", "b1", "b3"});
+}
+
+TEST_CASE("Subtrees can be traversed in parallel", "[node]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& root = vol.root();
+    for (int i = 0; i < 5; ++i)
+    {
+        for (int j = 0; j < 5; ++j)
+            root->create_subnode(std::to_string(i) + "." + std::to_string(j) + ".leaf");
+    }
+
+    for (const size_t max_parallelism : {1, 4})
+    {
+        std::mutex mutex;
+        std::multiset<std::string> paths;
+        traversal_options options;
+        options.max_parallelism = max_parallelism;
+        options.max_fork_depth = 1;
+
+        root->parallel_for_each_subnode(
+            [&](const std::shared_ptr<node>& subnode) {
+                std::scoped_lock lock(mutex);
+                paths.emplace(subnode->path().str());
+            },
+            options);
+
+        // Every node below the root is visited exactly once
+        CHECK(paths.size() == 5 + 25 + 25);
+        CHECK(paths.count("vol.3.4.leaf") == 1);
+        CHECK(paths.count("vol") == 0);
+    }
+}
+
+TEST_CASE("Node can be modified while iterating over its subnodes and values", "[node]")
+{
+    using namespace datastore::literals;
+
+    volume vol("vol", volume::priority_class::medium);
+    const auto& root = vol.root();
+    root->create_subnode("1");
+    root->create_subnode("2");
+    root->set_value("k1", 1_u32);
+    root->set_value("k2", 2_u32);
+
+    // No locks are held during the calls, so the same containers can be written to
+    size_t num_subnodes = 0;
+    root->for_each_subnode([&](const std::shared_ptr<node>& subnode) {
+        CHECK(root->delete_subnode_tree(subnode->name()));
+        root->create_subnode(std::string(subnode->name()) + "new");
+        ++num_subnodes;
+    });
+    CHECK(num_subnodes == 2);
+    CHECK(root->open_subnode("1new"));
+    CHECK_FALSE(root->open_subnode("1"));
+
+    size_t num_values = 0;
+    root->for_each_value([&](const attr& a) {
+        root->delete_value(std::string(a.name()));
+        root->set_value(std::string(a.name()) + "_new", *a.get_value<uint32_t>());
+        ++num_values;
+    });
+    CHECK(num_values == 2);
+    CHECK(root->get_value<uint32_t>("k2_new") == 2_u32);
+    CHECK_FALSE(root->get_value_kind("k1"));
+}
+
+TEST_CASE("Any number of threads can write values at the same time", "[node]")
+{
+    constexpr size_t num_threads = 300;
+
+    volume vol("vol", volume::priority_class::medium);
+    const std::shared_ptr<node> n = vol.root()->create_subnode("1");
+
+    // Every thread stays alive until all of them have written
+    std::atomic_size_t num_written = 0;
+    std::atomic_size_t num_done = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        threads.emplace_back([&, i]() {
+            if (n->set_value("v", static_cast<uint64_t>(i)))
+                ++num_written;
+            ++num_done;
+
+            while (num_done < num_threads)
+                std::this_thread::yield();
+        });
+    }
+
+    for (std::thread& t : threads)
+        t.join();
+    CHECK(num_written == num_threads);
+}
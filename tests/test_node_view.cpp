@@ -3,7 +3,13 @@
 
 #include <catch2/catch_test_macros.hpp>
 
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
 
 using namespace datastore;
 using namespace datastore::literals;
@@ -52,6 +58,138 @@ TEST_CASE("Volume nodes can be unloaded from a node view", "[node_view]")
     CHECK(subnode->expired());
 }
 
+TEST_CASE("Volume nodes can be unloaded or deleted with a deferred teardown", "[node_view]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    vol.root()->create_subnode("1.2.3");
+    vol.root()->create_subnode("4.5");
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol.root());
+    const std::shared_ptr<node_view> view_1 = vault.root()->open_subnode("vol.1");
+    const std::shared_ptr<node_view> view_1_2_3 = vault.root()->open_subnode("vol.1.2.3");
+
+    // Unloaded subnode expires right away, its subnodes once the reclaimer reaches them
+    CHECK(vault.root()->open_subnode("vol")->unload_subnode_tree("1", teardown::deferred));
+    CHECK(view_1->expired());
+    CHECK(vault.root()->open_subnode("vol.1") == nullptr);
+    CHECK(vault.root()->open_subnode("vol.1.2.3") == nullptr);
+
+    detail::reclaimer::instance().wait_idle();
+    CHECK(view_1_2_3->expired());
+    CHECK(vol.root()->open_subnode("1.2.3") != nullptr);
+
+    // Observers learn about deleted nodes once the reclaimer reaches them
+    CHECK(vault.root()->open_subnode("vol")->delete_subview_tree("4", teardown::deferred));
+    CHECK(vol.root()->open_subnode("4.5") == nullptr);
+    detail::reclaimer::instance().wait_idle();
+    CHECK(vault.root()->open_subnode("vol.4") == nullptr);
+}
+
+TEST_CASE("Nodes loaded into many short-lived vaults keep notifying the live ones", "[node_view]")
+{
+    volume vol("vol", volume::priority_class::medium);
+
+    vault live;
+    live.root()->load_subnode_tree(vol.root());
+
+    // Node views of the destroyed vaults stay registered as expired observers until they're pruned
+    for (int i = 0; i < 100; i++)
+    {
+        vault short_lived;
+        short_lived.root()->load_subnode_tree(vol.root());
+        CHECK(short_lived.root()->open_subnode("vol") != nullptr);
+    }
+
+    CHECK(vol.root()->create_subnode("1") != nullptr);
+    CHECK(live.root()->open_subnode("vol.1") != nullptr);
+}
+
+TEST_CASE("Node views can be notified about volume changes asynchronously", "[node_view]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    vol.set_observer_dispatch(dispatch::asynchronous);
+    vault vault;
+    vault.root()->load_subnode_tree(vol.root());
+
+    // Views see created nodes once the observers have been notified
+    CHECK(vol.root()->create_subnode("1") != nullptr);
+    CHECK(vol.root()->open_subnode("1")->create_subnode("2") != nullptr);
+    CHECK(vol.root()->open_subnode("1.2")->create_subnode("3") != nullptr);
+    vol.wait_for_observers();
+    CHECK(vault.root()->open_subnode("vol.1.2.3") != nullptr);
+
+    // Views see deleted nodes once the observers have been notified
+    const std::shared_ptr<node_view> view_1_2 = vault.root()->open_subnode("vol.1.2");
+    CHECK(vol.root()->open_subnode("1")->delete_subnode_tree("2"));
+    vol.wait_for_observers();
+    CHECK(view_1_2->expired());
+    CHECK(vault.root()->open_subnode("vol.1.2") == nullptr);
+
+    // Nodes created and deleted between notifications might be never seen, but they don't linger in views
+    for (int i = 0; i < 100; i++)
+    {
+        CHECK(vol.root()->create_subnode("4") != nullptr);
+        CHECK(vol.root()->create_subnode("4") != nullptr);
+        CHECK(vol.root()->open_subnode("4")->create_subnode("5") != nullptr);
+        CHECK(vol.root()->delete_subnode_tree("4"));
+    }
+    vol.wait_for_observers();
+    CHECK(vault.root()->open_subnode("vol.4") == nullptr);
+    CHECK(vault.root()->open_subnode("vol.1") != nullptr);
+
+    // Views are notified right away once the dispatch is synchronous again
+    vol.set_observer_dispatch(dispatch::synchronous);
+    CHECK(vol.root()->create_subnode("6") != nullptr);
+    CHECK(vault.root()->open_subnode("vol.6") != nullptr);
+}
+
+TEST_CASE("Value changes of the observed nodes can be watched", "[node_view]")
+{
+    volume vol1("vol", volume::priority_class::low);
+    volume vol2("vol", volume::priority_class::medium);
+    vault vault;
+    vault.root()->load_subnode_tree(vol1.root());
+    vault.root()->load_subnode_tree(vol2.root());
+
+    std::vector<value_change> changes;
+    const std::shared_ptr<value_watch> watch = vault.root()->open_subnode("vol")->watch_values(
+        [&](const std::vector<value_change>& batch) {
+            changes.insert(changes.end(), batch.begin(), batch.end());
+        },
+        watch_scope::subtree);
+    REQUIRE(watch != nullptr);
+
+    // Changes of both volumes are reported even though one hides the other
+    CHECK(vol1.root()->set_value("k", "v1"));
+    vol1.wait_for_observers();
+    CHECK(vol2.root()->set_value("k", 0_u32));
+    CHECK(vault.root()->open_subnode("vol")->create_subnode("1") != nullptr);
+    CHECK(vault.root()->open_subnode("vol.1")->set_value("k", 1_u32));
+    vol2.wait_for_observers();
+
+    REQUIRE(changes.size() == 3);
+    CHECK(changes[0].new_kind == value_kind::str);
+    CHECK(changes[1].new_kind == value_kind::u32);
+    CHECK(changes[2].path == "1");
+}
+
+TEST_CASE("Opening existing volume nodes doesn't affect node views", "[node_view]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    CHECK(vol.root()->create_subnode("1")->set_value("k", 0_u32));
+    vault vault;
+    vault.root()->load_subnode_tree(vol.root());
+
+    // Node view keeps observing the node once
+    CHECK(vol.root()->create_subnode("1") != nullptr);
+    size_t num_values = 0;
+    vault.root()->open_subnode("vol.1")->for_each_value([&](const attr&) {
+        num_values++;
+    });
+    CHECK(num_values == 1);
+}
+
 TEST_CASE("Volume nodes can be created using the node_view API", "[node_view]")
 {
     volume vol("vol", volume::priority_class::medium);
@@ -60,6 +198,28 @@ TEST_CASE("Volume nodes can be created using the node_view API", "[node_view]")
 
     CHECK(vault.root()->create_subnode("vol.1") != nullptr);
     CHECK(vol.root()->open_subnode("1") != nullptr);
+
+    // Every created node is observed once, also when created through a composite path
+    const std::shared_ptr<node_view> view_x = vault.root()->open_subnode("vol")->create_subnode("x");
+    REQUIRE(view_x != nullptr);
+    CHECK(vol.root()->open_subnode("x")->set_value("k", 1_u32));
+    const std::shared_ptr<node_view> view_x_y_z = view_x->create_subnode("y.z");
+    REQUIRE(view_x_y_z != nullptr);
+    CHECK(view_x_y_z == vault.root()->open_subnode("vol.x.y.z"));
+    CHECK(vol.root()->open_subnode("x.y")->set_value("k", 2_u32));
+    CHECK(vol.root()->open_subnode("x.y.z")->set_value("k", 3_u32));
+
+    std::ostringstream printed;
+    printed << *vault.root();
+    const auto count_lines = [&](const std::string& line) {
+        size_t count = 0;
+        for (size_t pos = printed.str().find(line); pos != std::string::npos; pos = printed.str().find(line, pos + 1))
+            ++count;
+        return count;
+    };
+    CHECK(count_lines("k@vol.x = 1") == 1);
+    CHECK(count_lines("k@vol.x.y = 2") == 1);
+    CHECK(count_lines("k@vol.x.y.z = 3") == 1);
 }
 
 TEST_CASE("In case of conflicting names, value is taken from a volume with a higher priority", "[node_view]")
@@ -152,6 +312,141 @@ TEST_CASE("Volume priority is respected by a node view after setting a value out
     CHECK(vault.root()->open_subnode("vol.1")->get_value<uint32_t>("k") == 1_u32);
 }
 
+TEST_CASE("Values resolved by a node view follow the changes of the observed nodes", "[node_view]")
+{
+    volume vol1("vol", volume::priority_class::low);
+    vol1.root()->create_subnode("1")->set_value("k", 1_u32);
+
+    volume vol2("vol", volume::priority_class::medium);
+    vol2.root()->create_subnode("1");
+
+    volume vol3("vol", volume::priority_class::high);
+    vol3.root()->create_subnode("1")->set_value("k", "v3");
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol1.root());
+    vault.root()->load_subnode_tree(vol2.root());
+    const std::shared_ptr<node_view> view = vault.root()->open_subnode("vol.1");
+
+    // Repeated reads are answered by the cached resolution
+    CHECK(view->get_value<uint32_t>("k") == 1_u32);
+    CHECK(view->get_value<uint32_t>("k") == 1_u32);
+    CHECK(view->get_value_kind("k") == value_kind::u32);
+    CHECK(view->get_value_kind("missing") == std::nullopt);
+    CHECK(view->get_value_kind("missing") == std::nullopt);
+
+    // A write to a node with a higher priority hides the resolved value
+    vol2.root()->open_subnode("1")->set_value("k", 2_u32);
+    CHECK(view->get_value<uint32_t>("k") == 2_u32);
+
+    // A write to the winning node changes the resolved value
+    vol2.root()->open_subnode("1")->set_value("k", 3_u32);
+    CHECK(view->get_value<uint32_t>("k") == 3_u32);
+
+    // Deleting the value exposes the value of a node with a lower priority
+    CHECK(vol2.root()->open_subnode("1")->delete_value("k") == 1);
+    CHECK(view->get_value<uint32_t>("k") == 1_u32);
+
+    vol1.root()->open_subnode("1")->set_value("missing", 0_u64);
+    CHECK(view->get_value_kind("missing") == value_kind::u64);
+
+    // Loading a node with a higher priority changes the resolution
+    vault.root()->load_subnode_tree(vol3.root());
+    CHECK(view->get_value_kind("k") == value_kind::str);
+    CHECK(view->get_value<std::string>("k") == "v3");
+
+    // A value of another type is still looked up in the nodes with a lower priority
+    CHECK(view->get_value<uint32_t>("k") == 1_u32);
+
+    // Deleting a node makes the view stop observing it
+    CHECK(vol3.root()->delete_subnode_tree("1") == 1);
+    CHECK(view->get_value_kind("k") == value_kind::u32);
+    CHECK(view->get_value<uint32_t>("k") == 1_u32);
+}
+
+TEST_CASE("Node view resolves more values than it keeps cached", "[node_view]")
+{
+    // Every node holds at most max_num_values values, so several volumes are needed to exceed the cache
+    std::vector<std::unique_ptr<volume>> volumes;
+    vault vault;
+    for (uint32_t v = 0; v < 8; ++v)
+    {
+        auto& vol = volumes.emplace_back(std::make_unique<volume>("vol", volume::priority_class::medium));
+        const std::shared_ptr<node> n = vol->root()->create_subnode("1");
+        for (uint32_t i = 0; i < node::max_num_values; ++i)
+            CHECK(n->set_value("k" + std::to_string(v * node::max_num_values + i), v));
+        vault.root()->load_subnode_tree(vol->root());
+    }
+    const std::shared_ptr<node_view> view = vault.root()->open_subnode("vol.1");
+
+    const uint32_t num_names = 8 * node::max_num_values;
+    REQUIRE(num_names > node_view::max_num_resolutions);
+
+    size_t num_resolved = 0;
+    for (size_t round = 0; round < 2; ++round)
+    {
+        for (uint32_t i = 0; i < num_names; ++i)
+        {
+            if (view->get_value<uint32_t>("k" + std::to_string(i)) == i / node::max_num_values)
+                ++num_resolved;
+
+            // Names which no node has are not cached
+            CHECK_FALSE(view->get_value_kind("missing" + std::to_string(i)));
+        }
+    }
+    CHECK(num_resolved == 2 * num_names);
+
+    // A cached value follows the writes
+    volumes[0]->root()->open_subnode("1")->set_value("k0", 100_u32);
+    CHECK(view->get_value<uint32_t>("k0") == 100_u32);
+}
+
+TEST_CASE("Values of the observed nodes are merged by name", "[node_view]")
+{
+    volume vol1("vol", volume::priority_class::low);
+    vol1.root()->set_value("a", 1_u32);
+    vol1.root()->set_value("b", 1_u32);
+
+    volume vol2("vol", volume::priority_class::medium);
+    vol2.root()->set_value("b", 2_u32);
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol1.root());
+    vault.root()->load_subnode_tree(vol2.root());
+    const std::shared_ptr<node_view> view = vault.root()->open_subnode("vol");
+
+    const auto merged = [&]() {
+        std::map<std::string, std::pair<uint32_t, uint8_t>> values;
+        view->for_each_value_with_priority([&](const attr& a, uint8_t priority) {
+            CHECK(values.emplace(a.name(), std::make_pair(*a.get_value<uint32_t>(), priority)).second);
+        });
+        return values;
+    };
+
+    const std::map<std::string, std::pair<uint32_t, uint8_t>> expected = {
+        {"a", {1_u32, volume::priority_class::low}},
+        {"b", {2_u32, volume::priority_class::medium}}};
+    CHECK(merged() == expected);
+    CHECK(merged() == expected);
+
+    size_t num_values = 0;
+    view->for_each_value([&](const attr&) {
+        ++num_values;
+    });
+    CHECK(num_values == 2);
+
+    // Changes of the observed nodes are picked up
+    vol2.root()->set_value("a", 3_u32);
+    CHECK(merged().at("a") == std::make_pair(3_u32, uint8_t(volume::priority_class::medium)));
+
+    CHECK(vol2.root()->delete_value("b") == 1);
+    CHECK(merged().at("b") == std::make_pair(1_u32, uint8_t(volume::priority_class::low)));
+
+    vault.root()->unload_subnode_tree("vol");
+    CHECK(view->expired());
+    CHECK(merged().empty());
+}
+
 TEST_CASE("When a node has multiple node views, "
           "all of them are updated in case a node gets deleted outside of a vault",
           "[node_view]")
@@ -266,3 +561,259 @@ TEST_CASE("Unloading non-existent node fails")
 
     CHECK(num_unloaded == 0);
 }
+
+TEST_CASE("Node views can be borrowed", "[node_view]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    vol.root()->create_subnode("1.2")->set_value("k", "v");
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol.root());
+
+    borrowed_ptr<node_view> borrowed = vault.borrow_root()->borrow_subnode("vol.1.2");
+    REQUIRE(borrowed);
+    CHECK(borrowed.get() == vault.root()->open_subnode("vol.1.2").get());
+    CHECK(borrowed->get_value<std::string>("k") == "v");
+
+    CHECK_FALSE(vault.root()->borrow_subnode("vol.1.3"));
+
+    // Unloaded node view is kept alive while it is borrowed
+    CHECK(vault.root()->unload_subnode_tree("vol"));
+    CHECK(borrowed->expired());
+    CHECK_FALSE(vault.root()->borrow_subnode("vol.1.2"));
+}
+
+TEST_CASE("Node views are found by their paths from any node view of a vault", "[node_view]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    vol.root()->create_subnode("1")->create_subnode("2")->create_subnode("3");
+
+    std::shared_ptr<node_view> view_1;
+    std::shared_ptr<node_view> view_1_2_3;
+    {
+        vault vault;
+        vault.root()->load_subnode_tree(vol.root());
+
+        view_1 = vault.root()->open_subnode("vol.1");
+        view_1_2_3 = vault.root()->open_subnode("vol.1.2.3");
+        REQUIRE(view_1 != nullptr);
+        REQUIRE(view_1_2_3 != nullptr);
+        CHECK(view_1->open_subnode("2.3") == view_1_2_3);
+        CHECK(view_1->borrow_subnode("2.3").get() == view_1_2_3.get());
+        CHECK(view_1->open_subnode("3") == nullptr);
+        CHECK(view_1->open_subnode("2.3.4") == nullptr);
+
+        // Subviews created and deleted in the volume are found and forgotten
+        vol.root()->open_subnode("1.2.3")->create_subnode("4");
+        CHECK(vault.root()->open_subnode("vol.1.2.3.4") != nullptr);
+        CHECK(vol.root()->open_subnode("1.2")->delete_subnode_tree("3"));
+        CHECK(vault.root()->open_subnode("vol.1.2.3") == nullptr);
+        CHECK(vault.root()->open_subnode("vol.1.2.3.4") == nullptr);
+        CHECK(view_1_2_3->expired());
+
+        // Reloaded subviews replace the unloaded ones
+        vol.root()->open_subnode("1.2")->create_subnode("3");
+        const std::shared_ptr<node_view> view_vol = vault.root()->open_subnode("vol");
+        CHECK(vault.root()->unload_subnode_tree("vol"));
+        CHECK(view_vol->expired());
+        CHECK(vault.root()->open_subnode("vol.1") == nullptr);
+        CHECK(vault.root()->load_subnode_tree(vol.root()) != nullptr);
+        view_1 = vault.root()->open_subnode("vol.1");
+        REQUIRE(view_1 != nullptr);
+        CHECK(vault.root()->open_subnode("vol") != view_vol);
+        view_1_2_3 = vault.root()->open_subnode("vol.1.2.3");
+        CHECK(view_1_2_3 != nullptr);
+    }
+
+    // Node views which outlive the vault still find their subviews
+    CHECK(view_1->open_subnode("2.3") == view_1_2_3);
+}
+
+TEST_CASE("Multiple values can be updated at once using a node view", "[node_view]")
+{
+    volume vol1("vol", volume::priority_class::medium);
+    volume vol2("vol", volume::priority_class::high);
+    vol1.root()->set_value("k1", "low");
+    vol2.root()->set_value("k1", "high");
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol1.root());
+    vault.root()->load_subnode_tree(vol2.root());
+    const auto& vol_view = vault.root()->open_subnode("vol");
+
+    value_batch batch;
+    batch.set_value("k2", 2_u32).delete_value("k1");
+    CHECK(vol_view->apply_batch(batch));
+
+    // Batch is applied to the node with the highest priority
+    CHECK(vol2.root()->get_value<uint32_t>("k2") == 2_u32);
+    CHECK_FALSE(vol1.root()->get_value_kind("k2"));
+    CHECK(vol_view->get_value<std::string>("k1") == "low");
+
+    CHECK(vol_view->set_values({{"k3", "v3"}, {"k4", 4_u64}}));
+    CHECK(vol2.root()->get_value<std::string>("k3") == "v3");
+    CHECK(vol_view->get_value<uint64_t>("k4") == 4_u64);
+}
+
+TEST_CASE("Values can be aggregated across node views", "[node_view]")
+{
+    volume vol1("vol", volume::priority_class::medium);
+    volume vol2("vol", volume::priority_class::high);
+    vol1.root()->create_subnode("1")->set_value("k", 1_u32);
+    vol1.root()->create_subnode("2")->set_value("k", 2_u32);
+    vol2.root()->create_subnode("2")->set_value("k", 20_u32);
+    vol2.root()->create_subnode("3.4")->set_value("k", 40_u32);
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol1.root());
+    vault.root()->load_subnode_tree(vol2.root());
+
+    // Value of the node with the higher priority hides the other one
+    const auto& vol_view = vault.root()->open_subnode("vol");
+    CHECK(vol_view->aggregate<uint32_t>("k", aggregate_op::sum) == 61_u32);
+    CHECK(vol_view->aggregate<uint32_t>("k", aggregate_op::min) == 1_u32);
+    CHECK(vol_view->aggregate<uint32_t>("k", aggregate_op::count) == 3_u32);
+    CHECK(vault.root()->aggregate<uint32_t>("k", aggregate_op::max) == 40_u32);
+
+    // Forking deeper subtrees doesn't change the result
+    for (size_t max_fork_depth : {0, 1, 3})
+    {
+        traversal_options options;
+        options.max_fork_depth = max_fork_depth;
+        CHECK(vault.root()->aggregate<uint32_t>("k", aggregate_op::sum, options) == 61_u32);
+        CHECK(vault.root()->aggregate<uint32_t>("k", aggregate_op::count, options) == 3_u32);
+    }
+}
+
+TEST_CASE("Node views can be queried using path patterns", "[node_view]")
+{
+    volume vol1("vol", volume::priority_class::medium);
+    volume vol2("vol", volume::priority_class::high);
+    vol1.root()->create_subnode("a.x.metrics");
+    vol2.root()->create_subnode("a.y.metrics");
+    vol2.root()->create_subnode("b.metrics");
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol1.root());
+    vault.root()->load_subnode_tree(vol2.root());
+
+    CHECK(vault.root()->query("vol.a.*.metrics").size() == 2);
+    CHECK(vault.root()->query("**.metrics").size() == 3);
+    CHECK(vault.root()->query("vol.b.metrics").front()->path().str() == "root.vol.b.metrics");
+    CHECK(vault.root()->query("vol.c").empty());
+
+    std::atomic_size_t count = 0;
+    vault.root()->open_subnode("vol")->query(
+        "**",
+        [&](const std::shared_ptr<node_view>&) {
+            ++count;
+        },
+        true);
+    CHECK(count == 7);
+}
+
+TEST_CASE("Subviews can be scanned in the name order", "[node_view]")
+{
+    volume vol1("vol", volume::priority_class::medium);
+    volume vol2("vol", volume::priority_class::high);
+    vol1.root()->create_subnode("b");
+    vol1.root()->create_subnode("a2");
+    vol2.root()->create_subnode("a1");
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol1.root());
+    vault.root()->load_subnode_tree(vol2.root());
+    const auto& vol_view = vault.root()->open_subnode("vol");
+
+    std::vector<std::string> names;
+    vol_view->for_each_subnode_with_prefix("a", [&](const std::shared_ptr<node_view>& subview) {
+        names.emplace_back(subview->name());
+    });
+    CHECK(names == std::vector<std::string>{"a1", "a2"});
+
+    names.clear();
+    vol_view->for_each_subnode_in_range("a2", "", [&](const std::shared_ptr<node_view>& subview) {
+        names.emplace_back(subview->name());
+    });
+    CHECK(names == std::vector<std::string>{"a2", "b"});
+
+    CHECK(vol_view->list_subnodes("a1", 1).front()->name() == "a2");
+
+    vol1.root()->delete_subnode_tree("a2");
+    CHECK(vol_view->list_subnodes("a1", 1).front()->name() == "b");
+}
+
+TEST_CASE("Node view subtrees can be traversed in parallel", "[node_view]")
+{
+    volume vol1("vol", volume::priority_class::medium);
+    volume vol2("vol", volume::priority_class::high);
+    vol1.root()->create_subnode("a.b.c");
+    vol2.root()->create_subnode("a.d");
+    vol2.root()->create_subnode("e");
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol1.root());
+    vault.root()->load_subnode_tree(vol2.root());
+
+    std::atomic_size_t count = 0;
+    vault.root()->parallel_for_each_subnode([&](const std::shared_ptr<node_view>&) {
+        ++count;
+    });
+    CHECK(count == 6);
+}
+
+TEST_CASE("Volume node trees can be mounted into a node view at once", "[node_view]")
+{
+    volume vol1("vol", volume::priority_class::medium);
+    for (size_t i = 0; i < node::max_num_subnodes; ++i)
+    {
+        for (size_t j = 0; j < node::max_num_subnodes; ++j)
+        {
+            const std::string path = std::to_string(i) + "." + std::to_string(j) + ".leaf";
+            CHECK(vol1.root()->create_subnode(path)->set_value("k", static_cast<uint64_t>(i * 10 + j)));
+        }
+    }
+
+    volume vol2("vol", volume::priority_class::high);
+    vol2.root()->create_subnode("0.0.leaf")->set_value("k", "v2");
+    vol2.root()->create_subnode("0.0.extra");
+
+    vault vault;
+
+    // A reader only ever sees the whole subtree or nothing
+    std::atomic_bool mounted = false;
+    std::thread reader([&]() {
+        while (!mounted)
+        {
+            if (vault.root()->borrow_subnode("vol.9.9.leaf"))
+                CHECK(vault.root()->borrow_subnode("vol.0.0.leaf"));
+        }
+    });
+
+    const std::shared_ptr<node_view> view = vault.root()->mount_subnode_tree(vol1.root(), {4, 1});
+    mounted = true;
+    reader.join();
+    REQUIRE(view != nullptr);
+    CHECK(vault.root()->open_subnode("vol") == view);
+    CHECK(view->open_subnode("3.4.leaf")->get_value<uint64_t>("k") == 34_u64);
+    CHECK(vault.root()->open_subnode("vol.9.9.leaf")->get_value<uint64_t>("k") == 99_u64);
+
+    // Mounted subviews observe the nodes like the loaded ones
+    vol1.root()->open_subnode("5.5")->create_subnode("new");
+    CHECK(vault.root()->open_subnode("vol.5.5.new") != nullptr);
+    CHECK(vol1.root()->open_subnode("5")->delete_subnode_tree("5"));
+    CHECK(vault.root()->open_subnode("vol.5.5") == nullptr);
+
+    // Nodes of another volume are merged into the mounted subviews
+    CHECK(vault.root()->mount_subnode_tree(vol2.root()) == view);
+    CHECK(vault.root()->open_subnode("vol.0.0.leaf")->get_value<std::string>("k") == "v2");
+    CHECK(vault.root()->open_subnode("vol.0.0.extra") != nullptr);
+
+    // Trees deeper than a vault allows are not mounted at all
+    volume deep("deep", volume::priority_class::medium);
+    deep.root()->create_subnode("1.2.3");
+    const std::shared_ptr<node_view> deep_parent = vault.root()->open_subnode("vol.0.0");
+    CHECK(deep_parent->mount_subnode_tree(deep.root()) == nullptr);
+    CHECK(deep_parent->open_subnode("deep") == nullptr);
+    CHECK(vault.root()->open_subnode("vol.0.0.deep.1") == nullptr);
+}
@@ -0,0 +1,30 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "datastore/path_pattern.hpp"
+
+TEST_CASE("Valid path pattern is parsed correctly", "[path_pattern]")
+{
+    datastore::path_pattern pp = "a.*.c";
+    CHECK(pp.valid());
+    CHECK(pp.size() == 3);
+    CHECK(pp.str() == "a.*.c");
+
+    pp = "**";
+    CHECK(pp.valid());
+    CHECK(pp.size() == 1);
+
+    pp = std::string("**.b.*");
+    CHECK(pp.valid());
+    CHECK(pp.size() == 3);
+}
+
+TEST_CASE("Invalid path pattern is detected", "[path_pattern]")
+{
+    CHECK_FALSE(datastore::path_pattern("").valid());
+    CHECK_FALSE(datastore::path_pattern(".a").valid());
+    CHECK_FALSE(datastore::path_pattern("a.").valid());
+    CHECK_FALSE(datastore::path_pattern("a..b").valid());
+    CHECK_FALSE(datastore::path_pattern("a.b*").valid());
+    CHECK_FALSE(datastore::path_pattern("a.***").valid());
+    CHECK_FALSE(datastore::path_pattern("a.b c").valid());
+}
@@ -77,3 +77,42 @@ TEST_CASE("Path is validated correctly", "[path_view]")
     pv = "/./";
     CHECK(!pv.valid());
 }
+
+TEST_CASE("Literal path is validated and split at compile time", "[path_view]")
+{
+    using namespace datastore::literals;
+
+    constexpr auto sp = "a.bc.d"_path;
+    static_assert(sp.valid());
+    static_assert(sp.size() == 3);
+    static_assert(sp.element(1) == "bc");
+    static_assert(sp.element_hash(1) == datastore::detail::hash_path_element("bc"));
+
+    // Every literal is stored once, path views borrow its elements
+    static_assert(&"a.bc.d"_path == &"a.bc.d"_path);
+
+    // Same paths as literals would fail to compile
+    CHECK(!datastore::static_path(std::string("")).valid());
+    CHECK(!datastore::static_path(std::string("a..b")).valid());
+    CHECK(!datastore::static_path(std::string("a.")).valid());
+    CHECK(!datastore::static_path(std::string("a/b")).valid());
+
+    datastore::path_view pv = sp;
+    CHECK(pv.size() == 3);
+    CHECK(pv.valid());
+    CHECK(pv.front() == "a");
+    CHECK(pv.back() == "d");
+    CHECK(pv.str() == "a.bc.d");
+
+    pv.pop_front();
+    CHECK(pv.front() == "bc");
+    CHECK(pv.front_hash() == datastore::path_view("bc").front_hash());
+    CHECK(pv.str() == "bc.d");
+
+    pv.pop_back();
+    CHECK(pv.back() == "bc");
+    CHECK_FALSE(pv.composite());
+    pv.pop_back();
+    CHECK_FALSE(pv.valid());
+    CHECK(sp.size() == 3);
+}
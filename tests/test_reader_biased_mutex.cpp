@@ -0,0 +1,132 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "datastore/detail/reader_biased_mutex.hpp"
+#include "datastore/detail/striped_hashmap.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+using datastore::detail::reader_biased_mutex;
+
+namespace
+{
+// Lock can't be tried by a thread which already holds it, so the checks are done from another thread
+bool can_lock(reader_biased_mutex& mutex)
+{
+    bool locked = false;
+    std::thread([&]() {
+        locked = mutex.try_lock();
+        if (locked)
+            mutex.unlock();
+    }).join();
+    return locked;
+}
+
+bool can_lock_shared(reader_biased_mutex& mutex)
+{
+    bool locked = false;
+    std::thread([&]() {
+        locked = mutex.try_lock_shared();
+        if (locked)
+            mutex.unlock_shared();
+    }).join();
+    return locked;
+}
+} // namespace
+
+TEST_CASE("Reader-biased mutex allows shared or exclusive ownership", "[reader_biased_mutex]")
+{
+    reader_biased_mutex mutex;
+    CHECK(can_lock(mutex));
+
+    {
+        std::shared_lock lock1(mutex);
+        std::shared_lock lock2(mutex, std::try_to_lock);
+        CHECK(lock2.owns_lock());
+        CHECK(can_lock_shared(mutex));
+        CHECK(!can_lock(mutex));
+    }
+
+    {
+        std::unique_lock lock(mutex);
+        CHECK(!can_lock_shared(mutex));
+        CHECK(!can_lock(mutex));
+    }
+
+    // Bias is restored once the lock isn't written for a while, readers holding it through the bias exclude writers
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    for (int i = 0; i < 3; ++i)
+    {
+        std::shared_lock lock(mutex);
+        CHECK(!can_lock(mutex));
+    }
+    CHECK(can_lock(mutex));
+}
+
+TEST_CASE("Reader-biased mutex can be held by a thread many times", "[reader_biased_mutex]")
+{
+    // Locks held over the per-thread limit fall back to the underlying mutex
+    std::vector<reader_biased_mutex> mutexes(40);
+    for (reader_biased_mutex& mutex : mutexes)
+        mutex.lock_shared();
+
+    for (reader_biased_mutex& mutex : mutexes)
+        CHECK(!can_lock(mutex));
+
+    for (reader_biased_mutex& mutex : mutexes)
+        mutex.unlock_shared();
+
+    for (reader_biased_mutex& mutex : mutexes)
+        CHECK(can_lock(mutex));
+}
+
+TEST_CASE("Reader-biased mutex excludes readers from writers", "[reader_biased_mutex]")
+{
+    reader_biased_mutex mutex;
+    int value1 = 0;
+    int value2 = 0;
+    std::atomic_bool consistent = true;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (int i = 0; i < 2000; ++i)
+            {
+                if (t == 0 && i % 10 == 0)
+                {
+                    std::unique_lock lock(mutex);
+                    ++value1;
+                    ++value2;
+                }
+                else
+                {
+                    std::shared_lock lock(mutex);
+                    if (value1 != value2)
+                        consistent = false;
+                }
+            }
+        });
+    }
+
+    for (std::thread& t : threads)
+        t.join();
+
+    CHECK(consistent);
+    CHECK(value1 == 200);
+}
+
+TEST_CASE("Striped hashmap can use reader-biased bucket locks", "[reader_biased_mutex]")
+{
+    datastore::detail::striped_hashmap<int, int, std::hash<int>, reader_biased_mutex> map;
+    CHECK(map.assign_or_insert_with_limit(1, 10, 10));
+    CHECK(map.assign_or_insert_with_limit(2, 20, 10));
+    CHECK(map.find(1) == 10);
+    CHECK(map.find(2) == 20);
+    CHECK(map.erase(1) == 1);
+    CHECK(!map.find(1).has_value());
+}
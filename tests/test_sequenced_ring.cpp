@@ -0,0 +1,107 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "datastore/detail/sequenced_ring.hpp"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using datastore::detail::sequenced_ring;
+
+namespace
+{
+using ring = sequenced_ring<std::string>;
+
+std::vector<std::string> read_all(const ring& r, uint64_t& position, ring::read_status& status)
+{
+    std::vector<std::string> values;
+    status = r.read(position, 100, [&](uint64_t sequence, const std::string& value) {
+        CHECK(sequence == position);
+        values.push_back(value);
+    });
+    return values;
+}
+} // namespace
+
+TEST_CASE("Records are read in the order of their sequence numbers", "[sequenced_ring]")
+{
+    ring r;
+    CHECK_FALSE(r.enabled());
+    CHECK(r.enable(3));
+    CHECK_FALSE(r.enable(8));
+    CHECK(r.enabled());
+
+    CHECK(r.append("a") == 0);
+    CHECK(r.append("b") == 1);
+    CHECK(r.end() == 2);
+
+    uint64_t position = 0;
+    ring::read_status status;
+    CHECK(read_all(r, position, status) == std::vector<std::string>{"a", "b"});
+    CHECK(status == ring::read_status::done);
+    CHECK(position == 2);
+
+    // Reading continues from where it stopped
+    CHECK(r.append("c") == 2);
+    CHECK(read_all(r, position, status) == std::vector<std::string>{"c"});
+    CHECK(position == 3);
+
+    // Number of read records can be limited
+    position = 0;
+    size_t num_read = 0;
+    CHECK(r.read(position, 2, [&](uint64_t, const std::string&) {
+        num_read++;
+    }) == ring::read_status::done);
+    CHECK(num_read == 2);
+    CHECK(position == 2);
+}
+
+TEST_CASE("Readers detect overwritten records", "[sequenced_ring]")
+{
+    ring r;
+    CHECK(r.enable(4));
+
+    for (int i = 0; i < 6; i++)
+        r.append(std::to_string(i));
+
+    uint64_t position = 1;
+    ring::read_status status;
+    CHECK(read_all(r, position, status).empty());
+    CHECK(status == ring::read_status::overflow);
+    CHECK(position == 1);
+
+    // Records which are still kept can be read
+    position = 2;
+    CHECK(read_all(r, position, status) == std::vector<std::string>{"2", "3", "4", "5"});
+    CHECK(status == ring::read_status::done);
+}
+
+TEST_CASE("Records can be appended and read concurrently", "[sequenced_ring]")
+{
+    ring r;
+    CHECK(r.enable(1024));
+
+    constexpr size_t num_writers = 4;
+    constexpr size_t num_records = 200;
+    std::vector<std::thread> writers;
+    for (size_t i = 0; i < num_writers; i++)
+    {
+        writers.emplace_back([&]() {
+            for (size_t j = 0; j < num_records; j++)
+                r.append(std::to_string(j));
+        });
+    }
+
+    // Reader never skips a record, even if it's not published yet
+    uint64_t position = 0;
+    while (position < num_writers * num_records)
+    {
+        CHECK(r.read(position, 16, [](uint64_t, const std::string& value) {
+            CHECK_FALSE(value.empty());
+        }) == ring::read_status::done);
+    }
+
+    for (std::thread& writer : writers)
+        writer.join();
+    CHECK(r.end() == num_writers * num_records);
+}
@@ -0,0 +1,90 @@
+#include "datastore/vault.hpp"
+#include "datastore/volume.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <thread>
+
+using namespace datastore;
+using namespace datastore::literals;
+
+TEST_CASE("Snapshot reads values as they were when it was taken", "[snapshot]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node1 = vol.root()->create_subnode("1");
+    node1->set_value("k1", 1_u32);
+    node1->set_value("k2", "v");
+
+    const snapshot snap = vol.snapshot();
+
+    node1->set_value("k1", 2_u32);
+    node1->set_value("k1", 3_u32);
+    node1->delete_value("k2");
+    node1->set_value("k3", 3.0);
+
+    CHECK(snap.get_value<uint32_t>(node1, "k1") == 1_u32);
+    CHECK(snap.get_value<std::string>(node1, "k2") == "v");
+    CHECK(snap.get_value_kind(node1, "k2") == value_kind::str);
+    CHECK_FALSE(snap.get_value<double>(node1, "k3"));
+
+    // Live reads are not affected
+    CHECK(node1->get_value<uint32_t>("k1") == 3_u32);
+    CHECK_FALSE(node1->get_value<std::string>("k2"));
+
+    // Later snapshots see later writes
+    const snapshot later_snap = vol.snapshot();
+    node1->delete_values();
+    CHECK(later_snap.get_value<uint32_t>(node1, "k1") == 3_u32);
+    CHECK(later_snap.get_value<double>(node1, "k3") == 3.0);
+    CHECK(snap.get_value<uint32_t>(node1, "k1") == 1_u32);
+}
+
+TEST_CASE("Vault snapshot respects volume priorities", "[snapshot]")
+{
+    volume vol1("vol", volume::priority_class::medium);
+    volume vol2("vol", volume::priority_class::high);
+    vol1.root()->set_value("k", "low");
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol1.root());
+    vault.root()->load_subnode_tree(vol2.root());
+    const auto& view = vault.root()->open_subnode("vol");
+
+    const snapshot snap = vault.snapshot();
+    vol2.root()->set_value("k", "high");
+
+    CHECK(view->get_value<std::string>("k") == "high");
+    CHECK(snap.get_value<std::string>(view, "k") == "low");
+}
+
+TEST_CASE("Snapshot sees transactions either entirely or not at all", "[snapshot]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node1 = vol.root()->create_subnode("1");
+    const auto& node2 = vol.root()->create_subnode("2");
+    node1->set_value("k", 0_u64);
+    node2->set_value("k", 0_u64);
+
+    std::atomic_bool done = false;
+    std::thread writer([&]() {
+        for (uint64_t i = 1; i <= 500; ++i)
+        {
+            transaction tx = vol.begin_transaction();
+            tx.set_value(node1, "k", i);
+            tx.set_value(node2, "k", i);
+            tx.commit();
+        }
+        done = true;
+    });
+
+    bool consistent = true;
+    while (!done)
+    {
+        const snapshot snap = vol.snapshot();
+        consistent = consistent && snap.get_value<uint64_t>(node1, "k") == snap.get_value<uint64_t>(node2, "k");
+    }
+    writer.join();
+
+    CHECK(consistent);
+}
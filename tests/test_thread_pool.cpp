@@ -0,0 +1,65 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "datastore/detail/thread_pool.hpp"
+
+#include <atomic>
+#include <functional>
+
+TEST_CASE("Thread pool runs submitted tasks", "[thread_pool]")
+{
+    datastore::detail::thread_pool pool(2);
+
+    std::atomic_int count = 0;
+    std::vector<std::future<void>> results;
+    for (int i = 0; i < 100; ++i)
+    {
+        results.push_back(pool.submit([&]() {
+            ++count;
+        }));
+    }
+
+    for (std::future<void>& result : results)
+        result.wait();
+    CHECK(count == 100);
+}
+
+TEST_CASE("Task group waits for recursively forked tasks", "[thread_pool]")
+{
+    datastore::detail::thread_pool pool(2);
+
+    std::atomic_int count = 0;
+    {
+        datastore::detail::task_group group(pool, 3);
+
+        // Binary tree of tasks, each task forks two more until the depth is reached
+        std::function<void(int)> fork = [&](int depth) {
+            ++count;
+            if (depth == 0)
+                return;
+            group.run([&, depth]() {
+                fork(depth - 1);
+            });
+            group.run([&, depth]() {
+                fork(depth - 1);
+            });
+        };
+
+        fork(6);
+        group.wait();
+        CHECK(count == 127);
+    }
+}
+
+TEST_CASE("Task group runs the work inline without parallelism", "[thread_pool]")
+{
+    datastore::detail::thread_pool pool(1);
+    datastore::detail::task_group group(pool, 1);
+
+    const std::thread::id caller = std::this_thread::get_id();
+    bool inline_run = false;
+    group.run([&]() {
+        inline_run = std::this_thread::get_id() == caller;
+    });
+    group.wait();
+    CHECK(inline_run);
+}
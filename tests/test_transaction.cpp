@@ -0,0 +1,173 @@
+#include "datastore/vault.hpp"
+#include "datastore/volume.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace datastore;
+using namespace datastore::literals;
+
+TEST_CASE("Transaction writes are applied on commit", "[transaction]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node1 = vol.root()->create_subnode("1");
+    const auto& node2 = vol.root()->create_subnode("2");
+    node2->set_value("k", "v");
+
+    transaction tx = vol.begin_transaction();
+    CHECK(tx.set_value(node1, "k", 1_u32));
+    CHECK(tx.delete_value(node2, "k"));
+
+    // Writes are visible to the transaction only
+    CHECK(tx.get_value<uint32_t>(node1, "k") == 1_u32);
+    CHECK_FALSE(tx.get_value<std::string>(node2, "k"));
+    CHECK_FALSE(node1->get_value<uint32_t>("k"));
+    CHECK(node2->get_value<std::string>("k") == "v");
+
+    CHECK(tx.commit());
+    CHECK_FALSE(tx.valid());
+
+    CHECK(node1->get_value<uint32_t>("k") == 1_u32);
+    CHECK_FALSE(node2->get_value<std::string>("k"));
+}
+
+TEST_CASE("Transaction fails to commit if the values it has read were changed", "[transaction]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node1 = vol.root()->create_subnode("1");
+    const auto& node2 = vol.root()->create_subnode("2");
+    node1->set_value("k", 1_u32);
+
+    transaction tx = vol.begin_transaction();
+    CHECK(tx.get_value<uint32_t>(node1, "k") == 1_u32);
+    CHECK(tx.set_value(node2, "k", 2_u32));
+
+    node1->set_value("k", 3_u32);
+
+    CHECK_FALSE(tx.commit());
+    CHECK_FALSE(node2->get_value<uint32_t>("k"));
+
+    // Writes to deleted nodes fail as well
+    transaction tx2 = vol.begin_transaction();
+    CHECK(tx2.set_value(node2, "k", 2_u32));
+    CHECK(vol.root()->delete_subnode_tree("2"));
+    CHECK_FALSE(tx2.commit());
+}
+
+TEST_CASE("Transaction rejects invalid values", "[transaction]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node1 = vol.root()->create_subnode("1");
+
+    transaction tx = vol.begin_transaction();
+    CHECK_FALSE(tx.set_value(node1, std::string(max_value_name_size_bytes + 1, 'k'), 1_u32));
+    CHECK_FALSE(tx.set_value(node1, "k", std::string(max_str_value_size_bytes + 1, 'v')));
+
+    // Writes which would exceed the limit of values fail the commit
+    for (size_t i = 0; i <= node::max_num_values; ++i)
+        CHECK(tx.set_value(node1, "k" + std::to_string(i), 1_u32));
+    CHECK_FALSE(tx.commit());
+    CHECK_FALSE(node1->get_value<uint32_t>("k0"));
+}
+
+TEST_CASE("Transaction can operate on node views", "[transaction]")
+{
+    volume vol1("vol", volume::priority_class::medium);
+    volume vol2("vol", volume::priority_class::high);
+    vol1.root()->create_subnode("1")->set_value("k", "low");
+    vol2.root()->create_subnode("1");
+
+    vault vault;
+    vault.root()->load_subnode_tree(vol1.root());
+    vault.root()->load_subnode_tree(vol2.root());
+    const auto& view = vault.root()->open_subnode("vol.1");
+
+    transaction tx = vault.begin_transaction();
+    CHECK(tx.get_value<std::string>(view, "k") == "low");
+    CHECK(tx.set_value(view, "k", "high"));
+    CHECK(tx.get_value<std::string>(view, "k") == "high");
+    CHECK(tx.commit());
+
+    CHECK(vol2.root()->open_subnode("1")->get_value<std::string>("k") == "high");
+    CHECK(view->get_value<std::string>("k") == "high");
+
+    // A value added to a node with a higher priority changes what the view reads
+    transaction tx2 = vault.begin_transaction();
+    CHECK(tx2.delete_value(view, "k"));
+    CHECK(tx2.get_value<std::string>(view, "k") == "low");
+    CHECK(tx2.commit());
+    CHECK(view->get_value<std::string>("k") == "low");
+}
+
+TEST_CASE("Concurrent transactions don't lose updates", "[transaction]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node1 = vol.root()->create_subnode("1");
+    const auto& node2 = vol.root()->create_subnode("2");
+    node1->set_value("k", 0_u64);
+    node2->set_value("k", 0_u64);
+
+    constexpr size_t num_threads = 4;
+    constexpr size_t num_increments = 200;
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < num_increments;)
+            {
+                transaction tx = vol.begin_transaction();
+                const std::optional<uint64_t> value1 = tx.get_value<uint64_t>(node1, "k");
+                const std::optional<uint64_t> value2 = tx.get_value<uint64_t>(node2, "k");
+                if (!value1 || !value2)
+                    continue;
+
+                tx.set_value(node1, "k", *value1 + 1);
+                tx.set_value(node2, "k", *value2 - 1);
+                if (tx.commit())
+                    ++i;
+            }
+        });
+    }
+
+    for (std::thread& thread : threads)
+        thread.join();
+
+    CHECK(node1->get_value<uint64_t>("k") == num_threads * num_increments);
+    CHECK(node1->get_value<uint64_t>("k").value() + node2->get_value<uint64_t>("k").value() == 0);
+}
+
+TEST_CASE("Plain writes wait for commits holding the node", "[transaction]")
+{
+    volume vol("vol", volume::priority_class::medium);
+    const auto& node1 = vol.root()->create_subnode("1");
+    node1->set_value("k", 0_u64);
+
+    constexpr size_t num_increments = 500;
+
+    // Plain writes to the same node force the transactions to start over, but never get mixed into a commit
+    std::atomic_bool done = false;
+    std::thread writer([&]() {
+        for (uint64_t i = 0; !done; ++i)
+            node1->set_values({{"plain", i}, {"k_shadow", i}});
+    });
+
+    for (size_t i = 0; i < num_increments;)
+    {
+        transaction tx = vol.begin_transaction();
+        const std::optional<uint64_t> value = tx.get_value<uint64_t>(node1, "k");
+        REQUIRE(value);
+
+        tx.set_value(node1, "k", *value + 1);
+        if (tx.commit())
+            ++i;
+    }
+    done = true;
+    writer.join();
+
+    CHECK(node1->get_value<uint64_t>("k") == num_increments);
+    CHECK(node1->get_value<uint64_t>("plain") == node1->get_value<uint64_t>("k_shadow"));
+}
@@ -5,6 +5,42 @@
 
 #include "datastore/volume.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+class counting_resource : public std::pmr::memory_resource
+{
+  public:
+    size_t num_allocations = 0;
+    size_t num_bytes_in_use = 0;
+
+  private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        num_allocations++;
+        num_bytes_in_use += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        num_bytes_in_use -= bytes;
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+} // namespace
+
 TEST_CASE("Volumes can be stored to disk and loaded back", "[volume]")
 {
     using namespace datastore::literals;
@@ -40,3 +76,302 @@ TEST_CASE("Volumes can be stored to disk and loaded back", "[volume]")
     CHECK(vol2->root()->get_value_kind("bin") == datastore::value_kind::bin);
     CHECK(vol2->root()->get_value<datastore::binary_blob_t>("bin") == datastore::binary_blob_t{0xd, 0xe, 0xa, 0xd});
 }
+
+TEST_CASE("Volume allocates nodes and values from its memory resource", "[volume]")
+{
+    counting_resource resource;
+
+    {
+        datastore::volume vol("vol", datastore::volume::priority_class::medium, &resource);
+        const size_t num_allocations = resource.num_allocations;
+        CHECK(num_allocations > 0);
+
+        vol.root()->create_subnode("1.2")->set_value("a_value_name_which_is_long_enough_to_be_allocated", 1.0);
+        CHECK(resource.num_allocations > num_allocations);
+
+        // Opening existing nodes through create_subnode() doesn't allocate
+        const size_t num_allocations_before_open = resource.num_allocations;
+        CHECK(vol.root()->create_subnode("1.2") != nullptr);
+        CHECK(resource.num_allocations == num_allocations_before_open);
+
+        CHECK(vol.save("vol1.vol"));
+
+        auto vol2 = datastore::volume::load("vol1.vol", &resource);
+        REQUIRE(vol2.has_value());
+        CHECK(vol2->root()->open_subnode("1.2")->get_value<double>(
+                  "a_value_name_which_is_long_enough_to_be_allocated") == 1.0);
+    }
+
+    // Everything is returned to the resource once the volumes are gone
+    CHECK(resource.num_bytes_in_use == 0);
+}
+
+TEST_CASE("Volume can be destroyed while the thread holds a borrowed pointer", "[volume]")
+{
+    counting_resource resource;
+    datastore::volume vol1("vol1", datastore::volume::priority_class::medium);
+
+    {
+        const datastore::borrowed_ptr<datastore::node> borrowed = vol1.borrow_root();
+        {
+            datastore::volume vol2("vol2", datastore::volume::priority_class::medium, &resource);
+            vol2.root()->create_subnode("1.2");
+            CHECK(vol2.root()->delete_subnode_tree("1"));
+        }
+
+        // Nodes of the destroyed volume wait for the borrowed pointer to be released
+        CHECK(borrowed->name() == "vol1");
+    }
+
+    CHECK(resource.num_bytes_in_use == 0);
+}
+
+TEST_CASE("Volume can be destroyed while another thread holds an empty borrowed pointer", "[volume]")
+{
+    datastore::volume vol1("vol1", datastore::volume::priority_class::medium);
+    std::atomic_bool ready = false;
+    std::atomic_bool destroyed = false;
+    std::atomic_bool released = false;
+    bool held_empty = false;
+
+    // Empty pointers don't pin the epoch, so they don't hold back the destruction of unrelated volumes
+    std::thread holder([&]() {
+        {
+            const datastore::borrowed_ptr<datastore::node> empty;
+            const datastore::borrowed_ptr<datastore::node> missing = vol1.root()->borrow_subnode("missing");
+            held_empty = !empty && !missing;
+            ready = true;
+
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (!destroyed && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::yield();
+        }
+        released = true;
+    });
+
+    while (!ready)
+        std::this_thread::yield();
+    {
+        datastore::volume vol2("vol2", datastore::volume::priority_class::medium);
+        vol2.root()->create_subnode("1.2");
+        CHECK(vol2.root()->delete_subnode_tree("1"));
+    }
+    const bool released_before_destroyed = released;
+    destroyed = true;
+    holder.join();
+
+    CHECK(held_empty);
+    CHECK_FALSE(released_before_destroyed);
+}
+
+TEST_CASE("Volume waits for the pending teardown of its subtrees when destroyed", "[volume]")
+{
+    counting_resource resource;
+    std::atomic_bool released = false;
+
+    // Keeps the reclaimer busy, so the teardown is still pending when the volume goes away
+    datastore::detail::reclaimer::instance().defer([&]() {
+        while (!released)
+            std::this_thread::yield();
+    });
+
+    std::thread releaser;
+    {
+        datastore::volume vol("vol", datastore::volume::priority_class::medium, &resource);
+        vol.set_observer_dispatch(datastore::dispatch::asynchronous);
+        vol.root()->create_subnode("1.2.3");
+        CHECK(vol.root()->delete_subnode_tree("1", datastore::teardown::deferred));
+
+        releaser = std::thread([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            released = true;
+        });
+    }
+
+    CHECK(resource.num_bytes_in_use == 0);
+    releaser.join();
+}
+
+TEST_CASE("Any number of threads can hold borrowed pointers at the same time", "[volume]")
+{
+    constexpr size_t num_threads = 300;
+
+    datastore::volume vol("vol", datastore::volume::priority_class::medium);
+    vol.root()->create_subnode("1");
+
+    std::atomic_size_t num_borrowed = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < num_threads; ++i)
+    {
+        threads.emplace_back([&]() {
+            const datastore::borrowed_ptr<datastore::node> borrowed = vol.borrow_root()->borrow_subnode("1");
+            if (borrowed)
+                ++num_borrowed;
+
+            // Every thread stays pinned until all of them are
+            while (borrowed && num_borrowed < num_threads)
+                std::this_thread::yield();
+        });
+    }
+
+    for (std::thread& t : threads)
+        t.join();
+    CHECK(num_borrowed == num_threads);
+}
+
+TEST_CASE("Nodes can be looked up by indexed values", "[volume]")
+{
+    using namespace datastore::literals;
+
+    datastore::volume vol("vol", datastore::volume::priority_class::medium);
+    const auto& root = vol.root();
+    root->create_subnode("host1")->set_value("role", "db");
+    root->create_subnode("host2")->set_value("role", "web");
+
+    // Lookups of values which are not indexed fail
+    CHECK_FALSE(vol.find_nodes("role", "db"));
+
+    // Existing values get indexed
+    CHECK(vol.create_index("role"));
+    CHECK_FALSE(vol.create_index("role"));
+    CHECK(vol.create_index("load"));
+    REQUIRE(vol.find_nodes("role", "db"));
+    CHECK(vol.find_nodes("role", "db")->size() == 1);
+    CHECK(vol.find_nodes("role", "db")->front() == root->open_subnode("host1"));
+
+    // Writes and deletions keep the index up to date
+    root->create_subnode("host3")->set_value("role", "db");
+    root->open_subnode("host1")->set_value("role", "web");
+    CHECK(vol.find_nodes("role", "db")->front() == root->open_subnode("host3"));
+    CHECK(vol.find_nodes("role", "web")->size() == 2);
+
+    root->open_subnode("host2")->delete_value("role");
+    CHECK(vol.find_nodes("role", "web")->size() == 1);
+
+    datastore::value_batch batch;
+    batch.set_value("role", "web").set_value("load", 5_u32);
+    CHECK(root->open_subnode("host3")->apply_batch(batch));
+    CHECK(vol.find_nodes("role", "db")->empty());
+    CHECK(vol.find_nodes("role", "web")->size() == 2);
+
+    root->open_subnode("host1")->set_value("load", 1_u32);
+    root->open_subnode("host2")->set_value("load", 9_u32);
+    root->create_subnode("host4")->set_value("load", 7_u64);
+    CHECK(vol.find_nodes_in_range<uint32_t>("load", 1, 5)->size() == 2);
+    CHECK(vol.find_nodes_in_range<uint32_t>("load", 6, 100)->front() == root->open_subnode("host2"));
+    CHECK(vol.find_nodes_in_range<uint64_t>("load", 0, 100)->front() == root->open_subnode("host4"));
+
+    CHECK(root->delete_subnode_tree("host1"));
+    CHECK(vol.find_nodes("role", "web")->size() == 1);
+    CHECK(vol.find_nodes_in_range<uint32_t>("load", 1, 5)->size() == 1);
+
+    CHECK(vol.drop_index("role"));
+    CHECK_FALSE(vol.drop_index("role"));
+    CHECK_FALSE(vol.find_nodes("role", "web"));
+}
+
+TEST_CASE("Concurrent writes of different indexed values keep the indexes up to date", "[volume]")
+{
+    using namespace datastore::literals;
+
+    constexpr uint32_t num_threads = 4;
+    constexpr uint32_t num_writes = 500;
+
+    datastore::volume vol("vol", datastore::volume::priority_class::medium);
+    CHECK(vol.create_index("role"));
+    CHECK(vol.create_index("load"));
+
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < num_threads; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            const auto n = vol.root()->create_subnode(std::to_string(t));
+            for (uint32_t i = 0; i < num_writes; ++i)
+            {
+                n->set_value("load", i);
+                n->set_value("note", "not indexed");
+                if (t % 2 == 0)
+                    n->set_value("role", i % 2 == 0 ? "db" : "web");
+                else
+                    n->apply_batch(datastore::value_batch().set_value("role", "web").set_value("load", i + 1));
+            }
+        });
+    }
+
+    for (std::thread& t : threads)
+        t.join();
+
+    CHECK(vol.find_nodes("role", "db")->empty());
+    CHECK(vol.find_nodes("role", "web")->size() == num_threads);
+    CHECK(vol.find_nodes_in_range<uint32_t>("load", 0, num_writes)->size() == num_threads);
+    CHECK(vol.find_nodes_in_range<uint32_t>("load", num_writes, num_writes)->size() == num_threads / 2);
+}
+
+TEST_CASE("Volume changes can be read from the change feed", "[volume]")
+{
+    using namespace datastore::literals;
+
+    datastore::volume vol("vol", datastore::volume::priority_class::medium);
+    const auto& root = vol.root();
+
+    // Changes made before the feed is enabled are not recorded
+    root->create_subnode("host1");
+    CHECK(vol.change_feed_end() == 0);
+
+    CHECK(vol.enable_change_feed(8));
+    CHECK_FALSE(vol.enable_change_feed(8));
+
+    root->create_subnode("host1")->set_value("role", "db");
+    root->create_subnode("host2")->set_value("load", 1_u32);
+    root->open_subnode("host2")->set_value("load", 1_u32);
+    root->open_subnode("host1")->delete_value("role");
+    root->delete_subnode_tree("host2");
+    CHECK(vol.change_feed_end() == 6);
+
+    uint64_t position = 0;
+    const auto changes = vol.read_changes(position, 100);
+    REQUIRE(changes);
+    REQUIRE(changes->size() == 6);
+    CHECK(position == 6);
+
+    CHECK((*changes)[0].sequence == 0);
+    CHECK((*changes)[0].kind == datastore::change_kind::set_value);
+    CHECK((*changes)[0].path == "vol.host1");
+    CHECK((*changes)[0].value_name == "role");
+    CHECK((*changes)[0].value == datastore::value_type("db"));
+
+    CHECK((*changes)[1].kind == datastore::change_kind::create_subnode);
+    CHECK((*changes)[1].path == "vol.host2");
+    CHECK((*changes)[2].kind == datastore::change_kind::set_value);
+
+    // Writes which set the same value again are recorded too
+    CHECK((*changes)[3].kind == datastore::change_kind::set_value);
+    CHECK((*changes)[3].value == datastore::value_type(1_u32));
+
+    CHECK((*changes)[4].sequence == 4);
+    CHECK((*changes)[4].kind == datastore::change_kind::delete_value);
+    CHECK_FALSE((*changes)[4].value);
+
+    CHECK((*changes)[5].kind == datastore::change_kind::delete_subnode);
+    CHECK((*changes)[5].path == "vol.host2");
+
+    // Every update of a batch is recorded, even if a later one undoes it
+    datastore::value_batch batch;
+    batch.set_value("tmp", 1_u32).delete_value("tmp");
+    CHECK(root->open_subnode("host1")->apply_batch(batch));
+    const auto batch_changes = vol.read_changes(position, 100);
+    REQUIRE(batch_changes);
+    REQUIRE(batch_changes->size() == 2);
+    CHECK((*batch_changes)[0].kind == datastore::change_kind::set_value);
+    CHECK((*batch_changes)[1].kind == datastore::change_kind::delete_value);
+    CHECK(position == 8);
+
+    // Consumers which fall behind learn that they have to start over
+    for (uint32_t i = 0; i < 9; i++)
+        root->set_value("counter", i);
+    CHECK_FALSE(vol.read_changes(position, 100));
+    CHECK(position == 8);
+
+    position = vol.change_feed_end();
+    CHECK(vol.read_changes(position, 100)->empty());
+}